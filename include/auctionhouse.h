@@ -0,0 +1,145 @@
+#pragma once
+
+/*
+ * header files
+ */
+#include "manager.h"
+
+/*
+ * Auction house
+ * Runs many auctions on shards, every shard is a manager on its own thread
+ * Shards listen on the same port with SO_REUSEPORT
+ * auction n is run by shard n % shards, connections for it are handed there
+ */
+class CAuctionHouse
+{
+public:
+	CAuctionHouse(unsigned int nAuctions, unsigned int nBidders = DEFAULT_BIDDERS,
+		unsigned int nShards = 0, unsigned short nPort = DEFAULT_MANAGER_PORT);	/* 0 shards is one per core */
+	~CAuctionHouse();
+
+	/* start all auctions, returns when they are over */
+	int Start();
+
+	/* Score bids with the engine, every shard has nThreads threads */
+	inline void SetScoring(CScoringEngine* pScoring, unsigned int nThreads = 0)
+	{
+		m_pScoring = pScoring;
+		m_nThreads = nThreads;
+	}
+
+	/* Close rounds once quorum of live bidders has answered */
+	inline void SetQuorum(const QUORUM& cQuorum)
+	{
+		m_cQuorum = cQuorum;
+	}
+
+	/* Close every round nRoundTime ms after it starts, 0 is no deadline */
+	inline void SetRoundTime(unsigned int nRoundTime)
+	{
+		m_nRoundTime = nRoundTime;
+	}
+
+	/* Run bidders behind nGateways gateway connections per auction */
+	inline void SetGateways(unsigned int nGateways)
+	{
+		m_nGateways = nGateways;
+	}
+
+	/* Sealed bid rounds, English, Dutch or combinatorial auctions */
+	inline void SetMode(AUCTION_MODE nMode)
+	{
+		m_nMode = nMode;
+	}
+
+	/* Combinatorial auctions, bidders bid on bundles of nItems items */
+	inline void SetItems(unsigned int nItems)
+	{
+		m_nItems = nItems;
+	}
+
+	/* Dutch auctions, clock goes down every nTickTime us */
+	inline void SetTickTime(unsigned int nTickTime)
+	{
+		m_nTickTime = nTickTime;
+	}
+
+	/* Bidders leave their bidding to proxies in manager */
+	inline void SetProxyBidders(bool bProxies)
+	{
+		m_bProxies = bProxies;
+	}
+
+	/* Publish auction state of all shards to the feed */
+	inline void SetFeed(CMarketFeed* pFeed)
+	{
+		m_pFeed = pFeed;
+	}
+
+	/* Keep bids of all shards in one history file */
+	inline void SetHistory(CHistoryFile* pHistory)
+	{
+		m_pHistory = pHistory;
+	}
+
+	/* Kernel stamps data received by every shard */
+	inline void SetTimestamps(bool bTimestamps)
+	{
+		m_bTimestamps = bTimestamps;
+	}
+
+	/* SOCK_OPT_ options of all shards' sockets */
+	inline void SetProfile(unsigned int nProfile)
+	{
+		m_nProfile = nProfile;
+	}
+
+	/* Busy poll, shard n pinned to CPU nCPU + n, -1 sleeps in epoll as usual */
+	inline void SetBusyPoll(int nCPU)
+	{
+		m_nSpinCPU = nCPU;
+	}
+
+	/* Shard n runs on n-th CPU of pManager, forked processes on pBidders */
+	inline void SetPlacement(const CPlacement* pManager, const CPlacement* pBidders)
+	{
+		m_pManagerCPUs = pManager;
+		m_pBidderCPUs = pBidders;
+	}
+
+	/* Run bidders as coroutines, one process per shard */
+	inline void SetCoroutineBidders(bool bCoroutines)
+	{
+		m_bCoroutines = bCoroutines;
+	}
+
+	/* Every bidder bids in nJoin auctions, his own and the ones after it, in batch frames */
+	inline void SetAuctionsPerBidder(unsigned int nJoin)
+	{
+		m_nJoin = nJoin;
+	}
+
+private:
+	unsigned int m_nAuctions;		/* Number of auctions */
+	unsigned int m_nBidders;		/* Number of bidders per auction */
+	unsigned short m_nPort;			/* port, shared by all shards */
+	bool m_bCoroutines;				/* bidders are coroutines */
+	unsigned int m_nJoin;			/* auctions every bidder bids in */
+	bool m_bProxies;				/* bidders register proxies */
+	bool m_bTimestamps;				/* sockets have kernel timestamps */
+	unsigned int m_nProfile;		/* SOCK_OPT_ options of sockets */
+	int m_nSpinCPU;					/* core of first busy polling shard, -1 if they don't spin */
+	const CPlacement* m_pManagerCPUs;	/* where shards run, NULL if anywhere */
+	const CPlacement* m_pBidderCPUs;	/* where forked processes run, NULL if anywhere */
+	AUCTION_MODE m_nMode;			/* sealed bid, English, Dutch or combinatorial */
+	unsigned int m_nTickTime;		/* us between ticks of Dutch clock */
+	unsigned int m_nItems;			/* items of combinatorial auctions */
+	unsigned int m_nGateways;		/* gateway connections per auction, 0 if not used */
+	QUORUM m_cQuorum;				/* answers needed to close a round */
+	unsigned int m_nRoundTime;		/* ms a round is open, 0 if rounds have no deadline */
+	CScoringEngine* m_pScoring;		/* scores multi attribute bids, NULL if not used */
+	CMarketFeed* m_pFeed;			/* market data for watchers, NULL if not used */
+	CHistoryFile* m_pHistory;		/* history of bids, NULL if not kept */
+	unsigned int m_nThreads;		/* scoring threads per shard */
+	std::vector<CManager*> m_cShards;	/* managers, one per thread */
+};
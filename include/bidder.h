@@ -9,7 +9,21 @@ public:
 	~CBidder();				/* destructor */
 
 	int Init();				/* initialize the bidders */
-	int SendBid();			/* Send a bid manager */
+	int SendBid();			/* Send a bid manager, batched when bidding on many auctions */
+	void SetAuction(unsigned int nAuction);	/* Join the auction, sent in hello */
+	void AddAuction(unsigned int nAuction);	/* Bid on one more auction */
+	inline void SetMultiAttribute(bool bMultiAttribute)	/* Send bid vectors, instead of a price */
+	{
+		m_bMultiAttribute = bMultiAttribute;
+	}
+	inline void SetProxy(bool bProxy)	/* Leave bidding to a proxy in manager */
+	{
+		m_bProxy = bProxy;
+	}
+	inline void SetProfile(unsigned int nOptions)	/* Socket options, set before Init */
+	{
+		m_cSocket.SetProfile(nOptions);
+	}
 	int RecieveOrder(int nTimeout = 0);	/* Recieve a message from server. e.g. bid/kill/re-bid etc */
 	inline pid_t GetPID() const
 	{
@@ -25,4 +39,15 @@ private:
 	std::string m_csServer;			/* manager address */
 	unsigned short m_nServerPort;	/* manager port */
 	pid_t m_nPID;					/* PID for child process */
+	char m_cInput[MAX_MESSAGE_SIZE_2];	/* orders received, up to a partial one */
+	size_t m_nInput;				/* bytes in m_cInput */
+	unsigned int m_nAuction;		/* auction joined with hello */
+	std::list<unsigned int> m_cAuctions;	/* auctions to bid on */
+	bool m_bMultiAttribute;			/* bid with price, delivery, quality and penalty */
+	bool m_bProxy;					/* first bid registers a proxy, manager bids after it */
+	unsigned int m_nValue;			/* English or Dutch auction, most he pays, 0 until first price */
+	unsigned int m_nRaise;			/* English raise or Dutch acceptance to send, 0 for a sealed bid */
+	bool m_bAccepted;				/* Dutch auction, he has taken a price */
+	unsigned int m_nItems;			/* combinatorial auction, items to bid on, 0 otherwise */
+	ROUND_TAG m_cTag;				/* round of last start, bids are tagged with it */
 };
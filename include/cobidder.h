@@ -0,0 +1,65 @@
+#pragma once
+
+/*
+ * header files
+ */
+#include "socket.h"
+#include "eventloop.h"
+
+/*
+ * Coroutine bidder
+ * Same protocol as CBidder, but it doesn't block
+ * Thousands of them share one process and one event loop
+ */
+class CCoBidder
+{
+public:
+	CCoBidder(CEventLoop& cLoop, std::string csServer, unsigned short nServerPort, pid_t nID, unsigned int nAuction = DEFAULT_AUCTION);	/* constructor */
+	~CCoBidder();			/* destructor */
+
+	CTask Run();			/* connect, and bid until killed */
+	inline pid_t GetID() const
+	{
+		return m_nID;
+	}
+	inline void SetMultiAttribute(bool bMultiAttribute)	/* Send bid vectors, instead of a price */
+	{
+		m_bMultiAttribute = bMultiAttribute;
+	}
+	inline void SetProxy(bool bProxy)	/* Leave bidding to a proxy in manager */
+	{
+		m_bProxy = bProxy;
+	}
+	inline void SetProfile(unsigned int nOptions)	/* Socket options, set before Run */
+	{
+		m_nOptions = nOptions;
+	}
+
+private:
+	int Connect();			/* start non blocking connect */
+	int FinishConnect();	/* check connect result, once socket is writable */
+	int MakeBid();			/* queue bid in m_cOutput */
+	int MakeRaise(const PRICE& cPrice);	/* English auction, queue a higher bid, if it's worth it */
+	int MakeAccept(unsigned int nPrice);	/* Dutch auction, queue acceptance, if it's worth it */
+	int MakeBundle(unsigned int nItems);	/* combinatorial auction, queue a bundle bid */
+
+private:
+	CEventLoop& m_cLoop;			/* loop, which resumes this bidder */
+	CSocket m_cSocket;				/* client socket */
+	std::string m_csServer;			/* manager address */
+	unsigned short m_nServerPort;	/* manager port */
+	pid_t m_nID;					/* bidder id, given by manager */
+	unsigned int m_nAuction;		/* auction of the bidder */
+	unsigned int m_nSeed;			/* random seed for bids */
+	bool m_bMultiAttribute;			/* bid with price, delivery, quality and penalty */
+	bool m_bProxy;					/* first bid registers a proxy, manager bids after it */
+	unsigned int m_nOptions;		/* SOCK_OPT_ options of the socket */
+	unsigned int m_nValue;			/* English or Dutch auction, most he pays */
+	bool m_bAccepted;				/* Dutch auction, he has taken a price */
+	ROUND_TAG m_cTag;				/* round of last start, bids are tagged with it */
+	char m_cInput[MAX_MESSAGE_SIZE_2];	/* orders received, up to a partial one */
+	size_t m_nInput;				/* bytes in m_cInput */
+	char m_cOutput[MAX_MESSAGE_SIZE];	/* message being sent */
+	size_t m_nOutput;				/* bytes in m_cOutput */
+	size_t m_nOutputSent;			/* bytes of m_cOutput already sent */
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+/*
+ * header files
+ */
+#include <coroutine>
+
+/*
+ * Task
+ * Coroutine started right away, and destroyed when it finishes
+ * Nobody waits for it, event loop only counts live tasks
+ */
+class CTask
+{
+public:
+	struct promise_type {
+		CTask get_return_object() { return CTask(); }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { abort(); }
+	};
+};
+
+/*
+ * Event loop
+ * Coroutines wait for socket readiness, loop resumes them
+ */
+class CEventLoop
+{
+public:
+	CEventLoop();
+	~CEventLoop();
+
+	/* Awaitable, suspends until socket is ready for the events */
+	struct CWait {
+		CEventLoop& cLoop;
+		int nSocket;
+		unsigned int nEvents;
+
+		bool await_ready() const noexcept { return false; }
+		bool await_suspend(std::coroutine_handle<> hHandle) { return cLoop.Watch(nSocket, nEvents, hHandle); }
+		void await_resume() const noexcept {}
+	};
+
+	/* Wait for socket to be readable or writable */
+	CWait Readable(int nSocket) { return CWait{ *this, nSocket, EPOLLIN }; }
+	CWait Writable(int nSocket) { return CWait{ *this, nSocket, EPOLLOUT }; }
+
+	/* Count tasks, loop runs while any is alive */
+	void TaskStarted() { ++ m_nTasks; }
+	void TaskEnded() { -- m_nTasks; }
+
+	/* Run until all tasks end */
+	int Run();
+
+private:
+	/* Resume hHandle once socket is ready, false if socket can't be watched */
+	bool Watch(int nSocket, unsigned int nEvents, std::coroutine_handle<> hHandle);
+
+private:
+	int m_nEpoll;				/* epoll handle for all waiting sockets */
+	unsigned int m_nTasks;		/* live tasks */
+};
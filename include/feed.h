@@ -0,0 +1,94 @@
+#pragma once
+
+/*
+ * header files
+ */
+#include <atomic>
+#include <string>
+
+/*
+ * States of an auction in the feed
+ */
+enum _feed_states {
+	FEED_WAITING = 0,			/* bidders are saying hello */
+	FEED_BIDDING,				/* round is open */
+	FEED_OVER					/* winner is declared, or everybody has left */
+};
+
+/*
+ * Snapshot struct
+ * what watchers see of an auction
+ */
+typedef struct feed_snapshot {
+	unsigned int nAuction;
+	unsigned int nRound;		/* rounds started so far */
+	unsigned int nPrice;		/* best bid of this round, high bid or clock price */
+	pid_t nLeader;				/* bidder of nPrice, 0 if nobody */
+	unsigned int nBidders;		/* live bidders */
+	unsigned int nReplies;		/* live bidders heard from in this round */
+	unsigned int nState;
+	uint64_t nUpdated;			/* CLOCK_MONOTONIC ns of last change */
+} FEED_SNAPSHOT;
+
+/*
+ * Market data feed
+ * Shared memory with a slot per auction, written by the thread running the auction
+ * every slot is a seqlock: writer makes the sequence odd while it writes
+ * readers copy the slot, and try again if the sequence has moved
+ * so readers never make a syscall, and never hold up the writer
+ */
+class CMarketFeed
+{
+public:
+	CMarketFeed();
+	~CMarketFeed();
+
+	/* Create feed csName with nSlots auctions, it's removed when this goes */
+	int Create(const std::string& csName, unsigned int nSlots);
+
+	/* Map an existing feed read only */
+	int Open(const std::string& csName);
+
+	/* Writer, one thread per slot */
+	void Publish(const FEED_SNAPSHOT& cSnapshot);
+
+	/* Reader, false if writer was busy with the slot every time we looked */
+	bool Read(unsigned int nSlot, FEED_SNAPSHOT& cSnapshot) const;
+
+	inline unsigned int GetSlots() const
+	{
+		return m_pHeader != NULL ? m_pHeader->nSlots : 0;
+	}
+
+private:
+	/* Header of the region, slots follow */
+	struct CHeader {
+		uint32_t nMagic;
+		uint32_t nVersion;
+		uint32_t nSlots;
+	};
+
+	/* One auction, alone on its cache line */
+	struct alignas(CACHE_LINE_SIZE) CSlot {
+		std::atomic<uint32_t> nSeq;
+		std::atomic<uint32_t> nAuction;
+		std::atomic<uint32_t> nRound;
+		std::atomic<uint32_t> nPrice;
+		std::atomic<int32_t> nLeader;
+		std::atomic<uint32_t> nBidders;
+		std::atomic<uint32_t> nReplies;
+		std::atomic<uint32_t> nState;
+		std::atomic<uint64_t> nUpdated;
+	};
+
+	static inline size_t RegionSize(unsigned int nSlots)
+	{
+		return CACHE_LINE_SIZE + nSlots * sizeof(CSlot);
+	}
+
+private:
+	std::string m_csName;		/* shared memory name, empty unless we created it */
+	CHeader* m_pHeader;			/* mapped region */
+	CSlot* m_pSlots;
+	size_t m_nSize;				/* bytes mapped */
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+ * header files
+ */
+#include "socket.h"
+#include "eventloop.h"
+
+/*
+ * Gateway
+ * Many virtual bidders on one connection
+ * their hellos, bids and kills travel in frames, a few syscalls a round
+ */
+class CGateway
+{
+public:
+	CGateway(CEventLoop& cLoop, std::string csServer, unsigned short nServerPort, pid_t nID, unsigned int nAuction = DEFAULT_AUCTION);	/* constructor */
+	~CGateway();			/* destructor */
+
+	CTask Run();			/* connect, and bid for all bidders until they are killed */
+	inline void AddBidder(pid_t nBidder)	/* virtual bidder, before Run */
+	{
+		m_cBidders.push_back(nBidder);
+	}
+	inline void SetProfile(unsigned int nOptions)	/* Socket options, set before Run */
+	{
+		m_nOptions = nOptions;
+	}
+
+private:
+	int Connect();			/* start non blocking connect */
+	int FinishConnect();	/* check connect result, queue hello and joins */
+	int MakeBids();			/* queue bids of live bidders */
+	int KillBidders(const ID_LIST& cKills);	/* forget killed bidders */
+	int MakeAccept(unsigned int nPrice);	/* Dutch auction, queue acceptance of one bidder, if it's worth it */
+
+private:
+	CEventLoop& m_cLoop;			/* loop, which resumes this gateway */
+	CSocket m_cSocket;				/* client socket */
+	std::string m_csServer;			/* manager address */
+	unsigned short m_nServerPort;	/* manager port */
+	pid_t m_nID;					/* gateway id, given by manager */
+	unsigned int m_nAuction;		/* auction of the bidders */
+	unsigned int m_nOptions;		/* SOCK_OPT_ options of the socket */
+	unsigned int m_nSeed;			/* random seed for bids */
+	unsigned int m_nValue;			/* Dutch auction, most its best bidder pays */
+	bool m_bAccepted;				/* Dutch auction, a bidder has taken a price */
+	ROUND_TAG m_cTag;				/* round of last start, bid frames are tagged with it */
+	std::vector<pid_t> m_cBidders;	/* live virtual bidders */
+	char m_cInput[MAX_FRAME_SIZE * 2];	/* orders received, up to a partial one */
+	size_t m_nInput;				/* bytes in m_cInput */
+	std::string m_csOutput;			/* frames being sent */
+	size_t m_nOutputSent;			/* bytes of m_csOutput already sent */
+};
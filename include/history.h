@@ -0,0 +1,127 @@
+#pragma once
+
+/*
+ * header files
+ */
+#include <string>
+
+/*
+ * Block struct
+ * one block of a history file, columns point into the mapping
+ */
+typedef struct history_block {
+	uint32_t nRows;
+	const uint64_t* pArrival;	/* CLOCK_MONOTONIC ns, bid was read at */
+	const uint64_t* pStart;		/* CLOCK_MONOTONIC ns, its round started at */
+	const uint64_t* pKernel;	/* CLOCK_MONOTONIC ns, kernel received it at, 0 if not stamped */
+	const uint32_t* pAuction;
+	const uint32_t* pRound;
+	const int32_t* pPID;
+	const uint32_t* pBid;
+} HISTORY_BLOCK;
+
+/*
+ * History file
+ * Bids of all auctions, in blocks of columns
+ * file header, then blocks, each a block header and its columns one after another
+ * 64 bit columns come first, so every column is aligned in a mapping
+ * a block is written with one O_APPEND writev, so shards share the file
+ */
+class CHistoryFile
+{
+public:
+	CHistoryFile();
+	~CHistoryFile();
+
+	/* Create csPath for writing, it's emptied if it's there */
+	int Create(const std::string& csPath);
+
+	/* Map csPath read only */
+	int Open(const std::string& csPath);
+
+	/* Writer, write a block of nRows from columns */
+	int Append(uint32_t nRows, const uint64_t* pArrival, const uint64_t* pStart, const uint64_t* pKernel,
+		const uint32_t* pAuction, const uint32_t* pRound, const int32_t* pPID, const uint32_t* pBid);
+
+	/* Reader, next block, false once there are no more */
+	bool Next(HISTORY_BLOCK& cBlock);
+
+	/* Reader, CLOCK_REALTIME - CLOCK_MONOTONIC ns of the writer */
+	int64_t GetClockOffset() const;
+
+private:
+	/* Header of the file, blocks follow */
+	struct CHeader {
+		uint64_t nMagic;
+		uint32_t nVersion;
+		uint32_t nReserved;
+		int64_t nClockOffset;
+	};
+
+	/* Header of a block, columns follow */
+	struct CBlockHeader {
+		uint32_t nMagic;
+		uint32_t nRows;
+	};
+
+	/* Bytes of a block with nRows, headers included */
+	static inline size_t BlockSize(uint32_t nRows)
+	{
+		return sizeof(CBlockHeader) + nRows * (3 * sizeof(uint64_t) + 4 * sizeof(uint32_t));
+	}
+
+private:
+	int m_nFile;				/* writer, INVALID_SOCKET if not writing */
+	const char* m_pRegion;		/* reader mapping */
+	size_t m_nSize;				/* bytes mapped */
+	size_t m_nOffset;			/* reader, next block starts at */
+};
+
+/*
+ * History buffer
+ * A manager's bids, until a block is full
+ * one per manager thread, so a bid takes no lock and no syscall
+ */
+class CHistoryBuffer
+{
+public:
+	CHistoryBuffer();
+	~CHistoryBuffer();
+
+	/* Write blocks to pFile, it must outlive the buffer */
+	void SetFile(CHistoryFile* pFile);
+
+	inline bool IsEnabled() const
+	{
+		return m_pFile != NULL;
+	}
+
+	/* Take one bid */
+	inline void Add(unsigned int nAuction, unsigned int nRound, pid_t nPID, unsigned int nBid,
+		uint64_t nStart, uint64_t nArrival, uint64_t nKernel)
+	{
+		m_pArrival[m_nRows] = nArrival;
+		m_pStart[m_nRows] = nStart;
+		m_pKernel[m_nRows] = nKernel;
+		m_pAuction[m_nRows] = nAuction;
+		m_pRound[m_nRows] = nRound;
+		m_pPID[m_nRows] = nPID;
+		m_pBid[m_nRows] = nBid;
+		if (++ m_nRows == HISTORY_BLOCK_ROWS)
+			Flush();
+	}
+
+	/* Write bids taken so far as a block */
+	int Flush();
+
+private:
+	CHistoryFile* m_pFile;		/* NULL if history isn't kept */
+	uint32_t m_nRows;
+	uint64_t* m_pArrival;
+	uint64_t* m_pStart;
+	uint64_t* m_pKernel;
+	uint32_t* m_pAuction;
+	uint32_t* m_pRound;
+	int32_t* m_pPID;
+	uint32_t* m_pBid;
+};
@@ -24,12 +24,14 @@ static void perr_printf(const char *format, ...)
 	va_list args;
 	int eo = errno;
 
+	flockfile(stdout);		/* shards log from many threads, keep lines whole */
 	fprintf(stdout, PERR_PREFIX, eo);
 	va_start(args, format);
 	vfprintf(stdout, format, args);
 	va_end(args);
 	fprintf(stdout, ": %s\n", strerror(eo));
 	fflush(stdout);
+	funlockfile(stdout);
 	fflush(stderr);
 }
 
@@ -43,12 +45,14 @@ static void err_printf(const char *format, ...)
 {
 	va_list args;
 
+	flockfile(stdout);
 	fprintf(stdout, NERR_PREFIX);
 	va_start(args, format);
 	vfprintf(stdout, format, args);
 	fprintf(stdout, "\n");
 	va_end(args);
 	fflush(stdout);
+	funlockfile(stdout);
 	fflush(stderr);
 }
 
@@ -63,11 +67,13 @@ static void log_message(const char *format, ...)
 	va_list args;
 	int eo = errno;
 
+	flockfile(stdout);
 	va_start(args, format);
 	vfprintf(stdout, format, args);
 	va_end(args);
 	fprintf(stdout, "\n");
 	fflush(stdout);
+	funlockfile(stdout);
 	fflush(stderr);
 }
 
@@ -83,11 +89,13 @@ static void debug_log(const char *format, ...)
 	va_list args;
 	int eo = errno;
 
+	flockfile(stdout);
 	va_start(args, format);
 	vfprintf(stdout, format, args);
 	va_end(args);
 	fprintf(stdout, "\n");
 	fflush(stdout);
+	funlockfile(stdout);
 	fflush(stderr);
 #endif /* DEBUG */
 }
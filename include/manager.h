@@ -1,10 +1,20 @@
-
 #pragma once
 
 /*
  * header files
  */
 #include "socket.h"
+#include "protocol.h"
+#include "scoring.h"
+#include "threadpool.h"
+#include "mpscqueue.h"
+#include "pool.h"
+#include "scheduler.h"
+#include "solver.h"
+#include "feed.h"
+#include "stats.h"
+#include "history.h"
+#include "placement.h"
 
 /*
  * Info struct
@@ -14,10 +24,223 @@
 typedef struct info {
 	unsigned int nBid;
 	int nSocket;
+	BID_VECTOR cVector;			/* multi attribute bid, if sent */
+	double dScore;				/* score of the bid, highest wins */
+	unsigned int nSeq;			/* bids so far, a score for an older bid is dropped */
+	unsigned int nSlot;			/* bit of bidder in responder bitmap */
+	bool bVirtual;				/* bidder behind a gateway, nSocket is shared */
+	bool bBatched;				/* joined from another auction, bids only in batch frames, gets no orders */
+	bool bProxy;				/* manager bids for him */
+	unsigned int nProxyMax;		/* proxy never bids more */
+	unsigned int nProxyStep;	/* proxy raises by this on every restart */
+	ITEM_MASK cItems;			/* combinatorial auction, bundle he bids nBid for */
 } INFO;
 
+/* Bidders of an auction, nodes come from manager's pool */
+typedef std::map<pid_t, INFO, std::less<pid_t>, CPoolAllocator<std::pair<const pid_t, INFO> > > BID_MAP;
+
+/*
+ * Auction struct
+ * bidders of one auction, and state of its round
+ */
+typedef struct auction {
+	unsigned int nAuction;
+	BID_MAP cBids;				/* Map to keep track of PID, Bid, and Socket, live bidders */
+	std::vector<int> cGateways;	/* gateway sockets, orders go once to each */
+	std::vector<uint64_t> cReplied;	/* responder bitmap of this round, by bidder slot */
+	unsigned int nSlots;		/* slots given to bidders */
+	unsigned int nBatched;		/* bidders, who joined from another auction, they aren't counted for quorum */
+	unsigned int nReplies;		/* bidders heard from in this round, joined ones too */
+	unsigned int nLiveReplies;	/* of nReplies, the live bidders, they make the quorum */
+	bool bStarted;				/* all bidders said hello, bidding has started */
+	unsigned int nRound;		/* rounds started so far, current one if started */
+	unsigned int nClosedRound;	/* last round closed, bids tagged with it are stale */
+	uint64_t nRoundStart;		/* round started at, CScheduler::Now() time */
+	uint64_t nDeadline;			/* round closes at, CScheduler::Now() time */
+	size_t nHeap;				/* index in scheduler heap, NOT_SCHEDULED if none */
+	unsigned int nScoring;		/* bids being scored */
+	bool bRoundFull;			/* every bidder has bid, round waits for scores */
+	unsigned int nProxies;		/* live bidders with a proxy */
+	unsigned int nHighBid;		/* best bid of this round, of the whole English auction */
+	pid_t nHighBidder;			/* bidder of nHighBid, 0 if nobody has bid */
+	bool bPriceDirty;			/* English auction, high bid is waiting to be sent */
+	uint64_t nPriceFlush;		/* English auction, high bid is sent at, CScheduler::Now() time */
+	unsigned int nClockPrice;	/* Dutch auction, price on the clock */
+	uint64_t nAccepted;			/* Dutch auction, acceptance of the winner was read at */
+	CBidStats cStats;			/* distribution of all bids, logged when auction is over */
+} AUCTION;
+
+/*
+ * Auction modes
+ */
+typedef enum _auction_modes {
+	MODE_SEALED = 0,			/* sealed bid rounds, ties restart */
+	MODE_ENGLISH,				/* open ascending bids, highest wins once bidding stops */
+	MODE_DUTCH,					/* price goes down on a clock, first to accept wins */
+	MODE_COMBINATORIAL			/* sealed bundle bids, most revenue of non overlapping bundles wins */
+} AUCTION_MODE;
+
+/*
+ * Accept struct
+ * bidder has taken the price of a Dutch auction, settled by arrival time
+ */
+typedef struct accept {
+	unsigned int nAuction;
+	pid_t nPID;
+	unsigned int nPrice;		/* clock price, when it was accepted */
+	uint64_t nArrival;			/* received at, kernel time if stamped, CScheduler::Now() time */
+} ACCEPT;
+
+/*
+ * Queueing struct
+ * time data waited in socket queues, from kernel timestamp to read
+ */
+typedef struct queueing {
+	uint64_t nReads;
+	uint64_t nMin;
+	uint64_t nMax;
+	uint64_t nTotal;
+} QUEUEING;
+
+/*
+ * Quorum rules
+ * live bidders, who must answer before a round closes
+ */
+typedef enum _quorum_rule {
+	QUORUM_ALL = 0,				/* every live bidder */
+	QUORUM_MAJORITY,			/* more than half */
+	QUORUM_PERCENT,				/* nValue percent, rounded up */
+	QUORUM_COUNT				/* nValue bidders, or all if less are live */
+} QUORUM_RULE;
+
+typedef struct quorum {
+	QUORUM_RULE nRule;
+	unsigned int nValue;
+} QUORUM;
+
+/*
+ * Score struct
+ * score from a scoring thread, for bid nSeq of bidder
+ */
+typedef struct score {
+	unsigned int nAuction;
+	pid_t nPID;
+	unsigned int nSeq;
+	double dScore;
+} SCORE;
+
+/*
+ * Scoring job
+ * bid nSeq of bidder, carried in a fixed job of the pool
+ */
+typedef struct score_job {
+	unsigned int nAuction;
+	pid_t nPID;
+	unsigned int nSeq;
+	BID_VECTOR cVector;
+} SCORE_JOB;
+
+static_assert(sizeof(SCORE_JOB) <= POOL_JOB_ARGS, "scoring job must fit in a fixed job");
+
+/*
+ * Connection struct
+ * socket of bidder
+ * outbound queue, flushed when the socket becomes writable
+ */
+typedef struct conn {
+	int nSocket;
+	pid_t nPID;					/* bidder on this connection, 0 until he sends it */
+	unsigned int nAuction;		/* auction of the bidder */
+	char cInput[MAX_FRAME_SIZE];	/* received data, up to a partial message */
+	size_t nInput;				/* bytes in cInput */
+	std::string csOutput;		/* queued outbound data */
+	size_t nOutputSent;			/* bytes of csOutput already sent */
+	bool bWantWrite;			/* EPOLLOUT is armed */
+	bool bDegraded;				/* above low water mark, droppable data is skipped */
+	bool bLeaf;					/* child manager, not a bidder */
+	bool bUpstream;				/* connection to parent manager */
+	bool bGateway;				/* carries virtual bidders */
+	bool bCorked;				/* TCP_CORK is on, until loop comes around */
+	std::vector<pid_t> cKills;	/* virtual bidders killed, not yet told */
+} CONN;
+
+/* Connections, nodes come from manager's pool */
+typedef std::map<int, CONN, std::less<int>, CPoolAllocator<std::pair<const int, CONN> > > CONN_MAP;
+
+/*
+ * Leaf struct
+ * child manager of a federation, and its best bids in this round
+ */
+typedef struct leaf {
+	pid_t nPID;
+	unsigned int nBidders;		/* bidders of its subtree */
+	bool bReady;				/* its bidders have said hello */
+	bool bReported;				/* it has sent best bids of this round */
+	unsigned int nEntries;
+	TOP_ENTRY cEntries[MAX_TOP_K];
+} LEAF;
+
+/*
+ * Federation states of a manager
+ */
+enum _fed_states {
+	FED_JOINING = 0,			/* waiting for bidders and child managers */
+	FED_READY,					/* told parent, waiting for start */
+	FED_BIDDING,				/* local round is open */
+	FED_MERGING,				/* local round is closed, waiting for child managers */
+	FED_REPORTED,				/* sent best bids to parent, waiting for result */
+	FED_DONE					/* winner is declared */
+};
+
+/*
+ * Handoff struct
+ * connection accepted by one shard, for an auction of another shard
+ * data received so far goes with it, starting with the hello
+ */
+typedef struct handoff {
+	int nSocket;
+	size_t nInput;
+	char cInput[MAX_FRAME_SIZE];
+} HANDOFF;
+
+/*
+ * Routed bid struct
+ * entry of a batch frame, for an auction of another shard
+ * a leave takes a bidder, who is gone, out of the auction
+ */
+typedef struct routed_bid {
+	unsigned int nAuction;
+	pid_t nPID;
+	unsigned int nBid;
+	bool bLeave;
+	uint64_t nArrival;			/* read at, CScheduler::Now() time */
+	uint64_t nKernel;			/* received by kernel at */
+} ROUTED_BID;
+
+/*
+ * Spin struct
+ * how a busy polling manager got its events
+ */
+typedef struct spin {
+	uint64_t nSpun;				/* waits, whose events came while spinning */
+	uint64_t nSlept;			/* waits, which gave up spinning and slept in epoll */
+	uint64_t nWoken;			/* sleeps, which ended with events */
+} SPIN;
+
+/*
+ * Child struct
+ * process forked by the manager, watched through a pidfd
+ */
+typedef struct child {
+	pid_t nPID;
+	unsigned int nAuction;		/* auction of the bidder, 0 if it runs coroutine bidders or gateways */
+} CHILD;
+
 class CManager
 {
+	friend class CAllocTest;		/* drives the bid path without sockets, alloctest */
+	friend class CRoundTest;		/* drives a round with joined bidders, roundtest */
+
 public:
 	/* Constructor/Destructor */
 	CManager(unsigned int nBidders = DEFAULT_BIDDERS, unsigned short nPort = DEFAULT_MANAGER_PORT);
@@ -26,8 +249,14 @@ public:
 	/* start the process */
 	int Start();
 
+	/* Create manager socket, and start listening */
+	int Listen();
+
+	/* Host an auction, bidders are created for it by CreateBidders */
+	int AddAuction(unsigned int nAuction);
+
 	/* Order the bidders to start bidding */
-	int StartBidding();
+	int StartBidding(AUCTION& cAuction);
 
 	/* Accept bidding from the bidders */
 	int AcceptBidders(int nTimeout = 0);
@@ -35,25 +264,389 @@ public:
 	/* Create bidders, fork new processes */
 	int CreateBidders();
 
+	/* Create coroutine bidders, all in one new process */
+	int CreateCoBidders();
+
+	/* Create gateways carrying virtual bidders, all in one new process */
+	int CreateGateways();
+
+	/* Score bids with the engine, on nThreads threads (0 is one per core) */
+	inline void SetScoring(CScoringEngine* pScoring, unsigned int nThreads = 0)
+	{
+		m_pScoring = pScoring;
+		m_nThreads = nThreads;
+	}
+
+	/* Close rounds once quorum of live bidders has answered */
+	inline void SetQuorum(const QUORUM& cQuorum)
+	{
+		m_cQuorum = cQuorum;
+	}
+
+	/* Close every round nRoundTime ms after it starts, 0 is no deadline */
+	inline void SetRoundTime(unsigned int nRoundTime)
+	{
+		m_nRoundTime = nRoundTime;
+	}
+
+	/* Federation, report rounds to parent manager at csServer:nPort */
+	inline void SetUpstream(const std::string& csServer, unsigned short nPort)
+	{
+		m_csUpstream = csServer;
+		m_nUpstreamPort = nPort;
+	}
+
+	/* Federation, wait for nLeaves child managers, each reports nTopK best bids */
+	inline void SetLeaves(unsigned int nLeaves, unsigned int nTopK = DEFAULT_TOP_K)
+	{
+		m_nLeaves = nLeaves;
+		m_nTopK = nTopK;
+	}
+
+	/* Run bidders behind nGateways gateway connections per auction, 0 is one connection each */
+	inline void SetGateways(unsigned int nGateways)
+	{
+		m_nGateways = nGateways;
+	}
+
+	/* Sealed bid rounds, English, Dutch or combinatorial auction */
+	inline void SetMode(AUCTION_MODE nMode)
+	{
+		m_nMode = nMode;
+	}
+
+	/* Combinatorial auction, bidders bid on bundles of nItems items */
+	inline void SetItems(unsigned int nItems)
+	{
+		m_nItems = nItems;
+	}
+
+	/* Dutch auction, clock goes down every nTickTime us */
+	inline void SetTickTime(unsigned int nTickTime)
+	{
+		m_nTickTime = nTickTime;
+	}
+
+	/* Bidders leave their bidding to proxies in manager */
+	inline void SetProxyBidders(bool bProxies)
+	{
+		m_bProxies = bProxies;
+	}
+
+	/* Publish auction state to watchers, feed outlives the manager */
+	inline void SetFeed(CMarketFeed* pFeed)
+	{
+		m_pFeed = pFeed;
+	}
+
+	/* Keep bids in a history file, file outlives the manager */
+	inline void SetHistory(CHistoryFile* pHistory)
+	{
+		m_cHistory.SetFile(pHistory);
+	}
+
+	/* Kernel stamps received data, acceptances are ordered by it, queueing is logged apart */
+	inline void SetTimestamps(bool bTimestamps)
+	{
+		m_bTimestamps = bTimestamps;
+	}
+
+	/* SOCK_OPT_ options of listener, accepted sockets and bidders' sockets */
+	inline void SetProfile(unsigned int nProfile)
+	{
+		m_nProfile = nProfile;
+	}
+
+	/* Busy poll, pinned to nCPU, -1 sleeps in epoll as usual */
+	inline void SetBusyPoll(int nCPU)
+	{
+		m_nSpinCPU = nCPU;
+	}
+
+	/* CPUs and NUMA nodes of manager threads and of forked processes, both outlive the manager */
+	inline void SetPlacement(const CPlacement* pManager, const CPlacement* pBidders)
+	{
+		m_pManagerCPUs = pManager;
+		m_pBidderCPUs = pBidders;
+	}
+
+	/* Run bidders as coroutines instead of processes */
+	inline void SetCoroutineBidders(bool bCoroutines)
+	{
+		m_bCoroutines = bCoroutines;
+	}
+
+	/* Every bidder also bids on the next nJoin - 1 of nAuctions auctions, in batch frames */
+	inline void SetAuctionsPerBidder(unsigned int nJoin, unsigned int nAuctions)
+	{
+		m_nJoin = nJoin;
+		m_nAuctionCount = nAuctions;
+	}
+
+	/* This manager is shard nShard of pShards, auction n is run by shard n % shards */
+	inline void SetShards(std::vector<CManager*>* pShards, unsigned int nShard)
+	{
+		m_pShards = pShards;
+		m_nShard = nShard;
+	}
+
+	/* Take a connection accepted by another shard, called from that shard's thread */
+	int Adopt(const HANDOFF& cHandoff);
+
+	/* Take a batch entry for an auction of this shard, called from another shard's thread */
+	int Route(const ROUTED_BID& cBid);
+
+	/* End every auction and exit once output is flushed, called from any thread */
+	void Stop();
+
+	/* SIGINT and SIGTERM are read from a signalfd, block them before any thread starts */
+	static int BlockSignals();
+
 private:
-	/* Send all data */
-	int SendAllData(int nSock, const char* pBuffer, size_t* pSize);
+	/* Queue data on the connection, and flush as much as socket takes */
+	int QueueData(int nSock, const char* pBuffer, size_t nSize, bool bDroppable = false);
+
+	/* Flush queued data, called when socket is writable */
+	int FlushData(int nSock);
+
+	/* Send data to all clients of auction */
+	int SendToAll(AUCTION& cAuction, const char* pBuffer, size_t nSize, bool bDroppable = false);
+
+	/* Accept a new connection on the manager socket */
+	int AcceptConnection();
+
+	/* Add remove a connection to epoll and connection map */
+	int AddConnection(int nSock);
+	int CloseConnection(int nSock);
+
+	/* Read from connection and handle complete messages */
+	int ReadConnection(int nSock);
+	int ProcessInput(int nSock);
+	int HandleMessage(CONN& cConn, std::string_view csMessage);
+	int HandleHello(CONN& cConn, const HELLO& cHello);
+	int HandleBid(CONN& cConn, const BID& cBid);
+	int HandleBatch(CONN& cConn, const BATCH& cBatch);
+	int HandleAttributes(CONN& cConn, const ATTR_BID& cBid);
+	int HandleProxy(CONN& cConn, const PROXY& cProxy);
+	int HandleBundle(CONN& cConn, const BUNDLE& cBundle);
+	int HandleGateway(CONN& cConn, const GATEWAY_HELLO& cHello);
+	int HandleJoin(CONN& cConn, const ID_LIST& cJoin);
+	int HandleGatewayBids(CONN& cConn, const GATEWAY_BIDS& cBids);
+
+	/* Move connection to the shard, which runs its auction */
+	bool HandOff(CONN& cConn, std::string_view csHello, size_t nOffset);
+
+	/* Take connections handed to this shard */
+	int AdoptPending();
+
+	/* Hand off connections and batch entries, other shards were too busy to take */
+	int RetryHandoffs();
+
+	/* Apply batch entries routed to this shard */
+	int TakeRouted();
+
+	/* Apply a batch entry, a bid of a bidder, who isn't in the auction (anymore), is dropped */
+	int ApplyBatched(AUCTION& cAuction, pid_t nPID, unsigned int nBid);
+
+	/* Bidder is gone, take him out of auctions he joined besides his own */
+	int LeaveJoined(pid_t nPID);
 
-	/* Send data to all clients */
-	int SendToAll(const char* pBuffer, size_t nSize);
+	/* Find auction */
+	AUCTION* FindAuction(unsigned int nAuction);
 
-	/* Send kill message */
-	int SendKill(int nSock, pid_t nPID);
+	/* Shard running the auction */
+	CManager* ShardOf(unsigned int nAuction);
+
+	/* Record a bid, and close the round once quorum has bid */
+	int ApplyBid(AUCTION& cAuction, pid_t nPID, unsigned int nBid, const BID_VECTOR* pVector = NULL);
+	int CheckRound(AUCTION& cAuction);
+	int CloseRound(AUCTION& cAuction);
+
+	/* Live bidders and their answers in this round */
+	int AddBidder(AUCTION& cAuction, pid_t nPID, bool bBatched = false);
+	void RemoveBidder(AUCTION& cAuction, BID_MAP::iterator cIter);
+	void MarkReplied(AUCTION& cAuction, const INFO& cInfo);
+	bool HasReplied(const AUCTION& cAuction, const INFO& cInfo) const;
+	void ResetRound(AUCTION& cAuction);
+	unsigned int Quorum(const AUCTION& cAuction) const;
+
+	/* Federation, rounds are decided by root manager over best bids of the tree */
+	inline bool IsFederated() const
+	{
+		return !m_csUpstream.empty() || m_nLeaves != 0;
+	}
+	int ConnectUpstream();
+	int HandleLeaf(CONN& cConn, const LEAF_HELLO& cHello);
+	int HandleReady(CONN& cConn, const READY& cReady);
+	int HandleTop(CONN& cConn, const TOP& cTop);
+	int HandleUpstream(CONN& cConn, std::string_view csMessage);
+	int CheckFederation(AUCTION& cAuction);
+	int StartFederatedRound(AUCTION& cAuction);
+	int CloseLocalRound(AUCTION& cAuction);
+	int MergeRound(AUCTION& cAuction);
+	int ApplyResult(AUCTION& cAuction, const RESULT& cResult);
+	int LeaveFederation();
+	void AddTop(TOP_ENTRY* pEntries, unsigned int& nEntries, const TOP_ENTRY& cEntry) const;
+
+	/* Close rounds, whose deadline has passed, earliest first */
+	int CloseDue();
+
+	/* Stop or resume accepting bidders, while due rounds wait */
+	int SetBackpressure(bool bBackpressure);
+
+	/* Start scoring threads and their eventfd */
+	int StartScoring();
+
+	/* Collect scores from scoring threads */
+	int ScoresReady();
+
+	/* Score a SCORE_JOB on a scoring thread, post it to m_cScores */
+	static void ScoreJob(void* pContext, const void* pArgs);
+
+	/* Arm or disarm EPOLLOUT on a connection */
+	int WatchWrite(CONN& cConn, bool bWrite);
+
+	/* Wait for events up to nTimeout ms, spinning first if busy polling */
+	int WaitEvents(struct epoll_event* pEvents, int nTimeout);
+
+	/* Uncork connections corked in this pass of the loop */
+	int Uncork();
+
+	/* Returns true if any connection has queued data */
+	bool HasPendingOutput() const;
+
+	/* English auction, take a bid if it's the highest */
+	int RaiseBid(AUCTION& cAuction, BID_MAP::iterator cIter, unsigned int nBid);
+
+	/* English auction, send high bids, which are due */
+	int FlushPrices();
+
+	/* English auction, bidding has stopped, high bid wins */
+	int CloseEnglish(AUCTION& cAuction);
+
+	/* Dutch auction, lower the price on clock of every auction, and tell bidders */
+	int StartClock();
+	int ClockTick();
+
+	/* Dutch auction, take an acceptance, first to arrive wins */
+	int AcceptPrice(AUCTION& cAuction, BID_MAP::iterator cIter, unsigned int nBid);
+	int SettleAccepts();
+
+	/* Combinatorial auction, solve for non overlapping bundles of most revenue */
+	int CloseCombinatorial(AUCTION& cAuction);
+
+	/* Proxies bid for this round, raised from their last bid */
+	int ProxyBids(AUCTION& cAuction);
+
+	/* Only proxies are left, all at their maximum, earliest one wins */
+	bool ProxiesExhausted(const AUCTION& cAuction) const;
+	int SettleProxies(AUCTION& cAuction);
+
+	/* Write state of auction to market data feed */
+	void Publish(const AUCTION& cAuction);
+
+	/* Send kill message, a deferred one goes out with FlushLosers */
+	int SendKill(AUCTION& cAuction, int nSock, pid_t nPID, bool bDefer = false);
+
+	/* Send kills of virtual bidders, a frame per gateway */
+	int FlushKills();
+
+	/* Send deferred kills, once the next round has started */
+	int FlushLosers();
+
+	/* Bid is for a round, which is closed or isn't ours */
+	bool IsStale(const CONN& cConn, const ROUND_TAG& cTag);
 
 	/* Find the winner and display other bids */
-	int FindWinner();
+	int FindWinner(AUCTION& cAuction);
 
 	/* Remove the losers from map */
-	int DeleteBidder(const int nClient);
+	int DeleteBidder(AUCTION& cAuction, const int nClient);
+
+	/* Remove finished auctions */
+	int ReapAuctions();
+
+	/* Watch forked processes, their pidfds are in epoll */
+	int WatchChildren();
+
+	/* Reap an exited process, a bidder still in his auction is removed */
+	int ReapChild(int nPidFd);
+
+	/* Read SIGINT and SIGTERM, every shard is stopped */
+	int ReadSignals();
+
+	/* Stopping, kill bidders and drop child managers, auctions are reaped */
+	int Drain();
 
 private:
+	CSlabPool m_cBidPool;			/* bidder entries of all auctions, outlives them */
+	CSlabPool m_cConnPool;			/* connections, outlives them */
+	CArena m_cRoundArena;			/* scratch data of a round, reset when round closes */
 	CSocket m_cServer;				/* Manager's socket */
 	unsigned short m_nServerPort;	/* Manager's port */
-	unsigned int m_nBidders;		/* Number of bidders */
-	std::map<pid_t, INFO> m_cBids;	/* Map to keep track of PID, Bid, and Socket */
+	unsigned int m_nBidders;		/* Number of bidders per auction */
+	QUORUM m_cQuorum;				/* answers needed to close a round */
+	unsigned int m_nRoundTime;		/* ms a round is open, 0 if rounds have no deadline */
+	CScheduler m_cScheduler;		/* open rounds by deadline */
+	bool m_bBackpressure;			/* due rounds are waiting, listener is off */
+	std::string m_csUpstream;		/* parent manager, empty for root */
+	unsigned short m_nUpstreamPort;	/* parent manager's port */
+	int m_nUpstream;				/* socket to parent manager */
+	unsigned int m_nLeaves;			/* child managers to wait for */
+	unsigned int m_nTopK;			/* best bids reported to parent */
+	std::map<int, LEAF> m_cLeaves;	/* child managers by socket */
+	int m_nFedState;				/* federation state of DEFAULT_AUCTION */
+	unsigned int m_nTop;			/* best bids of local round */
+	TOP_ENTRY m_cTop[MAX_TOP_K];
+	bool m_bCoroutines;				/* bidders are coroutines in one process */
+	unsigned int m_nJoin;			/* auctions every bidder bids on, his own included */
+	unsigned int m_nAuctionCount;	/* auctions of all shards */
+	std::map<pid_t, std::vector<unsigned int> > m_cJoined;	/* auctions our bidders joined besides their own */
+	bool m_bProxies;				/* bidders register proxies */
+	AUCTION_MODE m_nMode;			/* sealed bid, English, Dutch or combinatorial */
+	std::deque<unsigned int> m_cPriceFlushes;	/* auctions with a high bid to send, earliest first */
+	unsigned int m_nTickTime;		/* us between ticks of Dutch clock */
+	unsigned int m_nItems;			/* items of combinatorial auction */
+	CWinnerSolver* m_pSolver;		/* winner determination of combinatorial auction */
+	CMarketFeed* m_pFeed;			/* market data for watchers, NULL if not used */
+	CHistoryBuffer m_cHistory;		/* bids not yet written to history file */
+	int m_nClockTimer;				/* timerfd, Dutch clock ticks */
+	bool m_bClockRunning;			/* m_nClockTimer is armed */
+	uint64_t m_nArrival;			/* data being handled was read at, CScheduler::Now() time */
+	bool m_bTimestamps;				/* sockets have kernel timestamps */
+	uint64_t m_nKernelArrival;		/* data being handled was received by kernel at, m_nArrival if not stamped */
+	QUEUEING m_cQueueing;			/* stamped reads, and how long they were queued */
+	unsigned int m_nProfile;		/* SOCK_OPT_ options of all sockets */
+	std::vector<int> m_cCorked;		/* connections corked in this pass of the loop */
+	int m_nSpinCPU;					/* core of busy polling thread, -1 if it doesn't spin */
+	uint64_t m_nSpinTime;			/* ns to spin before sleeping, adapts to traffic */
+	SPIN m_cSpin;
+	const CPlacement* m_pManagerCPUs;	/* where manager threads run, NULL if anywhere */
+	const CPlacement* m_pBidderCPUs;	/* where forked bidders and gateways run, NULL if anywhere */
+	std::vector<ACCEPT> m_cAccepts;	/* acceptances of this epoll batch, not yet settled */
+	unsigned int m_nGateways;		/* gateway connections per auction, 0 if not used */
+	std::vector<int> m_cKillGateways;	/* gateways with kills to send */
+	std::vector<std::pair<int, pid_t> > m_cLosers;	/* bidders with a deferred kill, and their sockets */
+	uint64_t m_nStaleBids;			/* bids dropped, their round was closed */
+	std::vector<CHILD> m_cForked;	/* processes forked, not yet watched */
+	std::map<int, CHILD> m_cChildren;	/* processes by pidfd */
+	int m_nSignals;					/* signalfd, SIGINT and SIGTERM */
+	std::atomic<bool> m_bStopping;	/* signal came, auctions are ending */
+	bool m_bDrained;				/* bidders are told to go */
+	std::map<unsigned int, AUCTION> m_cAuctions;	/* Auctions run by this manager */
+	CONN_MAP m_cConns;				/* Map of socket to connection state */
+	int m_nEpoll;					/* epoll handle for manager and bidder sockets */
+	CScoringEngine* m_pScoring;		/* scores multi attribute bids, NULL if not used */
+	CThreadPool* m_pPool;			/* scoring threads */
+	unsigned int m_nThreads;		/* number of scoring threads */
+	int m_nScoreEvent;				/* eventfd, scoring threads signal finished scores */
+	CMpscQueue<SCORE, SCORE_QUEUE_SIZE> m_cScores;	/* finished scores, not yet collected */
+	std::atomic<bool> m_bClosing;	/* manager is going, scoring threads don't wait for queue */
+	std::vector<CManager*>* m_pShards;	/* all shards, NULL if manager isn't sharded */
+	unsigned int m_nShard;			/* index of this shard */
+	int m_nHandoffEvent;			/* eventfd, other shards signal handed off connections */
+	CMpscQueue<HANDOFF, HANDOFF_QUEUE_SIZE> m_cHandoffs;	/* connections handed to this shard */
+	std::list<std::pair<CManager*, HANDOFF> > m_cDeferred;	/* connections for shards, which were full */
+	CMpscQueue<ROUTED_BID, ROUTE_QUEUE_SIZE> m_cRouted;	/* batch entries routed to this shard */
+	std::list<std::pair<CManager*, ROUTED_BID> > m_cDeferredBids;	/* batch entries for shards, which were full */
 };
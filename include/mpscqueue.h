@@ -0,0 +1,98 @@
+#pragma once
+
+/*
+ * header files
+ */
+#include <atomic>
+#include <thread>
+
+/*
+ * Bounded lock-free queue, many producers and one consumer
+ * Every slot has a sequence number, which tells whose turn it is:
+ *   nSeq == position             slot is free for producer at position
+ *   nSeq == position + 1         slot holds item for consumer at position
+ * Producers claim a position with CAS on tail, consumer owns head alone
+ * Head, tail and slots are on their own cache lines
+ */
+template<typename T, size_t N>
+class CMpscQueue
+{
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "queue size must be a power of 2");
+
+public:
+	CMpscQueue()
+	{
+		for (size_t nSlot = 0; nSlot < N; ++ nSlot)
+			m_cSlots[nSlot].nSeq.store(nSlot, std::memory_order_relaxed);
+		m_nTail.store(0, std::memory_order_relaxed);
+		m_nHead = 0;
+	}
+
+	/* Add item, returns false if queue is full. Any thread */
+	bool TryPush(const T& cItem)
+	{
+		size_t nPos = m_nTail.load(std::memory_order_relaxed);
+		CSlot* pSlot = NULL;
+		while (true) {
+			pSlot = &m_cSlots[nPos & (N - 1)];
+			size_t nSeq = pSlot->nSeq.load(std::memory_order_acquire);
+			intptr_t nDiff = (intptr_t) nSeq - (intptr_t) nPos;
+			if (nDiff == 0) {
+				/* slot is free, claim it */
+				if (m_nTail.compare_exchange_weak(nPos, nPos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (nDiff < 0)
+				return false;	/* consumer hasn't freed it yet, queue is full */
+			else
+				nPos = m_nTail.load(std::memory_order_relaxed);	/* other producer took it */
+		}
+
+		pSlot->cItem = cItem;
+		pSlot->nSeq.store(nPos + 1, std::memory_order_release);	/* publish to consumer */
+		return true;
+	}
+
+	/* Add item, wait for consumer while queue is full. Any thread */
+	void Push(const T& cItem)
+	{
+		while (!TryPush(cItem))
+			std::this_thread::yield();
+	}
+
+	/*
+	 * Take up to nMax items, returns number taken. Consumer thread only
+	 * Stops at a slot, which is claimed but not yet published
+	 */
+	size_t PopBatch(T* pItems, size_t nMax)
+	{
+		size_t nItems = 0;
+		while (nItems < nMax) {
+			CSlot& cSlot = m_cSlots[m_nHead & (N - 1)];
+			if (cSlot.nSeq.load(std::memory_order_acquire) != m_nHead + 1)
+				break;
+
+			pItems[nItems ++] = cSlot.cItem;
+			cSlot.nSeq.store(m_nHead + N, std::memory_order_release);	/* free for next lap */
+			++ m_nHead;
+		}
+
+		return nItems;
+	}
+
+	/* Take one item. Consumer thread only */
+	inline bool Pop(T& cItem)
+	{
+		return PopBatch(&cItem, 1) == 1;
+	}
+
+private:
+	struct alignas(CACHE_LINE_SIZE) CSlot {
+		std::atomic<size_t> nSeq;
+		T cItem;
+	};
+
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_nTail;	/* next position for producers */
+	alignas(CACHE_LINE_SIZE) size_t m_nHead;				/* next position for consumer */
+	CSlot m_cSlots[N];
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+/*
+ * header files
+ */
+#include <string>
+
+/* NUMA nodes a placement can name, one bit each */
+const unsigned int MAX_NUMA_NODES = 64;
+
+/*
+ * Placement
+ * CPUs a group of threads or processes runs on, and NUMA nodes their memory comes from
+ * memory is bound to the nodes of the CPUs, so it's always local
+ * a thread applies it to itself, threads and processes it starts after that inherit it
+ */
+class CPlacement
+{
+public:
+	CPlacement();
+
+	/* CPU list "0-3,8", or "nodeN" for all CPUs of node N */
+	bool Parse(const std::string& csSpec);
+
+	inline bool IsSet() const
+	{
+		return m_nCPUs != 0;
+	}
+
+	/* Spec as given */
+	inline const std::string& GetSpec() const
+	{
+		return m_csSpec;
+	}
+
+	/* Run calling thread on the CPUs, take its memory from their nodes */
+	int Apply() const;
+
+	/* Run calling thread on one CPU of the set, nIndex-th, wrapping around */
+	int Pin(unsigned int nIndex) const;
+
+	/* Run calling thread on nCPU only */
+	static int PinTo(int nCPU);
+
+private:
+	/* Add CPUs of list "0-3,8" to cCPUs */
+	static bool ParseList(const std::string& csList, cpu_set_t& cCPUs);
+
+	/* CPUs of a NUMA node, false if there is no such node */
+	static bool NodeCPUs(unsigned int nNode, cpu_set_t& cCPUs);
+
+private:
+	std::string m_csSpec;		/* as given, for the log */
+	cpu_set_t m_cCPUs;
+	unsigned int m_nCPUs;		/* CPUs in m_cCPUs, 0 if not placed */
+	uint64_t m_nNodes;			/* nodes having any of the CPUs, 0 if kernel has no NUMA */
+};
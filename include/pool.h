@@ -0,0 +1,158 @@
+#pragma once
+
+/*
+ * header files
+ */
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+/*
+ * Pages for pools and arenas
+ * mmap'ed straight from the kernel, on huge pages if enabled and available
+ */
+class CPages
+{
+public:
+	static void* Map(size_t nSize);
+	static void Unmap(void* pPages, size_t nSize);
+
+	/* Chunk size for pools and arenas, a huge page if enabled */
+	static size_t ChunkSize();
+
+	/* Back pools and arenas with huge pages, set before first allocation */
+	static inline void SetHugePages(bool bHugePages)
+	{
+		s_bHugePages = bHugePages;
+	}
+
+private:
+	static bool s_bHugePages;
+};
+
+/*
+ * Slab pool
+ * Objects of one size, carved from slabs, freed objects are kept on a free list
+ * Size is fixed by first allocation, pool is used by one thread
+ */
+class CSlabPool
+{
+public:
+	CSlabPool();
+	~CSlabPool();
+
+	void* Allocate(size_t nSize);
+	void Free(void* pObject);
+
+	/* Returns true if pool gives objects of nSize */
+	inline bool Fits(size_t nSize) const
+	{
+		return m_nObject == 0 || nSize == m_nObject;
+	}
+
+private:
+	int Grow();			/* add a slab, put its objects on free list */
+
+private:
+	struct CFree {
+		CFree* pNext;
+	};
+	struct CSlab {
+		CSlab* pNext;
+	};
+
+	size_t m_nObject;	/* object size, 0 until first allocation */
+	size_t m_nSize;		/* object size, rounded up for alignment */
+	CFree* m_pFree;		/* free objects */
+	CSlab* m_pSlabs;	/* slabs, freed with pool */
+};
+
+/*
+ * Arena
+ * Bump allocation for data, which lives until the round closes
+ * Reset takes all of it back at once, chunks are kept for next round
+ */
+class CArena
+{
+public:
+	CArena();
+	~CArena();
+
+	void* Allocate(size_t nSize, size_t nAlign = alignof(std::max_align_t));
+
+	template<typename T>
+	inline T* Allocate(size_t nCount)
+	{
+		return static_cast<T*>(Allocate(sizeof(T) * nCount, alignof(T)));
+	}
+
+	/* Take back everything allocated since last reset */
+	void Reset();
+
+private:
+	struct CChunk {
+		CChunk* pNext;
+		size_t nSize;
+	};
+
+	CChunk* m_pChunks;	/* all chunks, in order of use */
+	CChunk* m_pCurrent;	/* chunk being filled */
+	size_t m_nUsed;		/* bytes used in current chunk */
+};
+
+/*
+ * Allocator for node based containers, nodes come from a slab pool
+ * Arrays, and containers without a pool use the heap
+ */
+template<typename T>
+class CPoolAllocator
+{
+public:
+	typedef T value_type;
+
+	/* containers take the pool along, when assigned or swapped */
+	typedef std::true_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	CPoolAllocator(CSlabPool* pPool = NULL) : m_pPool(pPool) {}
+
+	template<typename U>
+	CPoolAllocator(const CPoolAllocator<U>& cOther) : m_pPool(cOther.GetPool()) {}
+
+	T* allocate(size_t nCount)
+	{
+		if (nCount == 1 && m_pPool != NULL && m_pPool->Fits(sizeof(T)))
+			return static_cast<T*>(m_pPool->Allocate(sizeof(T)));
+
+		return static_cast<T*>(::operator new(nCount * sizeof(T)));
+	}
+
+	void deallocate(T* pObject, size_t nCount)
+	{
+		if (nCount == 1 && m_pPool != NULL && m_pPool->Fits(sizeof(T)))
+			m_pPool->Free(pObject);
+		else
+			::operator delete(pObject);
+	}
+
+	inline CSlabPool* GetPool() const
+	{
+		return m_pPool;
+	}
+
+	template<typename U>
+	inline bool operator==(const CPoolAllocator<U>& cOther) const
+	{
+		return m_pPool == cOther.GetPool();
+	}
+
+	template<typename U>
+	inline bool operator!=(const CPoolAllocator<U>& cOther) const
+	{
+		return m_pPool != cOther.GetPool();
+	}
+
+private:
+	CSlabPool* m_pPool;	/* NULL, if objects come from heap */
+};
@@ -0,0 +1,292 @@
+#pragma once
+
+/*
+ * Text protocol between manager and bidders
+ *
+ * Every message is one line, terminated by '\n'
+ *   bidder -> manager  "<port>: <pid>: <auction>"
+ *                                         hello, sent once after connect
+ *                                         "<port>: <pid>" is auction DEFAULT_AUCTION
+ *   bidder -> manager  "<pid>: <bid>"     bid for the current round
+ *   bidder -> manager  "batch <pid>: <auction>=<bid> <auction>=<bid> ..."
+ *                                         bids on many auctions in one frame
+ *   bidder -> manager  "attr <pid>: <price> <delivery> <quality> <penalty>"
+ *                                         multi attribute bid, scored by manager
+ *   bidder -> manager  "proxy <pid>: <bid> <max> <step>"
+ *                                         manager bids for him from now on, raising by
+ *                                         step on every restart, up to max
+ *   manager -> bidder  "start <auction>.<round>"
+ *                                         start bidding in this round
+ *   manager -> bidder  "kill"             bidder is done
+ *   manager -> bidder  "price <bid> <pid>"
+ *                                         English auction, high bid so far and its bidder
+ *
+ * Between child and parent managers of a federation
+ *   child -> parent    "leaf <pid>: <auction>"
+ *                                         hello, sent once after connect
+ *   child -> parent    "ready <pid>: <bidders>"
+ *                                         bidders of the subtree have said hello
+ *   child -> parent    "top <pid>: <count> <bidder>=<score> ..."
+ *                                         best bids of the subtree in this round
+ *   parent -> child    "start"            start a round
+ *   parent -> child    "result <score> <winners>"
+ *                                         best score, and bidders who have it
+ *
+ * Between gateway and manager, one connection carries many virtual bidders
+ *   gateway -> manager "gateway <pid>: <auction>"
+ *                                         hello, sent once after connect
+ *   gateway -> manager "join <pid>: <id> <id> ..."
+ *                                         hello of virtual bidders
+ *   gateway -> manager "bids <pid>: <id>=<bid> <id>=<bid> ..."
+ *                                         bids of virtual bidders
+ *   manager -> gateway "start <auction>.<round>"
+ *                                         start bidding, for all of them
+ *   manager -> gateway "kill <id> <id> ..."
+ *                                         these virtual bidders are done
+ *
+ * Bids answering a start, and gateway bid frames, are tagged with its round
+ *   bidder -> manager  "@<auction>.<round> <message>"
+ *                                         manager drops it, unless the round is still open
+ * untagged messages are taken for the current round
+ *
+ * Parsing works on the receive buffer in place, nothing is allocated
+ */
+
+/*
+ * Round a bid is for, nRound 0 if untagged
+ */
+typedef struct round_tag {
+	unsigned int nAuction;
+	unsigned int nRound;
+} ROUND_TAG;
+
+/*
+ * Hello from bidder
+ */
+typedef struct hello {
+	unsigned short nPort;
+	pid_t nPID;
+	unsigned int nAuction;		/* auction the bidder joins */
+} HELLO;
+
+/*
+ * Bid from bidder
+ */
+typedef struct bid {
+	pid_t nPID;
+	unsigned int nBid;
+} BID;
+
+/*
+ * Multi attribute bid
+ */
+typedef struct bid_vector {
+	unsigned int nPrice;
+	unsigned int nDelivery;		/* days */
+	unsigned int nQuality;
+	unsigned int nPenalty;
+} BID_VECTOR;
+
+typedef struct attr_bid {
+	pid_t nPID;
+	BID_VECTOR cVector;
+} ATTR_BID;
+
+/*
+ * Proxy bidding agent, run by manager
+ */
+typedef struct proxy {
+	pid_t nPID;
+	unsigned int nBid;			/* bid of this round */
+	unsigned int nMax;			/* never bids more */
+	unsigned int nStep;			/* raise on every restart */
+} PROXY;
+
+/*
+ * Bundle bid of a combinatorial auction, all items or nothing
+ */
+typedef struct bundle {
+	pid_t nPID;
+	unsigned int nPrice;
+	unsigned int nItems;
+	unsigned int cItems[MAX_BUNDLE_ITEMS];
+} BUNDLE;
+
+/*
+ * Batch of bids from one bidder
+ */
+typedef struct auction_bid {
+	unsigned int nAuction;
+	unsigned int nBid;
+} AUCTION_BID;
+
+typedef struct batch {
+	pid_t nPID;
+	unsigned int nBids;
+	AUCTION_BID cBids[MAX_BATCH_BIDS];
+} BATCH;
+
+/*
+ * Hello from child manager
+ */
+typedef struct leaf_hello {
+	pid_t nPID;
+	unsigned int nAuction;
+} LEAF_HELLO;
+
+/*
+ * Child manager is ready
+ */
+typedef struct ready {
+	pid_t nPID;
+	unsigned int nBidders;
+} READY;
+
+/*
+ * One of the best bids
+ */
+typedef struct top_entry {
+	pid_t nPID;
+	double dScore;
+} TOP_ENTRY;
+
+/*
+ * Best bids of a child manager, highest first
+ */
+typedef struct top {
+	pid_t nPID;
+	unsigned int nEntries;
+	TOP_ENTRY cEntries[MAX_TOP_K];
+} TOP;
+
+/*
+ * Outcome of a round
+ */
+typedef struct result {
+	double dScore;
+	unsigned int nWinners;
+} RESULT;
+
+/*
+ * Hello from gateway
+ */
+typedef struct gateway_hello {
+	pid_t nPID;
+	unsigned int nAuction;
+} GATEWAY_HELLO;
+
+/*
+ * Virtual bidders of a gateway, joining or killed
+ */
+typedef struct id_list {
+	pid_t nPID;					/* gateway, 0 in kill */
+	unsigned int nIDs;
+	pid_t cIDs[MAX_BATCH_BIDS];
+} ID_LIST;
+
+/*
+ * Bids of virtual bidders
+ */
+typedef struct gateway_bids {
+	pid_t nPID;
+	unsigned int nBids;
+	BID cBids[MAX_BATCH_BIDS];
+} GATEWAY_BIDS;
+
+/*
+ * High bid of an English auction
+ */
+typedef struct price {
+	unsigned int nPrice;
+	pid_t nPID;
+} PRICE;
+
+/*
+ * Orders from manager
+ */
+enum _orders {
+	ORDER_UNKNOWN = 0,
+	ORDER_START,
+	ORDER_KILL
+};
+
+class CProtocol
+{
+public:
+	/* Find next complete message, returns bytes consumed or 0 if incomplete */
+	static size_t NextMessage(const char* pBuffer, size_t nSize, std::string_view& csMessage);
+
+	/* Parse messages, return ERR_SUCCESS or ERR_PROTOCOL */
+	static int ParseHello(std::string_view csMessage, HELLO& cHello);
+	static int ParseBid(std::string_view csMessage, BID& cBid);
+	static int ParseBatch(std::string_view csMessage, BATCH& cBatch);
+	static bool IsBatch(std::string_view csMessage);
+	static int ParseAttributes(std::string_view csMessage, ATTR_BID& cBid);
+	static bool IsAttributes(std::string_view csMessage);
+	static int ParseProxy(std::string_view csMessage, PROXY& cProxy);
+	static bool IsProxy(std::string_view csMessage);
+	static int ParseBundle(std::string_view csMessage, BUNDLE& cBundle);
+	static bool IsBundle(std::string_view csMessage);
+
+	/* Parse federation messages, return ERR_SUCCESS or ERR_PROTOCOL */
+	static int ParseLeaf(std::string_view csMessage, LEAF_HELLO& cHello);
+	static bool IsLeaf(std::string_view csMessage);
+	static int ParseReady(std::string_view csMessage, READY& cReady);
+	static bool IsReady(std::string_view csMessage);
+	static int ParseTop(std::string_view csMessage, TOP& cTop);
+	static bool IsTop(std::string_view csMessage);
+	static int ParseResult(std::string_view csMessage, RESULT& cResult);
+	static bool IsResult(std::string_view csMessage);
+
+	/* Parse gateway messages, return ERR_SUCCESS or ERR_PROTOCOL */
+	static int ParseGateway(std::string_view csMessage, GATEWAY_HELLO& cHello);
+	static bool IsGateway(std::string_view csMessage);
+	static int ParseJoin(std::string_view csMessage, ID_LIST& cJoin);
+	static bool IsJoin(std::string_view csMessage);
+	static int ParseGatewayBids(std::string_view csMessage, GATEWAY_BIDS& cBids);
+	static bool IsGatewayBids(std::string_view csMessage);
+	static int ParseKills(std::string_view csMessage, ID_LIST& cKills);
+
+	/* Format gateway frames, return length or 0 if it doesn't fit */
+	static size_t FormatJoin(char* pBuffer, size_t nSize, pid_t nPID, const pid_t* pIDs, unsigned int nIDs);
+	static size_t FormatGatewayBids(char* pBuffer, size_t nSize, pid_t nPID, const BID* pBids, unsigned int nBids);
+	static size_t FormatKills(char* pBuffer, size_t nSize, const pid_t* pIDs, unsigned int nIDs);
+	static size_t FormatBundle(char* pBuffer, size_t nSize, const BUNDLE& cBundle);
+
+	/* Format best bids, returns length or 0 if it doesn't fit */
+	static size_t FormatTop(char* pBuffer, size_t nSize, pid_t nPID, const TOP_ENTRY* pEntries, unsigned int nEntries);
+
+	/* Format batch frame, returns length or 0 if it doesn't fit */
+	static size_t FormatBatch(char* pBuffer, size_t nSize, pid_t nPID, const AUCTION_BID* pBids, unsigned int nBids);
+	static int ParseOrder(std::string_view csMessage);
+	static int ParseStart(std::string_view csMessage, ROUND_TAG& cTag);
+
+	/* Round tag in front of a bid, returns bytes of the tag and its space, 0 if untagged */
+	static size_t ParseTag(std::string_view csMessage, ROUND_TAG& cTag);
+
+	/* Format round tag, space included, returns length or 0 if untagged or it doesn't fit */
+	static size_t FormatTag(char* pBuffer, size_t nSize, const ROUND_TAG& cTag);
+	static int ParsePrice(std::string_view csMessage, PRICE& cPrice);
+	static int ParseTick(std::string_view csMessage, unsigned int& nPrice);
+	static int ParseBundles(std::string_view csMessage, unsigned int& nItems);
+
+private:
+	/* Split "<first>: <second>" */
+	static bool SplitPair(std::string_view csMessage, std::string_view& csFirst, std::string_view& csSecond);
+
+	/* Parse a decimal number, every character must be a digit */
+	template<typename T>
+	static bool ParseNumber(std::string_view csText, T& nValue);
+
+	/* Parse round "<auction>.<round>" */
+	static bool ParseRound(std::string_view csText, ROUND_TAG& cTag);
+
+	/* Parse ids "<id> <id> ...", at most MAX_BATCH_BIDS */
+	static bool ParseIDs(std::string_view csText, ID_LIST& cList);
+
+	/* Append " <id>" for every id, '\n' included */
+	static size_t FormatIDs(char* pBuffer, size_t nSize, size_t nUsed, const pid_t* pIDs, unsigned int nIDs);
+
+	/* Parse a score, it may be negative or have a fraction */
+	static bool ParseScore(std::string_view csText, double& dValue);
+};
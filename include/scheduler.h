@@ -0,0 +1,70 @@
+#pragma once
+
+/*
+ * header files
+ */
+#include <vector>
+
+typedef struct auction AUCTION;
+
+/*
+ * Jitter struct
+ * how late rounds were closed after their deadline, in ns
+ */
+typedef struct jitter {
+	uint64_t nCloses;
+	uint64_t nMin;
+	uint64_t nMax;
+	uint64_t nTotal;
+} JITTER;
+
+/*
+ * Earliest deadline first scheduler
+ * Open rounds in a binary heap on their deadline
+ * auction keeps its heap index, so a round is moved or removed in O(log n)
+ */
+class CScheduler
+{
+public:
+	CScheduler();
+
+	/* Schedule round of auction, or move it if scheduled */
+	void Schedule(AUCTION* pAuction, uint64_t nDeadline);
+
+	/* Remove round of auction, if scheduled */
+	void Cancel(AUCTION* pAuction);
+
+	/* Take the earliest round, if it's due at nNow, NULL otherwise */
+	AUCTION* PopDue(uint64_t nNow);
+
+	/* ms until earliest deadline for epoll_wait, -1 if nothing is scheduled */
+	int Timeout(uint64_t nNow) const;
+
+	/* Number of rounds due at nNow */
+	size_t CountDue(uint64_t nNow) const;
+
+	inline bool IsEmpty() const
+	{
+		return m_cHeap.empty();
+	}
+
+	/* Close time jitter */
+	void RecordClose(uint64_t nDeadline, uint64_t nClosed);
+	inline const JITTER& GetJitter() const
+	{
+		return m_cJitter;
+	}
+
+	/* monotonic clock, in ns */
+	static uint64_t Now();
+
+private:
+	void Place(size_t nIndex);			/* put entry at nIndex, and update its auction */
+	void SiftUp(size_t nIndex);
+	void SiftDown(size_t nIndex);
+	size_t CountDue(uint64_t nNow, size_t nIndex) const;
+
+private:
+	std::vector<AUCTION*> m_cHeap;		/* earliest deadline on top */
+	JITTER m_cJitter;
+};
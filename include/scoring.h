@@ -0,0 +1,38 @@
+#pragma once
+
+/*
+ * header files
+ */
+#include "protocol.h"
+
+/*
+ * Scoring engine
+ * Turns a bid vector in one score, higher score wins
+ * Score is called from scoring threads, it must not change the engine
+ */
+class CScoringEngine
+{
+public:
+	virtual ~CScoringEngine() {}
+
+	/* Score the bid vector */
+	virtual double Score(const BID_VECTOR& cVector) const = 0;
+};
+
+/*
+ * Weighted scoring
+ * quality earns points, price, delivery and penalties cost points
+ */
+class CWeightedScoring : public CScoringEngine
+{
+public:
+	CWeightedScoring(double dPrice = 1.0, double dDelivery = 2.0, double dQuality = 1.5, double dPenalty = 3.0);
+
+	virtual double Score(const BID_VECTOR& cVector) const;
+
+private:
+	double m_dPrice;		/* weight per price unit */
+	double m_dDelivery;		/* weight per delivery day */
+	double m_dQuality;		/* weight per quality point */
+	double m_dPenalty;		/* weight per penalty point */
+};
@@ -6,12 +6,35 @@
 #ifdef HAVE_NETINET_IN_H
 #include <netinet/in.h>
 #endif
+#ifdef HAVE_NETINET_TCP_H
+#include <netinet/tcp.h>
+#endif
 #ifdef HAVE_ARPA_INET_H
 #include <arpa/inet.h>
 #endif
 #ifdef HAVE_NETDB_H
 #include <netdb.h>
 #endif
+#ifdef HAVE_LINUX_NET_TSTAMP_H
+#include <linux/net_tstamp.h>
+#endif
+
+/*
+ * Socket options, SetOptions takes them or'ed
+ */
+enum _sock_options {
+	SOCK_OPT_NODELAY = 0x01,		/* TCP_NODELAY, small messages go out at once */
+	SOCK_OPT_QUICKACK = 0x02,		/* TCP_QUICKACK, kernel drops it, owner sets it again after reads */
+	SOCK_OPT_BUSY_POLL = 0x04,		/* SO_BUSY_POLL, spin on device queue before sleeping */
+	SOCK_OPT_SMALL_BUFFERS = 0x08,	/* SMALL_SOCKET_BUFFER, nothing waits long in a buffer */
+	SOCK_OPT_LARGE_BUFFERS = 0x10,	/* LARGE_SOCKET_BUFFER, bursts don't stall the sender */
+	SOCK_OPT_CORK = 0x20			/* owner corks writes with Cork, and uncorks once they are done */
+};
+
+/* Tuning profiles, sets of options */
+const unsigned int SOCK_PROFILE_DEFAULT = 0;
+const unsigned int SOCK_PROFILE_LOW_LATENCY = SOCK_OPT_NODELAY | SOCK_OPT_QUICKACK | SOCK_OPT_BUSY_POLL | SOCK_OPT_SMALL_BUFFERS;
+const unsigned int SOCK_PROFILE_THROUGHPUT = SOCK_OPT_LARGE_BUFFERS | SOCK_OPT_CORK;
 
 class CSocket
 {
@@ -24,6 +47,9 @@ public:
 	int GetSockHandle();
 	void SetSockHandle(int nSocket);
 
+	/* Give up the handle without closing it */
+	int Detach();
+
 	/* Returns true if socket is open */
 	bool IsOpen();
 	
@@ -32,6 +58,19 @@ public:
 	bool Connect(const char* lpszHostAddress, unsigned short uHostPort);
 	void Close();
 	bool ReuseAddress();
+	bool ReusePort();
+
+	/* Share the port with other sockets, set before Create */
+	inline void SetReusePort(bool bReusePort)
+	{
+		m_bReusePort = bReusePort;
+	}
+
+	/* Options set by Create and Connect, before bind or connect, so buffers are in the handshake */
+	inline void SetProfile(unsigned int nOptions)
+	{
+		m_nOptions = nOptions;
+	}
 
 	/* Read from the socket. */
 	bool Listen(int nConnectionBacklog = SOMAXCONN);
@@ -44,11 +83,34 @@ public:
 	ssize_t Send(const void* lpBuffer, int nBufferLen, int nFlags = 0);
 	ssize_t Receive(void* lpBuffer, int nBufferLen, int nFlags = 0, int timeout = 0);
 
+	/* Set socket options, any of them failing leaves the others set */
 	bool SetOptions(unsigned int nFlags);
+	static bool SetOptions(int nSocket, unsigned int nFlags);
+
+	/* Hold partial frames back while writes are queued, uncorking sends them */
+	static bool Cork(int nSocket, bool bCork);
+
+	/* Ack what is read at once, until kernel falls back to delayed acks */
+	static bool QuickAck(int nSocket);
+
+	/*
+	 * Kernel stamps received data, software stamps always, hardware ones where NIC makes them
+	 * accepted sockets inherit it from the listener
+	 */
+	bool EnableTimestamps();
+
+	/* Receive on any socket handle, nStamp is CLOCK_REALTIME ns of its latest segment, 0 if not stamped */
+	static ssize_t ReceiveStamped(int nSocket, void* lpBuffer, size_t nBufferLen, uint64_t& nStamp, int nFlags = 0);
+
+	/* Switch socket between blocking and non-blocking mode */
+	bool SetNonBlocking(bool bNonBlocking = true);
+	static bool SetNonBlocking(int nSocket, bool bNonBlocking = true);
 
 private:
 	int m_nSocket;		/* Socket Handle. */
 	bool m_bReuse;		/* reuse address */
+	bool m_bReusePort;	/* SO_REUSEPORT, listeners of all shards share the port */
+	unsigned int m_nOptions;	/* SOCK_OPT_ options set on create or connect */
 
 	/* Binding code etc called from within Create. */
 	bool InitializeSocket(unsigned short uPort, const char* pSocketAddress);
@@ -0,0 +1,84 @@
+#pragma once
+
+/*
+ * header files
+ */
+#include <bitset>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "threadpool.h"
+
+/* Items of a combinatorial auction, bit n is item n */
+typedef std::bitset<MAX_ITEMS> ITEM_MASK;
+
+/*
+ * Bundle bid
+ * bidder pays nPrice for all of cItems, or nothing
+ */
+typedef struct bundle_bid {
+	pid_t nPID;
+	unsigned int nPrice;
+	ITEM_MASK cItems;
+} BUNDLE_BID;
+
+/*
+ * Solution struct
+ * bids, which win, and how the search went
+ */
+typedef struct solution {
+	std::vector<size_t> cWinners;	/* indexes of winning bids */
+	uint64_t nRevenue;			/* sum of winning prices */
+	uint64_t nNodes;			/* search nodes visited */
+	uint64_t nTime;				/* ns spent */
+	bool bOptimal;				/* search finished, otherwise best found in budget */
+} SOLUTION;
+
+/*
+ * Winner determination of a combinatorial auction
+ * Branch and bound over bids sorted by price per item
+ * a branch is cut, once free items at the best remaining price per item can't beat the incumbent
+ * subtrees of first included bid are searched in parallel, incumbent is shared
+ */
+class CWinnerSolver
+{
+public:
+	CWinnerSolver(unsigned int nThreads = 0);	/* 0 is one thread per core */
+	~CWinnerSolver();
+
+	/* Find non overlapping bids of most revenue, in nBudget ns */
+	int Solve(const BUNDLE_BID* pBids, size_t nBids, uint64_t nBudget, SOLUTION& cSolution);
+
+private:
+	/* Take bids in order while they fit, first incumbent */
+	void Greedy();
+
+	/* Search subtrees, whose first bid is taken from m_nNextRoot */
+	void Worker();
+
+	/* Depth first search from bid nNext, with items cUsed taken */
+	void Search(size_t nNext, ITEM_MASK& cUsed, uint64_t nValue, std::vector<size_t>& cChosen, uint64_t& nNodes);
+
+	/* Offer a solution as incumbent */
+	void Offer(uint64_t nValue, const std::vector<size_t>& cChosen);
+
+private:
+	CThreadPool m_cPool;				/* search threads */
+	const BUNDLE_BID* m_pBids;			/* bids being solved */
+	std::vector<size_t> m_cOrder;		/* bids by price per item, best first */
+	std::vector<double> m_cDensity;		/* price per item of m_cOrder */
+	std::vector<uint64_t> m_cSuffix;	/* sum of prices from m_cOrder[n] on */
+	size_t m_nItems;					/* items, somebody has bid on */
+	std::atomic<uint64_t> m_nBest;		/* revenue of incumbent */
+	std::mutex m_cBestLock;				/* guards m_cBest */
+	std::vector<size_t> m_cBest;		/* incumbent, indexes of m_cOrder */
+	std::atomic<size_t> m_nNextRoot;	/* next subtree to search */
+	std::atomic<bool> m_bStop;			/* budget is over */
+	std::atomic<uint64_t> m_nNodes;		/* nodes of all workers */
+	uint64_t m_nDeadline;				/* budget is over at, CScheduler::Now() time */
+	std::mutex m_cDoneLock;				/* Solve waits on m_cDone for workers */
+	std::condition_variable m_cDone;
+	unsigned int m_nRunning;			/* workers not finished */
+};
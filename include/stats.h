@@ -0,0 +1,43 @@
+#pragma once
+
+/*
+ * header files
+ */
+#include <vector>
+
+/* Histogram bins, bin 0 is bid 0, bin n is bids from 2^(n-1) to 2^n - 1 */
+const unsigned int HISTOGRAM_BINS = 33;
+
+/*
+ * Bid statistics of an auction
+ * Count, min, max and mean, quantiles from a DDSketch, and a log2 histogram
+ * a bid is added in O(1), memory doesn't grow with bids
+ */
+class CBidStats
+{
+public:
+	CBidStats();
+
+	/* Take one more bid */
+	void Add(unsigned int nBid);
+
+	inline uint64_t GetCount() const
+	{
+		return m_nCount;
+	}
+
+	/* Bid at quantile dQuantile from 0 to 1, within sketch accuracy */
+	double Quantile(double dQuantile) const;
+
+	/* Log the distribution of auction's bids */
+	void Log(unsigned int nAuction) const;
+
+private:
+	uint64_t m_nCount;
+	unsigned int m_nMin;
+	unsigned int m_nMax;
+	uint64_t m_nSum;
+	uint64_t m_nZero;					/* bids of 0, sketch can't take them */
+	std::vector<uint64_t> m_cBuckets;	/* DDSketch, bucket n has bids from gamma^(n-1) to gamma^n */
+	uint64_t m_cHistogram[HISTOGRAM_BINS];
+};
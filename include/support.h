@@ -34,18 +34,97 @@
 #ifdef HAVE_SYS_WAIT_H
 #include <sys/wait.h>
 #endif
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
+#ifdef HAVE_SYS_TIMERFD_H
+#include <sys/timerfd.h>
+#endif
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+#ifdef HAVE_SYS_SIGNALFD_H
+#include <sys/signalfd.h>
+#endif
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
+#ifdef HAVE_SCHED_H
+#include <sched.h>
+#endif
+#ifdef HAVE_LINUX_MEMPOLICY_H
+#include <linux/mempolicy.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_TIME_H
+#include <time.h>
+#endif
 
 #include <string>
+#include <string_view>
+#include <charconv>
 #include <list>
+#include <deque>
 #include <map>
+#include <algorithm>
+#include <vector>
 
 #define INVALID_SOCKET -1								/* Invalid socket handle */
 #define MAX_MESSAGE_SIZE 200							/* Maximum message size between manager and bidders */
 #define MAX_MESSAGE_SIZE_2 MAX_MESSAGE_SIZE * 2			/* Maximum2 message size between manager and bidders */
+#define MAX_FRAME_SIZE 1024								/* Maximum batch frame size between manager and bidders */
 
 const int DEFAULT_MANAGER_PORT = 5000;					/* Default manager port */
 const int DEFAULT_BIDDERS = 3;							/* Default bidders */
 const int MAX_BIDDERS = 20;								/* Maximum bidders */
+const unsigned int DEFAULT_AUCTION = 1;				/* Auction id, when bidder doesn't give one */
+const unsigned int MAX_BATCH_BIDS = 32;					/* Maximum bids in one batch frame */
+const int MAX_EPOLL_EVENTS = 64;						/* Events returned by one epoll_wait */
+const size_t OUTBOUND_LOW_WATER = 16 * 1024;			/* Queued bytes after which a bidder is degraded */
+const size_t OUTBOUND_HIGH_WATER = 256 * 1024;			/* Queued bytes after which a bidder is disconnected */
+const int DRAIN_TIMEOUT = 5;							/* Seconds to flush queued data before exit */
+const size_t CACHE_LINE_SIZE = 64;						/* Fields written by different threads are this far apart */
+const size_t SCORE_QUEUE_SIZE = 4096;					/* Scores in flight from scoring threads, power of 2 */
+const size_t JOB_QUEUE_SIZE = 1024;						/* Fixed jobs queued on one worker of a thread pool, power of 2 */
+const size_t HANDOFF_QUEUE_SIZE = 256;					/* Connections in flight between shards, power of 2 */
+const size_t ROUTE_QUEUE_SIZE = 1024;					/* Batch entries in flight between shards, power of 2 */
+const size_t MAX_DEQUEUE_BATCH = 16;					/* Items taken from a queue in one go */
+const size_t POOL_CHUNK_SIZE = 64 * 1024;				/* Slab and arena chunk */
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;			/* Slab and arena chunk on huge pages */
+const size_t NOT_SCHEDULED = (size_t) -1;				/* Heap index of a round without deadline */
+const unsigned int MAX_CLOSES_PER_LOOP = 16;			/* Due rounds closed between two epoll_waits */
+const unsigned int MAX_TOP_K = 16;						/* Most bids a manager reports to its parent */
+const unsigned int DEFAULT_TOP_K = 4;					/* Bids a manager reports to its parent */
+const unsigned int PRICE_FLUSH_INTERVAL = 5;			/* ms, English high bids are sent at most this often */
+const unsigned int DEFAULT_CLOSE_TIME = 1000;			/* ms without a higher bid, before English auction closes */
+const unsigned int DUTCH_START_PRICE = 200;				/* Dutch auction clock starts here */
+const unsigned int DUTCH_TICK_STEP = 1;				/* Dutch auction clock goes down by this on every tick */
+const unsigned int DEFAULT_TICK_TIME = 1000;			/* us between two ticks of Dutch auction clock */
+const unsigned int MAX_ITEMS = 256;						/* Items of a combinatorial auction */
+const unsigned int DEFAULT_ITEMS = 64;					/* Items of a combinatorial auction, unless told */
+const unsigned int MAX_BUNDLE_ITEMS = 16;				/* Items in one bundle bid */
+const unsigned int SOLVER_TIME_BUDGET = 200;			/* ms winner determination may take, best so far wins after it */
+const unsigned int HISTORY_BLOCK_ROWS = 4096;			/* Bids a manager buffers, before it writes them to history */
+const int SMALL_SOCKET_BUFFER = 16 * 1024;				/* Send and receive buffer of low latency sockets */
+const int LARGE_SOCKET_BUFFER = 4 * 1024 * 1024;		/* Send and receive buffer of throughput sockets, kernel may cap it */
+const int BUSY_POLL_TIME = 50;							/* us low latency sockets spin on device queue, before they sleep */
+const unsigned int SPIN_START_TIME = 100;				/* us a busy polling manager spins, before it sleeps in epoll */
+const unsigned int SPIN_MIN_TIME = 10;					/* us it spins at least, however idle it is */
+const unsigned int SPIN_MAX_TIME = 2000;				/* us it spins at most, however busy it is */
 
 /* error codes */
 enum _err_codes {
@@ -72,7 +151,14 @@ enum _err_codes {
 	ERR_INVALID_PORT = -18,
 	ERR_FORK_FAILED = -19,
 	ERR_GET_SOCK_NAME = -20,
-	ERR_KEEP_WAITING = -21
+	ERR_KEEP_WAITING = -21,
+	ERR_SLOW_CONSUMER = -22,
+	ERR_EPOLL = -23,
+	ERR_PROTOCOL = -24,
+	ERR_FEED = -25,
+	ERR_HISTORY = -26,
+	ERR_SIGNAL = -27,
+	ERR_PLACEMENT = -28
 };
 
 /* macros for checking and testing a value */
@@ -0,0 +1,76 @@
+#pragma once
+
+/*
+ * header files
+ */
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <functional>
+
+/* Bytes of arguments a fixed job carries */
+const size_t POOL_JOB_ARGS = 32;
+
+/*
+ * Fixed job, queued and run without allocating
+ * pRun gets pContext, which outlives the job, and the job's copy of its arguments
+ */
+typedef struct pool_job {
+	void (*pRun)(void* pContext, const void* pArgs);
+	void* pContext;
+	alignas(8) unsigned char cArgs[POOL_JOB_ARGS];
+} POOL_JOB;
+
+static_assert((JOB_QUEUE_SIZE & (JOB_QUEUE_SIZE - 1)) == 0, "ring of fixed jobs must be a power of 2");
+
+/*
+ * Work stealing thread pool
+ * Every worker has its own queue and ring of fixed jobs, it takes newest job from their back
+ * an idle worker steals oldest job from front of other queues and rings
+ */
+class CThreadPool
+{
+public:
+	CThreadPool(unsigned int nThreads = 0);	/* 0 is one thread per core */
+	~CThreadPool();
+
+	/* Queue a job, from a worker it goes on worker's own queue */
+	void Submit(std::function<void()> cJob);
+
+	/* Queue a fixed job, returns false if every ring is full. Any thread */
+	bool TrySubmit(const POOL_JOB& cJob);
+
+	inline unsigned int GetThreads() const
+	{
+		return m_cWorkers.size();
+	}
+
+private:
+	/* Queue and ring of one worker, both under its lock */
+	struct CWorker {
+		std::mutex cLock;
+		std::deque<std::function<void()> > cJobs;
+		POOL_JOB cFixed[JOB_QUEUE_SIZE];	/* fixed jobs from nFirst to nLast, positions wrap */
+		size_t nFirst;
+		size_t nLast;
+	};
+
+	void Run(unsigned int nWorker);							/* worker thread */
+	bool Pop(unsigned int nWorker, std::function<void()>& cJob);	/* take from own queue */
+	bool Steal(unsigned int nWorker, std::function<void()>& cJob);	/* take from other queues */
+	bool PushFixed(unsigned int nWorker, const POOL_JOB& cJob);	/* put on a ring, false if it is full */
+	bool PopFixed(unsigned int nWorker, POOL_JOB& cJob);		/* take from own ring */
+	bool StealFixed(unsigned int nWorker, POOL_JOB& cJob);		/* take from other rings */
+
+private:
+	std::vector<CWorker> m_cWorkers;		/* worker queues */
+	std::vector<std::thread> m_cThreads;	/* worker threads */
+	std::mutex m_cSleepLock;				/* idle workers sleep on m_cWake */
+	std::condition_variable m_cWake;
+	std::atomic<unsigned int> m_nPending;	/* queued jobs */
+	std::atomic<unsigned int> m_nNext;		/* round robin for jobs from outside */
+	bool m_bStop;							/* pool is shutting down */
+};
@@ -0,0 +1,150 @@
+/* Headers */
+#include "support.h"
+#include "log.h"
+#include "manager.h"
+
+/* glibc allocator, under the counting one */
+extern "C" {
+void* __libc_malloc(size_t nSize);
+void* __libc_calloc(size_t nCount, size_t nSize);
+void* __libc_realloc(void* pMemory, size_t nSize);
+void* __libc_memalign(size_t nAlign, size_t nSize);
+}
+
+/* Bids taken before counting, pools and queues reach their size */
+static const unsigned int WARMUP_BIDS = 10000;
+
+/* Bids counted */
+static const unsigned int COUNTED_BIDS = 100000;
+
+/* Bidders of the auction, all but the first stay silent, so the round stays open */
+static const pid_t FIRST_BIDDER = 101;
+static const unsigned int TEST_BIDDERS = 4;
+
+/* Bid messages, cycled through */
+static const unsigned int TEST_MESSAGES = 64;
+
+static std::atomic<bool> g_bCounting(false);
+static std::atomic<uint64_t> g_nAllocs(0);
+
+/*
+ * Every allocation of every thread goes through here
+ * operator new of libstdc++ ends up in malloc too
+ */
+extern "C" void* malloc(size_t nSize)
+{
+	if (g_bCounting.load(std::memory_order_relaxed))
+		++ g_nAllocs;
+	return __libc_malloc(nSize);
+}
+
+extern "C" void* calloc(size_t nCount, size_t nSize)
+{
+	if (g_bCounting.load(std::memory_order_relaxed))
+		++ g_nAllocs;
+	return __libc_calloc(nCount, nSize);
+}
+
+extern "C" void* realloc(void* pMemory, size_t nSize)
+{
+	if (g_bCounting.load(std::memory_order_relaxed))
+		++ g_nAllocs;
+	return __libc_realloc(pMemory, nSize);
+}
+
+extern "C" void* aligned_alloc(size_t nAlign, size_t nSize)
+{
+	if (g_bCounting.load(std::memory_order_relaxed))
+		++ g_nAllocs;
+	return __libc_memalign(nAlign, nSize);
+}
+
+extern "C" int posix_memalign(void** pMemory, size_t nAlign, size_t nSize)
+{
+	if (g_bCounting.load(std::memory_order_relaxed))
+		++ g_nAllocs;
+	*pMemory = __libc_memalign(nAlign, nSize);
+	return *pMemory == NULL ? ENOMEM : 0;
+}
+
+/*
+ * Allocation test
+ * one bidder of a started auction sends sealed and multi attribute bids,
+ * they are scored on scoring threads; after warm-up nothing may be allocated
+ */
+class CAllocTest
+{
+public:
+	static int Run()
+	{
+		CWeightedScoring cScoring;
+		CManager cManager(TEST_BIDDERS);
+		cManager.SetScoring(&cScoring, 2);
+		cManager.AddAuction(1);
+
+		AUCTION* pAuction = cManager.FindAuction(1);
+		for (unsigned int nBidder = 0; nBidder < TEST_BIDDERS; ++ nBidder)
+			cManager.AddBidder(*pAuction, FIRST_BIDDER + nBidder);
+		pAuction->bStarted = true;
+		pAuction->nRound = 1;
+		if (cManager.StartScoring() != ERR_SUCCESS)
+			return 1;
+
+		CONN cConn = {};
+		cConn.nSocket = INVALID_SOCKET;
+		cConn.nPID = FIRST_BIDDER;
+		cConn.nAuction = 1;
+
+		/* half sealed bids, half multi attribute ones */
+		char cMessages[TEST_MESSAGES][MAX_MESSAGE_SIZE];
+		size_t nLengths[TEST_MESSAGES];
+		for (unsigned int nMessage = 0; nMessage < TEST_MESSAGES; ++ nMessage) {
+			if (nMessage % 2 == 0)
+				nLengths[nMessage] = snprintf(cMessages[nMessage], MAX_MESSAGE_SIZE, "%d: %u",
+					FIRST_BIDDER, 1 + nMessage * 37);
+			else
+				nLengths[nMessage] = snprintf(cMessages[nMessage], MAX_MESSAGE_SIZE, "attr %d: %u %u %u %u",
+					FIRST_BIDDER, 1 + nMessage * 37, nMessage % 10, nMessage % 7, nMessage % 3);
+		}
+
+		for (unsigned int nBid = 0; nBid < WARMUP_BIDS + COUNTED_BIDS; ++ nBid) {
+			if (nBid == WARMUP_BIDS)
+				g_bCounting = true;
+
+			unsigned int nMessage = nBid % TEST_MESSAGES;
+			int nRes = cManager.HandleMessage(cConn, std::string_view(cMessages[nMessage], nLengths[nMessage]));
+			if (nRes != ERR_SUCCESS) {
+				g_bCounting = false;
+				err_printf("Bid %u failed with %d", nBid, nRes);
+				return 1;
+			}
+
+			/* collect scores as the loop would, on its score event */
+			if (nMessage == TEST_MESSAGES - 1) {
+				while (pAuction->nScoring != 0) {
+					cManager.ScoresReady();
+					std::this_thread::yield();
+				}
+			}
+		}
+		g_bCounting = false;
+
+		uint64_t nAllocs = g_nAllocs;
+		log_message("%u bids after %u of warm-up, %llu allocations", COUNTED_BIDS, WARMUP_BIDS,
+			(unsigned long long) nAllocs);
+		if (pAuction->cStats.GetCount() != WARMUP_BIDS + COUNTED_BIDS) {
+			err_printf("Auction took %llu bids", (unsigned long long) pAuction->cStats.GetCount());
+			return 1;
+		}
+
+		return nAllocs == 0 ? 0 : 1;
+	}
+};
+
+/*
+ * main program
+ */
+int main()
+{
+	return CAllocTest::Run();
+}
@@ -0,0 +1,129 @@
+/*
+ * header files
+ */
+#include "support.h"
+#include "log.h"
+#include "auctionhouse.h"
+
+/*
+ * Constructor
+ */
+CAuctionHouse::CAuctionHouse(unsigned int nAuctions, unsigned int nBidders/* = DEFAULT_BIDDERS*/,
+	unsigned int nShards/* = 0*/, unsigned short nPort/* = DEFAULT_MANAGER_PORT*/)
+{
+	m_nAuctions = nAuctions ? nAuctions : 1;
+	m_nBidders = nBidders;
+	m_nPort = nPort;
+	m_bCoroutines = false;
+	m_nJoin = 1;
+	m_bProxies = false;
+	m_bTimestamps = false;
+	m_nProfile = SOCK_PROFILE_DEFAULT;
+	m_nSpinCPU = -1;
+	m_pManagerCPUs = NULL;
+	m_pBidderCPUs = NULL;
+	m_nMode = MODE_SEALED;
+	m_nTickTime = DEFAULT_TICK_TIME;
+	m_nItems = DEFAULT_ITEMS;
+	m_nGateways = 0;
+	m_cQuorum.nRule = QUORUM_ALL;
+	m_cQuorum.nValue = 0;
+	m_nRoundTime = 0;
+	m_pScoring = NULL;
+	m_pFeed = NULL;
+	m_pHistory = NULL;
+	m_nThreads = 0;
+
+	if (nShards == 0)
+		nShards = std::thread::hardware_concurrency();
+	if (nShards == 0)
+		nShards = 1;
+	if (nShards > m_nAuctions)
+		nShards = m_nAuctions;	/* a shard without auction has nothing to do */
+
+	for (unsigned int nShard = 0; nShard < nShards; ++ nShard)
+		m_cShards.push_back(new CManager(nBidders, nPort));
+}
+
+/*
+ * Destructor
+ */
+CAuctionHouse::~CAuctionHouse()
+{
+	for (size_t nShard = 0; nShard < m_cShards.size(); ++ nShard)
+		delete m_cShards[nShard];
+}
+
+/*
+ * Start all auctions
+ * Bidders are forked before any shard thread runs
+ */
+int CAuctionHouse::Start()
+{
+	int nRes = 0;
+	debug_log("Entering %s ...", __FUNCTION__);
+	try {
+		/*
+		 * Every shard listens, before any bidder connects
+		 */
+		for (size_t nShard = 0; nShard < m_cShards.size(); ++ nShard) {
+			CManager* pShard = m_cShards[nShard];
+			pShard->SetShards(&m_cShards, nShard);
+			pShard->SetCoroutineBidders(m_bCoroutines);
+			pShard->SetGateways(m_nGateways);
+			pShard->SetProxyBidders(m_bProxies);
+			pShard->SetMode(m_nMode);
+			pShard->SetTickTime(m_nTickTime);
+			pShard->SetItems(m_nItems);
+			pShard->SetQuorum(m_cQuorum);
+			pShard->SetRoundTime(m_nRoundTime);
+			if (m_pScoring != NULL)
+				pShard->SetScoring(m_pScoring, m_nThreads);
+			pShard->SetFeed(m_pFeed);
+			pShard->SetHistory(m_pHistory);
+			pShard->SetTimestamps(m_bTimestamps);
+			pShard->SetProfile(m_nProfile);
+			pShard->SetBusyPoll(m_nSpinCPU < 0 ? -1 : m_nSpinCPU + (int) nShard);
+			pShard->SetPlacement(m_pManagerCPUs, m_pBidderCPUs);
+			pShard->SetAuctionsPerBidder(m_nJoin, m_nAuctions);
+
+			nRes = pShard->Listen();
+			if (nRes != ERR_SUCCESS)
+				throw nRes;
+		}
+
+		for (unsigned int nAuction = 1; nAuction <= m_nAuctions; ++ nAuction)
+			m_cShards[nAuction % m_cShards.size()]->AddAuction(nAuction);
+
+		log_message("%u auctions on %zu shards.", m_nAuctions, m_cShards.size());
+
+		for (size_t nShard = 0; nShard < m_cShards.size(); ++ nShard) {
+			if (m_nGateways != 0)
+				nRes = m_cShards[nShard]->CreateGateways();
+			else if (m_bCoroutines)
+				nRes = m_cShards[nShard]->CreateCoBidders();
+			else
+				nRes = m_cShards[nShard]->CreateBidders();
+			if (nRes != ERR_SUCCESS)
+				throw nRes;
+		}
+
+		/*
+		 * Run the shards
+		 */
+		std::vector<std::thread> cThreads;
+		for (size_t nShard = 0; nShard < m_cShards.size(); ++ nShard)
+			cThreads.emplace_back(&CManager::AcceptBidders, m_cShards[nShard], 0);
+
+		for (size_t nThread = 0; nThread < cThreads.size(); ++ nThread)
+			cThreads[nThread].join();
+	}
+	catch (std::exception e) {
+		perr_printf(e.what());
+	}
+	catch (...) {
+		err_printf("Unknown Exception...");
+	}
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	return nRes;
+}
@@ -4,6 +4,7 @@
  */
 #include "support.h"
 #include "log.h"
+#include "protocol.h"
 #include "bidder.h"
 
 /*
@@ -13,6 +14,17 @@ CBidder::CBidder(std::string csServer, unsigned short nServerPort)
 {
 	m_csServer = csServer;
 	m_nServerPort = nServerPort;
+	m_nInput = 0;
+	m_nAuction = DEFAULT_AUCTION;
+	m_cAuctions.push_back(DEFAULT_AUCTION);
+	m_bMultiAttribute = false;
+	m_bProxy = false;
+	m_nValue = 0;
+	m_nRaise = 0;
+	m_bAccepted = false;
+	m_cTag.nAuction = 0;
+	m_cTag.nRound = 0;
+	m_nItems = 0;
 	SetPID(getpid());
 }
 
@@ -36,6 +48,8 @@ int CBidder::Init()
 	unsigned short uSockPort = 0;
 
 	try {
+		srand(time(NULL) ^ (GetPID() << 16));		/* once, bids of a bidder differ from other bidders' and from each other */
+
 		debug_log("Creating client");
 		if (!m_cSocket.Connect(m_csServer.c_str(), m_nServerPort)) {		/* Connect to manager */
 
@@ -53,8 +67,8 @@ int CBidder::Init()
 			throw nRes;
 		}
 
-		/* send bidder port and pid number */
-		sprintf(cBuffer, "%d: %d", uSockPort, GetPID());
+		/* send bidder port, pid number and auction */
+		sprintf(cBuffer, "%d: %d: %u\n", uSockPort, GetPID(), m_nAuction);
 		debug_log("sending to server: %s", cBuffer);			/* log the message for debugging */
 
 		nRes = m_cSocket.Send(cBuffer, strlen(cBuffer), 0);		/* send the data to manager */
@@ -76,20 +90,98 @@ int CBidder::Init()
 	return nRes;
 }
 
+/*
+ * Join an auction, plain bids go to it
+ */
+void CBidder::SetAuction(unsigned int nAuction)
+{
+	m_nAuction = nAuction;
+	m_cAuctions.clear();
+	m_cAuctions.push_back(nAuction);
+}
+
+/*
+ * Bid on one more auction
+ */
+void CBidder::AddAuction(unsigned int nAuction)
+{
+	m_cAuctions.push_back(nAuction);
+}
+
 /*
  * Send the bid to manager
+ * Bids on many auctions go in batch frames, one send per frame
  */
 int CBidder::SendBid()
 {
 	int nRes = 0;
-	char cMessage[MAX_MESSAGE_SIZE_2] = { 0 };
+	char cMessage[MAX_FRAME_SIZE] = { 0 };
 	debug_log("Entering %s ...", __FUNCTION__);
 	try {
-		srand(time(NULL) ^ (GetPID() << 16));		/* Make a random bid from other bidders */
-		int nBid = rand() % 100;
-		sprintf(cMessage, "%d: %d", GetPID(), nBid);
-		debug_log(cMessage);
-		nRes = m_cSocket.Send(cMessage, strlen(cMessage), 0);	/* send the bid and pid to manager */
+		size_t nTag = CProtocol::FormatTag(cMessage, sizeof(cMessage), m_cTag);	/* round we bid in */
+		if (m_nItems != 0) {
+			/*
+			 * Bundle of neighbouring items, priced item by item
+			 */
+			BUNDLE cBundle;
+			unsigned int nItem = rand() % m_nItems;
+			cBundle.nPID = GetPID();
+			cBundle.nPrice = 0;
+			cBundle.nItems = 1 + rand() % std::min(MAX_BUNDLE_ITEMS, m_nItems);
+			for (unsigned int nIndex = 0; nIndex < cBundle.nItems; ++ nIndex) {
+				cBundle.cItems[nIndex] = (nItem + nIndex) % m_nItems;
+				cBundle.nPrice += 5 + rand() % 20;
+			}
+			size_t nSize = CProtocol::FormatBundle(cMessage + nTag, sizeof(cMessage) - nTag, cBundle);
+			debug_log(cMessage);
+			nRes = m_cSocket.Send(cMessage, nTag + nSize, 0);
+		}
+		else if (m_bMultiAttribute) {
+			/*
+			 * price, delivery days, quality and penalty
+			 */
+			sprintf(cMessage + nTag, "attr %d: %d %d %d %d\n", GetPID(), rand() % 100, rand() % 30, rand() % 100, rand() % 10);
+			debug_log(cMessage);
+			nRes = m_cSocket.Send(cMessage, strlen(cMessage), 0);	/* send the bid vector to manager */
+		}
+		else if (m_nRaise != 0) {
+			/*
+			 * Raise in English auction, or take the price in Dutch auction
+			 */
+			sprintf(cMessage + nTag, "%d: %u\n", GetPID(), m_nRaise);
+			debug_log(cMessage);
+			nRes = m_cSocket.Send(cMessage, strlen(cMessage), 0);
+			m_nRaise = 0;
+		}
+		else if (m_cAuctions.size() == 1 && m_cAuctions.front() == m_nAuction) {
+			int nBid = rand() % 100;
+			if (m_bProxy)
+				sprintf(cMessage + nTag, "proxy %d: %d %d %d\n", GetPID(), nBid, nBid + rand() % 50, 1 + rand() % 5);
+			else
+				sprintf(cMessage + nTag, "%d: %d\n", GetPID(), nBid);
+			debug_log(cMessage);
+			nRes = m_cSocket.Send(cMessage, strlen(cMessage), 0);	/* send the bid and pid to manager */
+		}
+		else {
+			/* batch has bids of many auctions, it isn't tagged */
+			AUCTION_BID cBids[MAX_BATCH_BIDS];
+			unsigned int nBids = 0;
+			std::list<unsigned int>::const_iterator cIter = m_cAuctions.begin();
+			while (cIter != m_cAuctions.end() && nRes >= 0) {
+				cBids[nBids].nAuction = *cIter;
+				cBids[nBids].nBid = rand() % 100;
+				++ nBids;
+				++ cIter;
+
+				if (nBids == MAX_BATCH_BIDS || cIter == m_cAuctions.end()) {
+					/* frame is full, or no more auctions */
+					size_t nSize = CProtocol::FormatBatch(cMessage, sizeof(cMessage), GetPID(), cBids, nBids);
+					debug_log(cMessage);
+					nRes = m_cSocket.Send(cMessage, nSize, 0);	/* send the batch to manager */
+					nBids = 0;
+				}
+			}
+		}
 	}
 	catch (std::exception e) {
 
@@ -114,32 +206,90 @@ int CBidder::RecieveOrder(int nTimeout/* = 0*/)
 {
 	int nRes = 0;
 	debug_log("Entering %s ...", __FUNCTION__);
-	char cBuffer[MAX_MESSAGE_SIZE_2] = { 0 };
 	try {
-		nRes = m_cSocket.Receive(cBuffer, MAX_MESSAGE_SIZE_2, 0, nTimeout);		/* Receive the data from manager */
-		if (nRes > 0) {
-			debug_log("recieved %d bytes \"%s\"", nRes, cBuffer);
-			if (strncasecmp(cBuffer, "kill", nRes) == 0) {
+		std::string_view csOrder;
+		size_t nUsed = CProtocol::NextMessage(m_cInput, m_nInput, csOrder);
+		if (nUsed == 0) {
+			/*
+			 * No complete order buffered, receive the data from manager
+			 */
+			nRes = m_cSocket.Receive(m_cInput + m_nInput, sizeof(m_cInput) - m_nInput, 0, nTimeout);
+			if (nRes > 0) {
+				debug_log("recieved %d bytes", nRes);
+				m_nInput += nRes;
+				nUsed = CProtocol::NextMessage(m_cInput, m_nInput, csOrder);
+				if (nUsed == 0 && m_nInput == sizeof(m_cInput))
+					m_nInput = 0;	/* not our protocol, drop it */
+			}
+			else if (nRes == 0) {
+				/*
+				 * Manager has closed the connection
+				 */
+				nRes = ERR_SHUTDOWN;
+			}
+		}
+
+		if (nUsed != 0) {
+			PRICE cPrice;
+			unsigned int nTick = 0;
+			int nOrder = CProtocol::ParseOrder(csOrder);
+			bool bPrice = CProtocol::ParsePrice(csOrder, cPrice) == ERR_SUCCESS;
+			bool bTick = CProtocol::ParseTick(csOrder, nTick) == ERR_SUCCESS;
+			unsigned int nItems = 0;
+			bool bBundles = CProtocol::ParseBundles(csOrder, nItems) == ERR_SUCCESS;
+			ROUND_TAG cTag;
+			if (nOrder == ORDER_START && CProtocol::ParseStart(csOrder, cTag) == ERR_SUCCESS)
+				m_cTag = cTag;
+			debug_log("order \"%.*s\"", (int) csOrder.size(), csOrder.data());
+
+			/* drop the order from buffer */
+			m_nInput -= nUsed;
+			memmove(m_cInput, m_cInput + nUsed, m_nInput);
+
+			if (nOrder == ORDER_KILL) {
 
 				/* Check if bidder lost */
 				nRes = ERR_KILLED;
 			}
-			else if (strncasecmp(cBuffer, "start", nRes) == 0) {
+			else if (nOrder == ORDER_START || bBundles) {
+				if (bBundles)
+					m_nItems = nItems;	/* combinatorial auction, bid on a bundle */
+
 				/*
 				 * We are good to start bidding
 				 */
 				nRes = ERR_SUCCESS;
 			}
+			else if (bPrice && cPrice.nPID != GetPID()) {
+				/*
+				 * Somebody has outbid us, raise unless it's worth more than that to us
+				 */
+				if (m_nValue == 0)
+					m_nValue = 50 + rand() % 100;
+				m_nRaise = std::min(cPrice.nPrice + 1 + rand() % 3, m_nValue);
+				nRes = (cPrice.nPrice < m_nValue) ? ERR_SUCCESS : ERR_KEEP_WAITING;
+				if (nRes != ERR_SUCCESS)
+					m_nRaise = 0;
+			}
+			else if (bTick && !m_bAccepted) {
+				/*
+				 * Dutch clock has ticked, take it once it's worth it to us
+				 */
+				if (m_nValue == 0)
+					m_nValue = 50 + rand() % 100;
+				m_bAccepted = nTick <= m_nValue;
+				m_nRaise = m_bAccepted ? nTick : 0;
+				nRes = m_bAccepted ? ERR_SUCCESS : ERR_KEEP_WAITING;
+			}
+			else
+				nRes = ERR_KEEP_WAITING;
 		}
-		else if (nRes == 0) {
+		else if (nRes >= 0) {
 			/*
 			 * Nothing here so far, keep waiting for the order
 			 */
 			nRes = ERR_KEEP_WAITING;
 		}
-		else {
-			nRes = ERR_KEEP_WAITING;
-		}
 	}
 	catch (std::exception e) {
 
@@ -0,0 +1,159 @@
+/* Headers */
+#include "support.h"
+#include "log.h"
+#include "history.h"
+
+/*
+ * Aggregates of one auction
+ */
+typedef struct auction_totals {
+	uint64_t nBids;
+	uint32_t nMinBid;
+	uint32_t nMaxBid;
+	uint64_t nSumBid;
+	uint32_t nRounds;			/* highest round seen */
+	uint64_t nSumWait;			/* ns from round start to bid */
+	uint64_t nMaxWait;
+	uint64_t nStamped;			/* bids with a kernel receive time */
+	uint64_t nSumQueued;		/* ns from kernel receive to read */
+	uint64_t nMaxQueued;
+} AUCTION_TOTALS;
+
+/*
+ * Print usage of reader
+ */
+void Usage()
+{
+	printf("Usage: bidhistory FILE\n"
+		"\n"
+		"    Summarize bids of a history written by a manager started with --history FILE\n"
+		"    per auction: bids, rounds, min, max and mean bid, mean and max ms from round start\n"
+		"    and, if the manager ran with --timestamps, mean and max ms bids were queued in the kernel\n"
+		"    then the same for all auctions together, with p50 and p99 from round start,\n"
+		"    in one line for comparing runs\n"
+		"\n");
+}
+
+/*
+ * main program
+ * columns are read in place from the mapping, nothing is copied or parsed
+ */
+int main(int argc, char* argv[])
+{
+	if (argc != 2) {
+		Usage();
+		return 1;
+	}
+
+	CHistoryFile cHistory;
+	if (cHistory.Open(argv[1]) != ERR_SUCCESS)
+		return 1;
+
+	struct timespec cStart, cEnd;
+	clock_gettime(CLOCK_MONOTONIC, &cStart);
+
+	std::vector<AUCTION_TOTALS> cTotals;
+	std::vector<uint64_t> cWaits;		/* from round start of every bid, for quantiles */
+	uint64_t nRows = 0;
+	uint64_t nBlocks = 0;
+	uint64_t nFirst = UINT64_MAX;
+	uint64_t nLast = 0;
+	HISTORY_BLOCK cBlock;
+	while (cHistory.Next(cBlock)) {
+		++ nBlocks;
+		nRows += cBlock.nRows;
+		for (uint32_t nRow = 0; nRow < cBlock.nRows; ++ nRow) {
+			uint32_t nAuction = cBlock.pAuction[nRow];
+			if (nAuction >= cTotals.size())
+				cTotals.resize(nAuction + 1, AUCTION_TOTALS { 0, UINT32_MAX, 0, 0, 0, 0, 0, 0, 0, 0 });
+
+			AUCTION_TOTALS& cAuction = cTotals[nAuction];
+			uint32_t nBid = cBlock.pBid[nRow];
+			++ cAuction.nBids;
+			cAuction.nSumBid += nBid;
+			cAuction.nMinBid = std::min(cAuction.nMinBid, nBid);
+			cAuction.nMaxBid = std::max(cAuction.nMaxBid, nBid);
+			cAuction.nRounds = std::max(cAuction.nRounds, cBlock.pRound[nRow]);
+
+			/* proxies may bid while their round is being started */
+			uint64_t nArrival = cBlock.pArrival[nRow];
+			uint64_t nWait = nArrival > cBlock.pStart[nRow] ? nArrival - cBlock.pStart[nRow] : 0;
+			cAuction.nSumWait += nWait;
+			cAuction.nMaxWait = std::max(cAuction.nMaxWait, nWait);
+			cWaits.push_back(nWait);
+
+			/* read came after its segment, kernel queueing is apart from manager's own time */
+			uint64_t nKernel = cBlock.pKernel[nRow];
+			if (nKernel != 0) {
+				uint64_t nQueued = nArrival > nKernel ? nArrival - nKernel : 0;
+				++ cAuction.nStamped;
+				cAuction.nSumQueued += nQueued;
+				cAuction.nMaxQueued = std::max(cAuction.nMaxQueued, nQueued);
+			}
+			nFirst = std::min(nFirst, nArrival);
+			nLast = std::max(nLast, nArrival);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &cEnd);
+	double dScan = (cEnd.tv_sec - cStart.tv_sec) * 1e3 + (cEnd.tv_nsec - cStart.tv_nsec) / 1e6;
+
+	AUCTION_TOTALS cAll = { 0, UINT32_MAX, 0, 0, 0, 0, 0, 0, 0, 0 };
+	for (size_t nAuction = 0; nAuction < cTotals.size(); ++ nAuction) {
+		const AUCTION_TOTALS& cAuction = cTotals[nAuction];
+		if (cAuction.nBids == 0)
+			continue;
+
+		cAll.nBids += cAuction.nBids;
+		cAll.nRounds += cAuction.nRounds;
+		cAll.nSumWait += cAuction.nSumWait;
+		cAll.nMaxWait = std::max(cAll.nMaxWait, cAuction.nMaxWait);
+		cAll.nStamped += cAuction.nStamped;
+		cAll.nSumQueued += cAuction.nSumQueued;
+		cAll.nMaxQueued = std::max(cAll.nMaxQueued, cAuction.nMaxQueued);
+
+		log_message("Auction %zu: %llu bids in %u rounds, min %u, max %u, mean %.2f, "
+			"from round start mean %.3f ms, max %.3f ms",
+			nAuction,
+			(unsigned long long) cAuction.nBids,
+			cAuction.nRounds,
+			cAuction.nMinBid,
+			cAuction.nMaxBid,
+			(double) cAuction.nSumBid / cAuction.nBids,
+			cAuction.nSumWait / 1e6 / cAuction.nBids,
+			cAuction.nMaxWait / 1e6);
+		if (cAuction.nStamped != 0)
+			log_message("Auction %zu: %llu bids queued in kernel mean %.3f ms, max %.3f ms",
+				nAuction,
+				(unsigned long long) cAuction.nStamped,
+				cAuction.nSumQueued / 1e6 / cAuction.nStamped,
+				cAuction.nMaxQueued / 1e6);
+	}
+
+	if (cAll.nBids != 0) {
+		std::vector<uint64_t>::iterator cP50 = cWaits.begin() + (cWaits.size() - 1) / 2;
+		std::vector<uint64_t>::iterator cP99 = cWaits.begin() + (cWaits.size() - 1) * 99 / 100;
+		std::nth_element(cWaits.begin(), cP99, cWaits.end());
+		std::nth_element(cWaits.begin(), cP50, cP99);
+		log_message("All auctions: %llu bids in %u rounds, from round start p50 %.3f ms, p99 %.3f ms, "
+			"mean %.3f ms, max %.3f ms, queued in kernel mean %.3f ms",
+			(unsigned long long) cAll.nBids,
+			cAll.nRounds,
+			*cP50 / 1e6,
+			*cP99 / 1e6,
+			cAll.nSumWait / 1e6 / cAll.nBids,
+			cAll.nMaxWait / 1e6,
+			cAll.nStamped != 0 ? cAll.nSumQueued / 1e6 / cAll.nStamped : 0.0);
+	}
+
+	if (nRows != 0) {
+		time_t nWhen = (nFirst + cHistory.GetClockOffset()) / 1000000000LL;
+		char cWhen[64] = { 0 };
+		strftime(cWhen, sizeof(cWhen), "%F %T", localtime(&nWhen));
+		log_message("%llu bids from %s over %.3f s", (unsigned long long) nRows, cWhen,
+			(nLast - nFirst) / 1e9);
+	}
+	log_message("Read %llu blocks in %.3f ms", (unsigned long long) nBlocks, dScan);
+
+	return 0;
+}
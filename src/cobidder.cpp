@@ -0,0 +1,254 @@
+/*
+ * header files
+ */
+#include "support.h"
+#include "log.h"
+#include "protocol.h"
+#include "cobidder.h"
+
+/*
+ * constructor
+ */
+CCoBidder::CCoBidder(CEventLoop& cLoop, std::string csServer, unsigned short nServerPort, pid_t nID, unsigned int nAuction/* = DEFAULT_AUCTION*/) :
+	m_cLoop(cLoop)
+{
+	m_csServer = csServer;
+	m_nServerPort = nServerPort;
+	m_nID = nID;
+	m_nAuction = nAuction;
+	m_nSeed = time(NULL) ^ (nID << 16) ^ (nAuction << 8);
+	m_bMultiAttribute = false;
+	m_bProxy = false;
+	m_nOptions = SOCK_PROFILE_DEFAULT;
+	m_nValue = 50 + rand_r(&m_nSeed) % 100;
+	m_bAccepted = false;
+	m_cTag.nAuction = 0;
+	m_cTag.nRound = 0;
+	m_nInput = 0;
+	m_nOutput = 0;
+	m_nOutputSent = 0;
+}
+
+/*
+ * destructor
+ */
+CCoBidder::~CCoBidder()
+{
+	m_cSocket.Close();
+}
+
+/*
+ * Start connecting to manager
+ */
+int CCoBidder::Connect()
+{
+	int nSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (nSocket == INVALID_SOCKET) {
+		perr_printf("Creating socket failed");
+		return ERR_SOCKET_OPEN;
+	}
+	m_cSocket.SetSockHandle(nSocket);
+	CSocket::SetOptions(nSocket, m_nOptions);
+
+	sockaddr_in sockAddr;
+	memset(&sockAddr, 0, sizeof(sockAddr));
+	sockAddr.sin_family = AF_INET;
+	sockAddr.sin_addr.s_addr = inet_addr(m_csServer.c_str());
+	sockAddr.sin_port = htons(m_nServerPort);
+
+	if (connect(nSocket, (sockaddr*) &sockAddr, sizeof(sockAddr)) == INVALID_SOCKET && errno != EINPROGRESS) {
+		perr_printf("Can't connect");
+		return ERR_SOCKET_CONNECT;
+	}
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Check if connect has succeeded
+ * queue hello with my port and id
+ */
+int CCoBidder::FinishConnect()
+{
+	int nError = 0;
+	socklen_t nLength = sizeof(nError);
+	if (getsockopt(m_cSocket.GetSockHandle(), SOL_SOCKET, SO_ERROR, &nError, &nLength) == INVALID_SOCKET || nError != 0) {
+		err_printf("Bidder %d can't connect: %s", m_nID, strerror(nError));
+		return ERR_SOCKET_CONNECT;
+	}
+
+	std::string csAddress;
+	unsigned short uSockPort = 0;
+	if (!m_cSocket.GetSockName(csAddress, uSockPort))
+		return ERR_SOCKET_CONNECT;
+
+	m_nOutput = sprintf(m_cOutput, "%d: %d: %u\n", uSockPort, m_nID, m_nAuction);
+	m_nOutputSent = 0;
+	return ERR_SUCCESS;
+}
+
+/*
+ * Queue the bid
+ */
+int CCoBidder::MakeBid()
+{
+	int nBid = rand_r(&m_nSeed) % 100;
+	m_nOutput = CProtocol::FormatTag(m_cOutput, sizeof(m_cOutput), m_cTag);	/* round we bid in */
+	if (m_bMultiAttribute)
+		m_nOutput += sprintf(m_cOutput + m_nOutput, "attr %d: %d %d %d %d\n", m_nID, nBid,
+				    rand_r(&m_nSeed) % 30, rand_r(&m_nSeed) % 100, rand_r(&m_nSeed) % 10);
+	else if (m_bProxy)
+		m_nOutput += sprintf(m_cOutput + m_nOutput, "proxy %d: %d %d %d\n", m_nID, nBid,
+				    nBid + rand_r(&m_nSeed) % 50, 1 + rand_r(&m_nSeed) % 5);
+	else
+		m_nOutput += sprintf(m_cOutput + m_nOutput, "%d: %d\n", m_nID, nBid);
+	m_nOutputSent = 0;
+	debug_log("Bidder %d bids %d", m_nID, nBid);
+	return ERR_SUCCESS;
+}
+
+/*
+ * Somebody has outbid us, raise unless it's worth more than that to us
+ */
+int CCoBidder::MakeRaise(const PRICE& cPrice)
+{
+	if (cPrice.nPID == m_nID || cPrice.nPrice >= m_nValue)
+		return ERR_SUCCESS;
+
+	unsigned int nBid = std::min(cPrice.nPrice + 1 + rand_r(&m_nSeed) % 3, m_nValue);
+	m_nOutput = CProtocol::FormatTag(m_cOutput, sizeof(m_cOutput), m_cTag);
+	m_nOutput += sprintf(m_cOutput + m_nOutput, "%d: %u\n", m_nID, nBid);
+	m_nOutputSent = 0;
+	debug_log("Bidder %d raises to %u", m_nID, nBid);
+	return ERR_SUCCESS;
+}
+
+/*
+ * Combinatorial auction, queue bid on a bundle of neighbouring items
+ */
+int CCoBidder::MakeBundle(unsigned int nItems)
+{
+	BUNDLE cBundle;
+	unsigned int nItem = rand_r(&m_nSeed) % nItems;
+	cBundle.nPID = m_nID;
+	cBundle.nPrice = 0;
+	cBundle.nItems = 1 + rand_r(&m_nSeed) % std::min(MAX_BUNDLE_ITEMS, nItems);
+	for (unsigned int nIndex = 0; nIndex < cBundle.nItems; ++ nIndex) {
+		cBundle.cItems[nIndex] = (nItem + nIndex) % nItems;
+		cBundle.nPrice += 5 + rand_r(&m_nSeed) % 20;
+	}
+
+	m_nOutput = CProtocol::FormatBundle(m_cOutput, sizeof(m_cOutput), cBundle);
+	m_nOutputSent = 0;
+	debug_log("Bidder %d bids %u for %u items", m_nID, cBundle.nPrice, cBundle.nItems);
+	return ERR_SUCCESS;
+}
+
+/*
+ * Dutch clock has ticked, take the price once it's worth it to us
+ */
+int CCoBidder::MakeAccept(unsigned int nPrice)
+{
+	if (m_bAccepted || nPrice > m_nValue)
+		return ERR_SUCCESS;
+
+	m_bAccepted = true;
+	m_nOutput = sprintf(m_cOutput, "%d: %u\n", m_nID, nPrice);
+	m_nOutputSent = 0;
+	debug_log("Bidder %d accepts %u", m_nID, nPrice);
+	return ERR_SUCCESS;
+}
+
+/*
+ * Bidder task
+ * Waits for orders, sends bids, until manager kills it
+ */
+CTask CCoBidder::Run()
+{
+	int nRes = 0;
+	m_cLoop.TaskStarted();
+	debug_log("Entering %s ...", __FUNCTION__);
+
+	nRes = Connect();
+	if (nRes == ERR_SUCCESS) {
+		co_await m_cLoop.Writable(m_cSocket.GetSockHandle());
+		nRes = FinishConnect();
+	}
+
+	while (nRes == ERR_SUCCESS) {
+		/*
+		 * Send what is queued, wait if socket is full
+		 */
+		while (m_nOutputSent < m_nOutput) {
+			ssize_t nWritten = send(m_cSocket.GetSockHandle(),
+						m_cOutput + m_nOutputSent,
+						m_nOutput - m_nOutputSent,
+						MSG_NOSIGNAL);
+			if (nWritten >= 0)
+				m_nOutputSent += nWritten;
+			else if (errno == EAGAIN || errno == EWOULDBLOCK)
+				co_await m_cLoop.Writable(m_cSocket.GetSockHandle());
+			else if (errno != EINTR) {
+				perr_printf("Can't send");
+				nRes = ERR_SOCKET_SEND;
+				break;
+			}
+		}
+		if (nRes != ERR_SUCCESS)
+			break;
+
+		/*
+		 * Wait for next order
+		 */
+		std::string_view csOrder;
+		size_t nUsed = CProtocol::NextMessage(m_cInput, m_nInput, csOrder);
+		if (nUsed == 0) {
+			if (m_nInput == sizeof(m_cInput))
+				m_nInput = 0;	/* not our protocol, drop it */
+
+			ssize_t nBytes = recv(m_cSocket.GetSockHandle(),
+					      m_cInput + m_nInput,
+					      sizeof(m_cInput) - m_nInput,
+					      0);
+			if (nBytes > 0)
+				m_nInput += nBytes;
+			else if (nBytes == 0)
+				nRes = ERR_SHUTDOWN;	/* manager has closed the connection */
+			else if (errno == EAGAIN || errno == EWOULDBLOCK)
+				co_await m_cLoop.Readable(m_cSocket.GetSockHandle());
+			else if (errno != EINTR) {
+				perr_printf("Recv failed");
+				nRes = ERR_SOCKET_RECV;
+			}
+			continue;
+		}
+
+		PRICE cPrice;
+		unsigned int nTick = 0;
+		int nOrder = CProtocol::ParseOrder(csOrder);
+		bool bPrice = CProtocol::ParsePrice(csOrder, cPrice) == ERR_SUCCESS;
+		bool bTick = CProtocol::ParseTick(csOrder, nTick) == ERR_SUCCESS;
+		unsigned int nItems = 0;
+		bool bBundles = CProtocol::ParseBundles(csOrder, nItems) == ERR_SUCCESS;
+		ROUND_TAG cTag;
+		if (nOrder == ORDER_START && CProtocol::ParseStart(csOrder, cTag) == ERR_SUCCESS)
+			m_cTag = cTag;
+		m_nInput -= nUsed;
+		memmove(m_cInput, m_cInput + nUsed, m_nInput);
+
+		if (nOrder == ORDER_KILL)
+			nRes = ERR_KILLED;		/* bidder lost, or auction is over */
+		else if (nOrder == ORDER_START)
+			MakeBid();				/* start bidding */
+		else if (bPrice)
+			MakeRaise(cPrice);		/* English auction, high bid has moved */
+		else if (bTick)
+			MakeAccept(nTick);		/* Dutch auction, price has come down */
+		else if (bBundles)
+			MakeBundle(nItems);		/* combinatorial auction has started */
+	}
+
+	m_cSocket.Close();
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	m_cLoop.TaskEnded();
+}
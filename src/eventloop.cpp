@@ -0,0 +1,82 @@
+/*
+ * header files
+ */
+#include "support.h"
+#include "log.h"
+#include "eventloop.h"
+
+/*
+ * Constructor
+ */
+CEventLoop::CEventLoop()
+{
+	m_nTasks = 0;
+	m_nEpoll = epoll_create1(EPOLL_CLOEXEC);
+	if (m_nEpoll == INVALID_SOCKET)
+		perr_printf("epoll_create failed");
+}
+
+/*
+ * Destructor
+ */
+CEventLoop::~CEventLoop()
+{
+	if (m_nEpoll != INVALID_SOCKET)
+		close(m_nEpoll);
+}
+
+/*
+ * Watch the socket
+ * One shot, every wait arms it again, so one socket has one waiter
+ */
+bool CEventLoop::Watch(int nSocket, unsigned int nEvents, std::coroutine_handle<> hHandle)
+{
+	struct epoll_event cEvent;
+	memset(&cEvent, 0, sizeof(cEvent));
+	cEvent.events = nEvents | EPOLLONESHOT;
+	cEvent.data.ptr = hHandle.address();
+
+	if (epoll_ctl(m_nEpoll, EPOLL_CTL_MOD, nSocket, &cEvent) == INVALID_SOCKET) {
+		if (errno != ENOENT ||
+		    epoll_ctl(m_nEpoll, EPOLL_CTL_ADD, nSocket, &cEvent) == INVALID_SOCKET) {
+
+			/*
+			 * Can't wait for it, don't suspend, task sees the error on socket
+			 */
+			perr_printf("Couldn't watch socket %d", nSocket);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Run the loop
+ */
+int CEventLoop::Run()
+{
+	int nRes = 0;
+	struct epoll_event cEvents[MAX_EPOLL_EVENTS];
+
+	debug_log("Entering %s ...", __FUNCTION__);
+	while (m_nTasks > 0) {
+		nRes = epoll_wait(m_nEpoll, cEvents, MAX_EPOLL_EVENTS, -1);
+		if (nRes == -1) {
+			if (errno == EINTR)
+				continue;
+
+			perr_printf("epoll_wait failed");
+			nRes = ERR_EPOLL;
+			break;
+		}
+
+		for (int nEvent = 0; nEvent < nRes; ++ nEvent)
+			std::coroutine_handle<>::from_address(cEvents[nEvent].data.ptr).resume();
+
+		nRes = ERR_SUCCESS;
+	}
+
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	return nRes;
+}
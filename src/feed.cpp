@@ -0,0 +1,198 @@
+/*
+ * header files
+ */
+#include "support.h"
+#include "log.h"
+#include "feed.h"
+
+/* Feed region starts with this, and its version */
+static const uint32_t FEED_MAGIC = 0x46454544;
+static const uint32_t FEED_VERSION = 1;
+
+/* Looks at a slot, before a reader gives up on a busy writer */
+static const unsigned int FEED_READ_TRIES = 1000;
+
+/*
+ * Constructor
+ */
+CMarketFeed::CMarketFeed()
+{
+	m_pHeader = NULL;
+	m_pSlots = NULL;
+	m_nSize = 0;
+}
+
+/*
+ * Destructor
+ * creator removes the name, watchers keep their mapping
+ */
+CMarketFeed::~CMarketFeed()
+{
+	if (m_pHeader != NULL)
+		munmap(m_pHeader, m_nSize);
+	if (!m_csName.empty())
+		shm_unlink(m_csName.c_str());
+}
+
+/*
+ * Create shared memory, and map it read write
+ */
+int CMarketFeed::Create(const std::string& csName, unsigned int nSlots)
+{
+	int nRes = 0;
+	debug_log("Entering %s ...", __FUNCTION__);
+	int nFile = INVALID_SOCKET;
+	try {
+		nFile = shm_open(csName.c_str(), O_CREAT | O_RDWR | O_TRUNC | O_CLOEXEC, 0644);
+		if (nFile == INVALID_SOCKET) {
+			perr_printf("Couldn't create feed %s", csName.c_str());
+			nRes = ERR_FEED;
+			throw nRes;
+		}
+		m_csName = csName;
+
+		m_nSize = RegionSize(nSlots);
+		if (ftruncate(nFile, m_nSize) == -1) {
+			perr_printf("Couldn't size feed %s", csName.c_str());
+			nRes = ERR_FEED;
+			throw nRes;
+		}
+
+		void* pRegion = mmap(NULL, m_nSize, PROT_READ | PROT_WRITE, MAP_SHARED, nFile, 0);
+		if (pRegion == MAP_FAILED) {
+			perr_printf("Couldn't map feed %s", csName.c_str());
+			nRes = ERR_FEED;
+			throw nRes;
+		}
+
+		/* region is zero filled, every slot is even and empty */
+		m_pHeader = static_cast<CHeader*>(pRegion);
+		m_pSlots = reinterpret_cast<CSlot*>(static_cast<char*>(pRegion) + CACHE_LINE_SIZE);
+		m_pHeader->nSlots = nSlots;
+		m_pHeader->nVersion = FEED_VERSION;
+		std::atomic_thread_fence(std::memory_order_release);
+		m_pHeader->nMagic = FEED_MAGIC;
+	}
+	catch (std::exception e) {
+		perr_printf(e.what());
+	}
+	catch (...) {
+		err_printf("Unknown exception...");
+	}
+	if (nFile != INVALID_SOCKET)
+		close(nFile);		/* mapping stays */
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	return nRes;
+}
+
+/*
+ * Map a feed, created by a manager
+ */
+int CMarketFeed::Open(const std::string& csName)
+{
+	int nRes = 0;
+	debug_log("Entering %s ...", __FUNCTION__);
+	int nFile = INVALID_SOCKET;
+	try {
+		nFile = shm_open(csName.c_str(), O_RDONLY | O_CLOEXEC, 0);
+		if (nFile == INVALID_SOCKET) {
+			perr_printf("Couldn't open feed %s", csName.c_str());
+			nRes = ERR_FEED;
+			throw nRes;
+		}
+
+		struct stat cStat;
+		if (fstat(nFile, &cStat) == -1 || (size_t) cStat.st_size < RegionSize(0)) {
+			err_printf("Feed %s isn't ready", csName.c_str());
+			nRes = ERR_FEED;
+			throw nRes;
+		}
+
+		m_nSize = cStat.st_size;
+		void* pRegion = mmap(NULL, m_nSize, PROT_READ, MAP_SHARED, nFile, 0);
+		if (pRegion == MAP_FAILED) {
+			perr_printf("Couldn't map feed %s", csName.c_str());
+			nRes = ERR_FEED;
+			throw nRes;
+		}
+
+		m_pHeader = static_cast<CHeader*>(pRegion);
+		m_pSlots = reinterpret_cast<CSlot*>(static_cast<char*>(pRegion) + CACHE_LINE_SIZE);
+		if (m_pHeader->nMagic != FEED_MAGIC || m_pHeader->nVersion != FEED_VERSION ||
+		    RegionSize(m_pHeader->nSlots) > m_nSize) {
+			err_printf("%s isn't a feed of this version", csName.c_str());
+			munmap(m_pHeader, m_nSize);
+			m_pHeader = NULL;
+			m_pSlots = NULL;
+			nRes = ERR_FEED;
+			throw nRes;
+		}
+	}
+	catch (std::exception e) {
+		perr_printf(e.what());
+	}
+	catch (...) {
+		err_printf("Unknown exception...");
+	}
+	if (nFile != INVALID_SOCKET)
+		close(nFile);
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	return nRes;
+}
+
+/*
+ * Write snapshot of an auction
+ * sequence is odd while fields change, readers don't take what they see then
+ */
+void CMarketFeed::Publish(const FEED_SNAPSHOT& cSnapshot)
+{
+	if (m_pSlots == NULL || cSnapshot.nAuction == 0)
+		return;
+
+	CSlot& cSlot = m_pSlots[(cSnapshot.nAuction - 1) % m_pHeader->nSlots];
+	uint32_t nSeq = cSlot.nSeq.load(std::memory_order_relaxed);
+	cSlot.nSeq.store(nSeq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	cSlot.nAuction.store(cSnapshot.nAuction, std::memory_order_relaxed);
+	cSlot.nRound.store(cSnapshot.nRound, std::memory_order_relaxed);
+	cSlot.nPrice.store(cSnapshot.nPrice, std::memory_order_relaxed);
+	cSlot.nLeader.store(cSnapshot.nLeader, std::memory_order_relaxed);
+	cSlot.nBidders.store(cSnapshot.nBidders, std::memory_order_relaxed);
+	cSlot.nReplies.store(cSnapshot.nReplies, std::memory_order_relaxed);
+	cSlot.nState.store(cSnapshot.nState, std::memory_order_relaxed);
+	cSlot.nUpdated.store(cSnapshot.nUpdated, std::memory_order_relaxed);
+
+	cSlot.nSeq.store(nSeq + 2, std::memory_order_release);
+}
+
+/*
+ * Copy a slot, as it was between two writes
+ */
+bool CMarketFeed::Read(unsigned int nSlot, FEED_SNAPSHOT& cSnapshot) const
+{
+	if (m_pSlots == NULL || nSlot >= m_pHeader->nSlots)
+		return false;
+
+	const CSlot& cSlot = m_pSlots[nSlot];
+	for (unsigned int nTry = 0; nTry < FEED_READ_TRIES; ++ nTry) {
+		uint32_t nSeq = cSlot.nSeq.load(std::memory_order_acquire);
+		if (nSeq & 1)
+			continue;	/* writer is in there */
+
+		cSnapshot.nAuction = cSlot.nAuction.load(std::memory_order_relaxed);
+		cSnapshot.nRound = cSlot.nRound.load(std::memory_order_relaxed);
+		cSnapshot.nPrice = cSlot.nPrice.load(std::memory_order_relaxed);
+		cSnapshot.nLeader = cSlot.nLeader.load(std::memory_order_relaxed);
+		cSnapshot.nBidders = cSlot.nBidders.load(std::memory_order_relaxed);
+		cSnapshot.nReplies = cSlot.nReplies.load(std::memory_order_relaxed);
+		cSnapshot.nState = cSlot.nState.load(std::memory_order_relaxed);
+		cSnapshot.nUpdated = cSlot.nUpdated.load(std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (cSlot.nSeq.load(std::memory_order_relaxed) == nSeq)
+			return true;
+	}
+
+	return false;
+}
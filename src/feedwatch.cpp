@@ -0,0 +1,69 @@
+/* Headers */
+#include "support.h"
+#include "log.h"
+#include "feed.h"
+
+/*
+ * Print usage of watcher
+ */
+void Usage()
+{
+	printf("Usage: feedwatch NAME [MS]\n"
+		"\n"
+		"    Watch auctions of a manager started with --feed NAME\n"
+		"    Look every MS milliseconds (default 100), until all auctions are over\n"
+		"\n");
+}
+
+/*
+ * main program
+ * polls the feed, a change of an auction is one line
+ */
+int main(int argc, char* argv[])
+{
+	if (argc < 2 || argc > 3) {
+		Usage();
+		return 1;
+	}
+
+	std::string csName = argv[1];
+	if (csName[0] != '/')
+		csName.insert(0, "/");
+	unsigned int nInterval = argc == 3 ? atoi(argv[2]) : 100;
+
+	CMarketFeed cFeed;
+	if (cFeed.Open(csName) != ERR_SUCCESS)
+		return 1;
+
+	static const char* s_pStates[] = { "waiting", "bidding", "over" };
+	std::vector<uint64_t> cSeen(cFeed.GetSlots(), 0);
+	while (true) {
+		unsigned int nOver = 0;
+		for (unsigned int nSlot = 0; nSlot < cFeed.GetSlots(); ++ nSlot) {
+			FEED_SNAPSHOT cSnapshot;
+			if (!cFeed.Read(nSlot, cSnapshot) || cSnapshot.nAuction == 0)
+				continue;	/* busy, or not published yet */
+
+			if (cSnapshot.nState == FEED_OVER)
+				++ nOver;
+			if (cSnapshot.nUpdated == cSeen[nSlot])
+				continue;
+
+			cSeen[nSlot] = cSnapshot.nUpdated;
+			log_message("Auction %u: round %u %s, price %u by %d, %u of %u bidders have bid",
+				cSnapshot.nAuction,
+				cSnapshot.nRound,
+				s_pStates[std::min<unsigned int>(cSnapshot.nState, FEED_OVER)],
+				cSnapshot.nPrice,
+				cSnapshot.nLeader,
+				cSnapshot.nReplies,
+				cSnapshot.nBidders);
+		}
+
+		if (nOver == cFeed.GetSlots())
+			break;
+		usleep(nInterval * 1000);
+	}
+
+	return 0;
+}
@@ -0,0 +1,239 @@
+/*
+ * header files
+ */
+#include "support.h"
+#include "log.h"
+#include "protocol.h"
+#include "gateway.h"
+
+/*
+ * constructor
+ */
+CGateway::CGateway(CEventLoop& cLoop, std::string csServer, unsigned short nServerPort, pid_t nID, unsigned int nAuction/* = DEFAULT_AUCTION*/) :
+	m_cLoop(cLoop)
+{
+	m_csServer = csServer;
+	m_nServerPort = nServerPort;
+	m_nID = nID;
+	m_nAuction = nAuction;
+	m_nOptions = SOCK_PROFILE_DEFAULT;
+	m_nSeed = time(NULL) ^ (nID << 16) ^ (nAuction << 8);
+	m_nValue = 50 + rand_r(&m_nSeed) % 100;
+	m_bAccepted = false;
+	m_cTag.nAuction = 0;
+	m_cTag.nRound = 0;
+	m_nInput = 0;
+	m_nOutputSent = 0;
+}
+
+/*
+ * destructor
+ */
+CGateway::~CGateway()
+{
+	m_cSocket.Close();
+}
+
+/*
+ * Start connecting to manager
+ */
+int CGateway::Connect()
+{
+	int nSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (nSocket == INVALID_SOCKET) {
+		perr_printf("Creating socket failed");
+		return ERR_SOCKET_OPEN;
+	}
+	m_cSocket.SetSockHandle(nSocket);
+	CSocket::SetOptions(nSocket, m_nOptions);
+
+	sockaddr_in sockAddr;
+	memset(&sockAddr, 0, sizeof(sockAddr));
+	sockAddr.sin_family = AF_INET;
+	sockAddr.sin_addr.s_addr = inet_addr(m_csServer.c_str());
+	sockAddr.sin_port = htons(m_nServerPort);
+
+	if (connect(nSocket, (sockaddr*) &sockAddr, sizeof(sockAddr)) == INVALID_SOCKET && errno != EINPROGRESS) {
+		perr_printf("Can't connect");
+		return ERR_SOCKET_CONNECT;
+	}
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Check if connect has succeeded
+ * queue gateway's hello, and hellos of its bidders
+ */
+int CGateway::FinishConnect()
+{
+	int nError = 0;
+	socklen_t nLength = sizeof(nError);
+	if (getsockopt(m_cSocket.GetSockHandle(), SOL_SOCKET, SO_ERROR, &nError, &nLength) == INVALID_SOCKET || nError != 0) {
+		err_printf("Gateway %d can't connect: %s", m_nID, strerror(nError));
+		return ERR_SOCKET_CONNECT;
+	}
+
+	char cBuffer[MAX_FRAME_SIZE] = { 0 };
+	sprintf(cBuffer, "gateway %d: %u\n", m_nID, m_nAuction);
+	m_csOutput = cBuffer;
+
+	for (size_t nFirst = 0; nFirst < m_cBidders.size(); nFirst += MAX_BATCH_BIDS) {
+		unsigned int nIDs = std::min<size_t>(MAX_BATCH_BIDS, m_cBidders.size() - nFirst);
+		size_t nUsed = CProtocol::FormatJoin(cBuffer, sizeof(cBuffer), m_nID, &m_cBidders[nFirst], nIDs);
+		m_csOutput.append(cBuffer, nUsed);
+	}
+	m_nOutputSent = 0;
+	return ERR_SUCCESS;
+}
+
+/*
+ * Queue bids of all live bidders, a frame for every MAX_BATCH_BIDS of them
+ */
+int CGateway::MakeBids()
+{
+	char cBuffer[MAX_FRAME_SIZE] = { 0 };
+	BID cBids[MAX_BATCH_BIDS];
+	unsigned int nBids = 0;
+
+	for (size_t nBidder = 0; nBidder < m_cBidders.size(); ++ nBidder) {
+		cBids[nBids].nPID = m_cBidders[nBidder];
+		cBids[nBids].nBid = rand_r(&m_nSeed) % 100;
+		debug_log("Bidder %d bids %u", cBids[nBids].nPID, cBids[nBids].nBid);
+
+		if (++ nBids == MAX_BATCH_BIDS || nBidder + 1 == m_cBidders.size()) {
+			size_t nTag = CProtocol::FormatTag(cBuffer, sizeof(cBuffer), m_cTag);	/* round they bid in */
+			size_t nUsed = CProtocol::FormatGatewayBids(cBuffer + nTag, sizeof(cBuffer) - nTag, m_nID, cBids, nBids);
+			m_csOutput.append(cBuffer, nTag + nUsed);
+			nBids = 0;
+		}
+	}
+	return ERR_SUCCESS;
+}
+
+/*
+ * Dutch clock has ticked
+ * its bidder, who values it most, takes the price once it's worth it
+ */
+int CGateway::MakeAccept(unsigned int nPrice)
+{
+	if (m_bAccepted || m_cBidders.empty() || nPrice > m_nValue)
+		return ERR_SUCCESS;
+
+	char cBuffer[MAX_FRAME_SIZE] = { 0 };
+	BID cBid;
+	cBid.nPID = m_cBidders[rand_r(&m_nSeed) % m_cBidders.size()];
+	cBid.nBid = nPrice;
+	m_bAccepted = true;
+	debug_log("Bidder %d accepts %u", cBid.nPID, nPrice);
+
+	size_t nUsed = CProtocol::FormatGatewayBids(cBuffer, sizeof(cBuffer), m_nID, &cBid, 1);
+	m_csOutput.append(cBuffer, nUsed);
+	return ERR_SUCCESS;
+}
+
+/*
+ * Killed bidders don't bid anymore
+ */
+int CGateway::KillBidders(const ID_LIST& cKills)
+{
+	for (unsigned int nKill = 0; nKill < cKills.nIDs; ++ nKill) {
+		std::vector<pid_t>::iterator cIter = std::find(m_cBidders.begin(), m_cBidders.end(), cKills.cIDs[nKill]);
+		if (cIter != m_cBidders.end()) {
+			*cIter = m_cBidders.back();		/* order doesn't matter */
+			m_cBidders.pop_back();
+		}
+	}
+
+	return m_cBidders.empty() ? ERR_KILLED : ERR_SUCCESS;
+}
+
+/*
+ * Gateway task
+ * Waits for orders, sends bids of its bidders, until all are killed
+ */
+CTask CGateway::Run()
+{
+	int nRes = 0;
+	m_cLoop.TaskStarted();
+	debug_log("Entering %s ...", __FUNCTION__);
+
+	nRes = Connect();
+	if (nRes == ERR_SUCCESS) {
+		co_await m_cLoop.Writable(m_cSocket.GetSockHandle());
+		nRes = FinishConnect();
+	}
+
+	while (nRes == ERR_SUCCESS) {
+		/*
+		 * Send what is queued, wait if socket is full
+		 */
+		while (m_nOutputSent < m_csOutput.size()) {
+			ssize_t nWritten = send(m_cSocket.GetSockHandle(),
+						m_csOutput.data() + m_nOutputSent,
+						m_csOutput.size() - m_nOutputSent,
+						MSG_NOSIGNAL);
+			if (nWritten >= 0)
+				m_nOutputSent += nWritten;
+			else if (errno == EAGAIN || errno == EWOULDBLOCK)
+				co_await m_cLoop.Writable(m_cSocket.GetSockHandle());
+			else if (errno != EINTR) {
+				perr_printf("Can't send");
+				nRes = ERR_SOCKET_SEND;
+				break;
+			}
+		}
+		if (nRes != ERR_SUCCESS)
+			break;
+		m_csOutput.clear();
+		m_nOutputSent = 0;
+
+		/*
+		 * Wait for next order
+		 */
+		std::string_view csOrder;
+		size_t nUsed = CProtocol::NextMessage(m_cInput, m_nInput, csOrder);
+		if (nUsed == 0) {
+			if (m_nInput == sizeof(m_cInput))
+				m_nInput = 0;	/* not our protocol, drop it */
+
+			ssize_t nBytes = recv(m_cSocket.GetSockHandle(),
+					      m_cInput + m_nInput,
+					      sizeof(m_cInput) - m_nInput,
+					      0);
+			if (nBytes > 0)
+				m_nInput += nBytes;
+			else if (nBytes == 0)
+				nRes = ERR_SHUTDOWN;	/* manager has closed the connection */
+			else if (errno == EAGAIN || errno == EWOULDBLOCK)
+				co_await m_cLoop.Readable(m_cSocket.GetSockHandle());
+			else if (errno != EINTR) {
+				perr_printf("Recv failed");
+				nRes = ERR_SOCKET_RECV;
+			}
+			continue;
+		}
+
+		ID_LIST cKills;
+		unsigned int nTick = 0;
+		int nOrder = CProtocol::ParseOrder(csOrder);
+		ROUND_TAG cTag;
+		if (nOrder == ORDER_START && CProtocol::ParseStart(csOrder, cTag) == ERR_SUCCESS)
+			m_cTag = cTag;
+		if (nOrder == ORDER_KILL)
+			nRes = ERR_KILLED;		/* auction is over for all of them */
+		else if (nOrder == ORDER_START)
+			MakeBids();				/* start bidding */
+		else if (CProtocol::ParseKills(csOrder, cKills) == ERR_SUCCESS)
+			nRes = KillBidders(cKills);
+		else if (CProtocol::ParseTick(csOrder, nTick) == ERR_SUCCESS)
+			MakeAccept(nTick);		/* Dutch auction, price has come down */
+
+		m_nInput -= nUsed;
+		memmove(m_cInput, m_cInput + nUsed, m_nInput);
+	}
+
+	m_cSocket.Close();
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	m_cLoop.TaskEnded();
+}
@@ -0,0 +1,272 @@
+/*
+ * header files
+ */
+#include "support.h"
+#include "log.h"
+#include "history.h"
+
+/* History file starts with this, and its version; every block starts with the block magic */
+static const uint64_t HISTORY_MAGIC = 0x3154534948444942ULL;	/* "BIDHIST1" */
+static const uint32_t HISTORY_VERSION = 2;			/* 2 has kernel receive times */
+static const uint32_t HISTORY_BLOCK_MAGIC = 0x4b4c4242;			/* "BBLK" */
+
+/*
+ * Constructor
+ */
+CHistoryFile::CHistoryFile()
+{
+	m_nFile = INVALID_SOCKET;
+	m_pRegion = NULL;
+	m_nSize = 0;
+	m_nOffset = 0;
+}
+
+/*
+ * Destructor
+ */
+CHistoryFile::~CHistoryFile()
+{
+	if (m_nFile != INVALID_SOCKET)
+		close(m_nFile);
+	if (m_pRegion != NULL)
+		munmap((void*) m_pRegion, m_nSize);
+}
+
+/*
+ * Create history file, and write its header
+ */
+int CHistoryFile::Create(const std::string& csPath)
+{
+	int nRes = 0;
+	debug_log("Entering %s ...", __FUNCTION__);
+	try {
+		m_nFile = open(csPath.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_APPEND | O_CLOEXEC, 0644);
+		if (m_nFile == INVALID_SOCKET) {
+			perr_printf("Couldn't create history %s", csPath.c_str());
+			nRes = ERR_HISTORY;
+			throw nRes;
+		}
+
+		/* readers turn arrival times to wall clock with this */
+		struct timespec cReal, cMono;
+		clock_gettime(CLOCK_REALTIME, &cReal);
+		clock_gettime(CLOCK_MONOTONIC, &cMono);
+
+		CHeader cHeader;
+		memset(&cHeader, 0, sizeof(cHeader));
+		cHeader.nMagic = HISTORY_MAGIC;
+		cHeader.nVersion = HISTORY_VERSION;
+		cHeader.nClockOffset = ((int64_t) cReal.tv_sec - cMono.tv_sec) * 1000000000LL +
+			((int64_t) cReal.tv_nsec - cMono.tv_nsec);
+		if (write(m_nFile, &cHeader, sizeof(cHeader)) != sizeof(cHeader)) {
+			perr_printf("Couldn't write history %s", csPath.c_str());
+			close(m_nFile);
+			m_nFile = INVALID_SOCKET;
+			nRes = ERR_HISTORY;
+			throw nRes;
+		}
+	}
+	catch (std::exception e) {
+		perr_printf(e.what());
+	}
+	catch (...) {
+		err_printf("Unknown exception...");
+	}
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	return nRes;
+}
+
+/*
+ * Map a history file, written by a manager
+ */
+int CHistoryFile::Open(const std::string& csPath)
+{
+	int nRes = 0;
+	debug_log("Entering %s ...", __FUNCTION__);
+	int nFile = INVALID_SOCKET;
+	try {
+		nFile = open(csPath.c_str(), O_RDONLY | O_CLOEXEC);
+		if (nFile == INVALID_SOCKET) {
+			perr_printf("Couldn't open history %s", csPath.c_str());
+			nRes = ERR_HISTORY;
+			throw nRes;
+		}
+
+		struct stat cStat;
+		if (fstat(nFile, &cStat) == -1 || (size_t) cStat.st_size < sizeof(CHeader)) {
+			err_printf("%s isn't a history file", csPath.c_str());
+			nRes = ERR_HISTORY;
+			throw nRes;
+		}
+
+		m_nSize = cStat.st_size;
+		void* pRegion = mmap(NULL, m_nSize, PROT_READ, MAP_SHARED, nFile, 0);
+		if (pRegion == MAP_FAILED) {
+			perr_printf("Couldn't map history %s", csPath.c_str());
+			nRes = ERR_HISTORY;
+			throw nRes;
+		}
+		madvise(pRegion, m_nSize, MADV_SEQUENTIAL);
+
+		const CHeader* pHeader = static_cast<const CHeader*>(pRegion);
+		if (pHeader->nMagic != HISTORY_MAGIC || pHeader->nVersion != HISTORY_VERSION) {
+			err_printf("%s isn't a history file of this version", csPath.c_str());
+			munmap(pRegion, m_nSize);
+			nRes = ERR_HISTORY;
+			throw nRes;
+		}
+
+		m_pRegion = static_cast<const char*>(pRegion);
+		m_nOffset = sizeof(CHeader);
+	}
+	catch (std::exception e) {
+		perr_printf(e.what());
+	}
+	catch (...) {
+		err_printf("Unknown exception...");
+	}
+	if (nFile != INVALID_SOCKET)
+		close(nFile);		/* mapping stays */
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	return nRes;
+}
+
+/*
+ * Write a block in one go
+ * O_APPEND puts it at the end as a whole, whoever else is writing
+ */
+int CHistoryFile::Append(uint32_t nRows, const uint64_t* pArrival, const uint64_t* pStart, const uint64_t* pKernel,
+	const uint32_t* pAuction, const uint32_t* pRound, const int32_t* pPID, const uint32_t* pBid)
+{
+	if (m_nFile == INVALID_SOCKET || nRows == 0)
+		return ERR_SUCCESS;
+
+	CBlockHeader cHeader = { HISTORY_BLOCK_MAGIC, nRows };
+	struct iovec cColumns[] = {
+		{ &cHeader, sizeof(cHeader) },
+		{ (void*) pArrival, nRows * sizeof(uint64_t) },
+		{ (void*) pStart, nRows * sizeof(uint64_t) },
+		{ (void*) pKernel, nRows * sizeof(uint64_t) },
+		{ (void*) pAuction, nRows * sizeof(uint32_t) },
+		{ (void*) pRound, nRows * sizeof(uint32_t) },
+		{ (void*) pPID, nRows * sizeof(int32_t) },
+		{ (void*) pBid, nRows * sizeof(uint32_t) }
+	};
+
+	ssize_t nWritten = writev(m_nFile, cColumns, sizeof(cColumns) / sizeof(cColumns[0]));
+	if (nWritten != (ssize_t) BlockSize(nRows)) {
+		perr_printf("Couldn't write %u bids to history", nRows);
+		return ERR_HISTORY;
+	}
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Point columns of next block into the mapping
+ * a block cut short, by a manager killed while writing, ends the file
+ */
+bool CHistoryFile::Next(HISTORY_BLOCK& cBlock)
+{
+	if (m_pRegion == NULL || m_nOffset + sizeof(CBlockHeader) > m_nSize)
+		return false;
+
+	const CBlockHeader* pHeader = reinterpret_cast<const CBlockHeader*>(m_pRegion + m_nOffset);
+	if (pHeader->nMagic != HISTORY_BLOCK_MAGIC || m_nOffset + BlockSize(pHeader->nRows) > m_nSize) {
+		err_printf("History is broken at byte %zu", m_nOffset);
+		return false;
+	}
+
+	uint32_t nRows = pHeader->nRows;
+	const char* pColumn = m_pRegion + m_nOffset + sizeof(CBlockHeader);
+	cBlock.nRows = nRows;
+	cBlock.pArrival = reinterpret_cast<const uint64_t*>(pColumn);
+	pColumn += nRows * sizeof(uint64_t);
+	cBlock.pStart = reinterpret_cast<const uint64_t*>(pColumn);
+	pColumn += nRows * sizeof(uint64_t);
+	cBlock.pKernel = reinterpret_cast<const uint64_t*>(pColumn);
+	pColumn += nRows * sizeof(uint64_t);
+	cBlock.pAuction = reinterpret_cast<const uint32_t*>(pColumn);
+	pColumn += nRows * sizeof(uint32_t);
+	cBlock.pRound = reinterpret_cast<const uint32_t*>(pColumn);
+	pColumn += nRows * sizeof(uint32_t);
+	cBlock.pPID = reinterpret_cast<const int32_t*>(pColumn);
+	pColumn += nRows * sizeof(int32_t);
+	cBlock.pBid = reinterpret_cast<const uint32_t*>(pColumn);
+
+	m_nOffset += BlockSize(nRows);
+	return true;
+}
+
+/*
+ * Clock offset of the writer
+ */
+int64_t CHistoryFile::GetClockOffset() const
+{
+	if (m_pRegion == NULL)
+		return 0;
+	return reinterpret_cast<const CHeader*>(m_pRegion)->nClockOffset;
+}
+
+/*
+ * Constructor
+ */
+CHistoryBuffer::CHistoryBuffer()
+{
+	m_pFile = NULL;
+	m_nRows = 0;
+	m_pArrival = NULL;
+	m_pStart = NULL;
+	m_pKernel = NULL;
+	m_pAuction = NULL;
+	m_pRound = NULL;
+	m_pPID = NULL;
+	m_pBid = NULL;
+}
+
+/*
+ * Destructor
+ * bids of the last block are written here
+ */
+CHistoryBuffer::~CHistoryBuffer()
+{
+	Flush();
+	delete [] m_pArrival;
+	delete [] m_pStart;
+	delete [] m_pKernel;
+	delete [] m_pAuction;
+	delete [] m_pRound;
+	delete [] m_pPID;
+	delete [] m_pBid;
+}
+
+/*
+ * Columns are allocated only when history is kept
+ */
+void CHistoryBuffer::SetFile(CHistoryFile* pFile)
+{
+	if (pFile == NULL || m_pFile != NULL)
+		return;
+
+	m_pFile = pFile;
+	m_pArrival = new uint64_t[HISTORY_BLOCK_ROWS];
+	m_pStart = new uint64_t[HISTORY_BLOCK_ROWS];
+	m_pKernel = new uint64_t[HISTORY_BLOCK_ROWS];
+	m_pAuction = new uint32_t[HISTORY_BLOCK_ROWS];
+	m_pRound = new uint32_t[HISTORY_BLOCK_ROWS];
+	m_pPID = new int32_t[HISTORY_BLOCK_ROWS];
+	m_pBid = new uint32_t[HISTORY_BLOCK_ROWS];
+}
+
+/*
+ * Write what we have, a failed block is dropped, bidding goes on
+ */
+int CHistoryBuffer::Flush()
+{
+	if (m_pFile == NULL || m_nRows == 0)
+		return ERR_SUCCESS;
+
+	int nRes = m_pFile->Append(m_nRows, m_pArrival, m_pStart, m_pKernel, m_pAuction, m_pRound, m_pPID, m_pBid);
+	m_nRows = 0;
+	return nRes;
+}
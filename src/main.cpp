@@ -3,22 +3,39 @@
 #include "support.h"
 #include "log.h"
 #include "manager.h"
+#include "auctionhouse.h"
 
 /* options structure */
 struct _opts {
 	int debug;
+	int coroutines;
+	unsigned int gateways;
+	int proxies;
+	AUCTION_MODE mode;
+	unsigned int ticktime;
+	unsigned int items;
+	const char *feed;
+	const char *history;
+	int timestamps;
+	unsigned int profile;
+	int busypoll;			/* CPU + 1, 0 if manager sleeps in epoll */
+	const char *managercpus;
+	const char *biddercpus;
+	int multi;
+	unsigned int threads;
+	unsigned int auctions;
+	unsigned int join;		/* auctions every bidder bids in */
+	unsigned int shards;
+	int hugepages;
+	QUORUM quorum;
+	unsigned int roundtime;
+	const char *upstream;
+	unsigned int leaves;
+	unsigned int topk;
 	unsigned int bidders;
 	unsigned short port;
 } opts;
 
-/*
- * signal handler for Ctrl+C, and Segmentation Fault
- */
-void signal_handler(int arg __attribute__((unused)))
-{
-	/* TODO */
-}
-
 /*
  * Print usage of project
  */
@@ -30,24 +47,129 @@ void Usage()
 		"\n"
 		"    -b, --bidders NUMBER    Set number of bidders\n"
 		"    -p, --port NUMBER       Set port number for manager\n"
+		"    -c, --coroutines        Run all bidders as coroutines in one process\n"
+		"    -g, --gateways NUMBER   Carry bidders of an auction over NUMBER gateway connections\n"
+		"    -M, --mode MODE         Run sealed bid rounds, english, dutch or combinatorial auctions\n"
+		"    -T, --tick US           Lower the dutch clock every US microseconds\n"
+		"    -i, --items NUMBER      Bid on bundles of NUMBER items in combinatorial auctions\n"
+		"    -x, --proxy             Bidders leave their bidding to proxies in manager\n"
+		"    -m, --multi-attribute   Bid on price, delivery, quality and penalty\n"
+		"    -j, --threads NUMBER    Set number of threads scoring bids, or solving bundles\n"
+		"    -a, --auctions NUMBER   Set number of auctions run at once\n"
+		"    -A, --auctions-per-bidder NUMBER Bid in NUMBER auctions, own and next ones, in batches\n"
+		"    -s, --shards NUMBER     Set number of manager threads running auctions\n"
+		"    -H, --huge-pages        Back connection pools and round arenas with huge pages\n"
+		"    -q, --quorum RULE       Close a round once all, majority, N%% or N live bidders have bid\n"
+		"    -t, --round-time MS     Close a round MS milliseconds after it starts\n"
+		"    -u, --upstream HOST:PORT Report rounds to parent manager at HOST:PORT\n"
+		"    -l, --leaves NUMBER     Wait for NUMBER child managers before first round\n"
+		"    -k, --top-k NUMBER      Report NUMBER best bids to parent manager\n"
+		"    -f, --feed NAME         Publish auction state to shared memory NAME for feedwatch\n"
+		"    -o, --history FILE      Write every bid to FILE in columns for bidhistory\n"
+		"    -S, --timestamps        Take receive times of bids from kernel timestamps\n"
+		"    -P, --profile NAME      Tune sockets for default, low-latency or throughput\n"
+		"    -B, --busy-poll CPU     Pin manager to CPU and spin for bids, shard n to CPU + n\n"
+		"    -C, --manager-cpus SET  Run manager on CPUs SET, 0-3,8 or node0, shard n on n-th of them\n"
+		"    -W, --bidder-cpus SET   Run forked bidders and gateways on CPUs SET, 0-3,8 or node0\n"
 #ifdef DEBUG
 		"    -d, --debug             Show debugging information\n"
 #endif // DEBUG
 		"\n");
 }
 
+/*
+ * Parse quorum rule "all", "majority", "<N>%" or "<N>"
+ */
+int parse_quorum(const char *rule, QUORUM &quorum)
+{
+	std::string_view text(rule);
+	unsigned int value = 0;
+
+	if (text == "all") {
+		quorum.nRule = QUORUM_ALL;
+		return 1;
+	}
+	if (text == "majority") {
+		quorum.nRule = QUORUM_MAJORITY;
+		return 1;
+	}
+
+	quorum.nRule = QUORUM_COUNT;
+	if (!text.empty() && text.back() == '%') {
+		quorum.nRule = QUORUM_PERCENT;
+		text.remove_suffix(1);
+	}
+
+	std::from_chars_result res = std::from_chars(text.data(), text.data() + text.size(), value);
+	if (res.ec != std::errc() || res.ptr != text.data() + text.size() || value == 0 ||
+	    (quorum.nRule == QUORUM_PERCENT && value > 100)) {
+		err_printf("Invalid quorum \"%s\"", rule);
+		return 0;
+	}
+
+	quorum.nValue = value;
+	return 1;
+}
+
+/*
+ * Parse parent manager "<host>:<port>"
+ */
+int parse_upstream(const char *address, std::string &host, unsigned short &port)
+{
+	std::string_view text(address);
+	size_t colon = text.rfind(':');
+	if (colon == std::string_view::npos || colon == 0) {
+		err_printf("Invalid parent manager \"%s\"", address);
+		return 0;
+	}
+
+	std::string_view number = text.substr(colon + 1);
+	std::from_chars_result res = std::from_chars(number.data(), number.data() + number.size(), port);
+	if (res.ec != std::errc() || res.ptr != number.data() + number.size() || port == 0) {
+		err_printf("Invalid parent manager \"%s\"", address);
+		return 0;
+	}
+
+	host = text.substr(0, colon);
+	return 1;
+}
+
 /*
  * Parse input paramters
  */
 int parse_options(int argc, char **argv)
 {
-	const char *pOpt = "-b:p:d";
+	const char *pOpt = "-b:p:cg:M:T:i:xmj:a:A:s:Hq:t:u:l:k:f:o:SP:B:C:W:d";
 	const struct option cOpt[] = {
 #ifdef DEBUG
 		{ "debug",	no_argument,		NULL, 'd' },		/* show debugging messages */
 #endif
 		{ "bidders",	required_argument,	NULL, 'b' },	/* Set number of bidders */
 		{ "port",	required_argument,	NULL, 'p' },		/* Set port number for manager */
+		{ "coroutines",	no_argument,		NULL, 'c' },	/* Run bidders as coroutines */
+		{ "gateways",	required_argument,	NULL, 'g' },	/* Multiplex bidders over gateways */
+		{ "mode",	required_argument,	NULL, 'M' },		/* Set auction mode */
+		{ "tick",	required_argument,	NULL, 'T' },		/* Set Dutch clock tick */
+		{ "items",	required_argument,	NULL, 'i' },		/* Set items of combinatorial auction */
+		{ "proxy",	no_argument,		NULL, 'x' },		/* Bid through proxies */
+		{ "multi-attribute",	no_argument,	NULL, 'm' },	/* Score bid vectors */
+		{ "threads",	required_argument,	NULL, 'j' },	/* Set number of scoring threads */
+		{ "auctions",	required_argument,	NULL, 'a' },	/* Set number of auctions */
+		{ "auctions-per-bidder",	required_argument,	NULL, 'A' },	/* Join bidders to more auctions */
+		{ "shards",	required_argument,	NULL, 's' },		/* Set number of manager threads */
+		{ "huge-pages",	no_argument,		NULL, 'H' },	/* Use huge pages for pools */
+		{ "quorum",	required_argument,	NULL, 'q' },		/* Set quorum rule of rounds */
+		{ "round-time",	required_argument,	NULL, 't' },	/* Set deadline of rounds */
+		{ "upstream",	required_argument,	NULL, 'u' },	/* Set parent manager */
+		{ "leaves",	required_argument,	NULL, 'l' },		/* Set number of child managers */
+		{ "top-k",	required_argument,	NULL, 'k' },		/* Set best bids reported to parent */
+		{ "feed",	required_argument,	NULL, 'f' },		/* Publish market data */
+		{ "history",	required_argument,	NULL, 'o' },	/* Write bid history */
+		{ "timestamps",	no_argument,		NULL, 'S' },	/* Stamp received bids in kernel */
+		{ "profile",	required_argument,	NULL, 'P' },	/* Set socket tuning profile */
+		{ "busy-poll",	required_argument,	NULL, 'B' },	/* Spin on a pinned core */
+		{ "manager-cpus",	required_argument,	NULL, 'C' },	/* Place manager threads */
+		{ "bidder-cpus",	required_argument,	NULL, 'W' },	/* Place forked bidders */
 		{ NULL, 0, NULL, 0 }
 	};
 
@@ -74,6 +196,159 @@ int parse_options(int argc, char **argv)
 			else
 				res = 1;
 			break;
+		case 'c':
+			opts.coroutines = 1;
+			break;
+		case 'g':
+			if (opts.gateways == 0)
+				opts.gateways = atoll(argv[optind - 1]);
+			else
+				res = 1;
+			break;
+		case 'M':
+			if (strcmp(argv[optind - 1], "sealed") == 0)
+				opts.mode = MODE_SEALED;
+			else if (strcmp(argv[optind - 1], "english") == 0)
+				opts.mode = MODE_ENGLISH;
+			else if (strcmp(argv[optind - 1], "dutch") == 0)
+				opts.mode = MODE_DUTCH;
+			else if (strcmp(argv[optind - 1], "combinatorial") == 0)
+				opts.mode = MODE_COMBINATORIAL;
+			else {
+				err_printf("Invalid mode \"%s\"", argv[optind - 1]);
+				res = 1;
+			}
+			break;
+		case 'T':
+			if (opts.ticktime == 0)
+				opts.ticktime = atoll(argv[optind - 1]);
+			else
+				res = 1;
+			break;
+		case 'i':
+			if (opts.items == 0)
+				opts.items = atoll(argv[optind - 1]);
+			else
+				res = 1;
+			if (opts.items > MAX_ITEMS) {
+				err_printf("At most %u items can be auctioned", MAX_ITEMS);
+				res = 1;
+			}
+			break;
+		case 'x':
+			opts.proxies = 1;
+			break;
+		case 'm':
+			opts.multi = 1;
+			break;
+		case 'j':
+			if (opts.threads == 0)
+				opts.threads = atoll(argv[optind - 1]);
+			else
+				res = 1;
+			break;
+		case 'q':
+			if (!parse_quorum(argv[optind - 1], opts.quorum))
+				res = 1;
+			break;
+		case 't':
+			if (opts.roundtime == 0)
+				opts.roundtime = atoll(argv[optind - 1]);
+			else
+				res = 1;
+			break;
+		case 'u':
+			if (opts.upstream == NULL)
+				opts.upstream = argv[optind - 1];
+			else
+				res = 1;
+			break;
+		case 'l':
+			if (opts.leaves == 0)
+				opts.leaves = atoll(argv[optind - 1]);
+			else
+				res = 1;
+			break;
+		case 'k':
+			if (opts.topk == 0)
+				opts.topk = atoll(argv[optind - 1]);
+			else
+				res = 1;
+			if (opts.topk > MAX_TOP_K) {
+				err_printf("At most %u best bids can be reported", MAX_TOP_K);
+				res = 1;
+			}
+			break;
+		case 'f':
+			if (opts.feed == NULL)
+				opts.feed = argv[optind - 1];
+			else
+				res = 1;
+			break;
+		case 'o':
+			if (opts.history == NULL)
+				opts.history = argv[optind - 1];
+			else
+				res = 1;
+			break;
+		case 'S':
+			opts.timestamps = 1;
+			break;
+		case 'P':
+			if (strcmp(argv[optind - 1], "default") == 0)
+				opts.profile = SOCK_PROFILE_DEFAULT;
+			else if (strcmp(argv[optind - 1], "low-latency") == 0)
+				opts.profile = SOCK_PROFILE_LOW_LATENCY;
+			else if (strcmp(argv[optind - 1], "throughput") == 0)
+				opts.profile = SOCK_PROFILE_THROUGHPUT;
+			else {
+				err_printf("Invalid profile \"%s\"", argv[optind - 1]);
+				res = 1;
+			}
+			break;
+		case 'B':
+			if (opts.busypoll == 0)
+				opts.busypoll = atoll(argv[optind - 1]) + 1;
+			else
+				res = 1;
+			break;
+		case 'C':
+			if (opts.managercpus == NULL)
+				opts.managercpus = argv[optind - 1];
+			else
+				res = 1;
+			break;
+		case 'W':
+			if (opts.biddercpus == NULL)
+				opts.biddercpus = argv[optind - 1];
+			else
+				res = 1;
+			break;
+		case 'H':
+			opts.hugepages = 1;
+			break;
+		case 'a':
+			if (opts.auctions == 0)
+				opts.auctions = atoll(argv[optind - 1]);
+			else
+				res = 1;
+			break;
+		case 'A':
+			if (opts.join == 0)
+				opts.join = atoll(argv[optind - 1]);
+			else
+				res = 1;
+			if (opts.join > MAX_BATCH_BIDS) {
+				err_printf("A bidder can bid in at most %u auctions", MAX_BATCH_BIDS);
+				res = 1;
+			}
+			break;
+		case 's':
+			if (opts.shards == 0)
+				opts.shards = atoll(argv[optind - 1]);
+			else
+				res = 1;
+			break;
 		default:
 			perr_printf("Invalid arguments");
 			Usage();
@@ -90,17 +365,6 @@ int parse_options(int argc, char **argv)
  */
 int main(int argc, char* argv[])
 {
-	/* Set SIGINT handler. */
-	if (signal(SIGINT, signal_handler) == SIG_ERR) {
-		perr_printf("Failed to set SIGINT handler");
-		return 1;
-	}
-	/* Set SIGTERM handler. */
-	if (signal(SIGTERM, signal_handler) == SIG_ERR) {
-		perr_printf("Failed to set SIGTERM handler");
-		return 1;
-	}
-
 	/* parase options */
 	if (!parse_options(argc, argv)) {
 		return 1;
@@ -125,7 +389,126 @@ int main(int argc, char* argv[])
 		}
 	}
 
+	/* federation runs one auction per manager */
+	std::string csUpstream;
+	unsigned short nUpstreamPort = 0;
+	bool bFederated = opts.upstream != NULL || opts.leaves != 0;
+	if (opts.upstream != NULL && !parse_upstream(opts.upstream, csUpstream, nUpstreamPort))
+		return 1;
+	if (bFederated && (opts.auctions > 1 || opts.shards > 1)) {
+		err_printf("A federated manager runs one auction on one shard");
+		return 1;
+	}
+	if (bFederated && opts.mode != MODE_SEALED) {
+		err_printf("A federated manager runs sealed bid rounds");
+		return 1;
+	}
+	/* coroutine and gateway bidders of every manager are numbered from 1, the tree couldn't tell them apart */
+	if (bFederated && (opts.coroutines || opts.gateways != 0)) {
+		err_printf("A federated manager runs its bidders as processes of their own");
+		return 1;
+	}
+
+	if (opts.gateways != 0 && opts.mode == MODE_COMBINATORIAL) {
+		err_printf("Gateway bids are prices only, they can't bid on bundles");
+		return 1;
+	}
+
+	/* batch frames carry sealed bids of forked bidders */
+	if (opts.join > 1 && opts.join > opts.auctions) {
+		err_printf("Bidders can't bid in %u auctions of %u", opts.join, opts.auctions > 1 ? opts.auctions : 1);
+		return 1;
+	}
+	if (opts.join > 1 && (opts.mode != MODE_SEALED || opts.coroutines || opts.gateways != 0 ||
+	    opts.proxies || opts.multi)) {
+		err_printf("Bidders bid in many auctions in sealed bid rounds, as processes of their own");
+		return 1;
+	}
+
+	/*
+	 * Ctrl+C and SIGTERM end the auctions, managers read them from a signalfd
+	 * blocked before any thread starts, so none of them takes the signal
+	 */
+	if (CManager::BlockSignals() != ERR_SUCCESS)
+		return 1;
+
+	CPages::SetHugePages(opts.hugepages);	/* before any pool allocates */
+	CWeightedScoring cScoring;				/* default scoring engine, must outlive manager */
+	CMarketFeed cFeed;						/* market data for watchers, must outlive manager */
+	if (opts.feed != NULL) {
+		std::string csFeed = opts.feed;
+		if (csFeed[0] != '/')
+			csFeed.insert(0, "/");
+		if (cFeed.Create(csFeed, opts.auctions > 1 ? opts.auctions : 1) != ERR_SUCCESS)
+			return 1;
+	}
+	CHistoryFile cHistory;					/* bid history, must outlive manager */
+	if (opts.history != NULL && cHistory.Create(opts.history) != ERR_SUCCESS)
+		return 1;
+	CPlacement cManagerCPUs;				/* where manager runs, must outlive manager */
+	if (opts.managercpus != NULL && !cManagerCPUs.Parse(opts.managercpus))
+		return 1;
+	CPlacement cBidderCPUs;					/* where forked bidders run, must outlive manager */
+	if (opts.biddercpus != NULL && !cBidderCPUs.Parse(opts.biddercpus))
+		return 1;
+
+	if (opts.auctions > 1 || opts.shards > 1) {
+
+		/*
+		 * Many auctions, run them on shards
+		 */
+		CAuctionHouse cHouse(opts.auctions, nBidders, opts.shards, nPort);
+		cHouse.SetCoroutineBidders(opts.coroutines);
+		if (opts.join != 0)
+			cHouse.SetAuctionsPerBidder(opts.join);
+		cHouse.SetGateways(opts.gateways);
+		cHouse.SetProxyBidders(opts.proxies);
+		cHouse.SetMode(opts.mode);
+		if (opts.ticktime != 0)
+			cHouse.SetTickTime(opts.ticktime);
+		if (opts.items != 0)
+			cHouse.SetItems(opts.items);
+		cHouse.SetQuorum(opts.quorum);
+		cHouse.SetRoundTime(opts.roundtime);
+		if (opts.multi)
+			cHouse.SetScoring(&cScoring, opts.threads);
+		if (opts.feed != NULL)
+			cHouse.SetFeed(&cFeed);
+		if (opts.history != NULL)
+			cHouse.SetHistory(&cHistory);
+		cHouse.SetTimestamps(opts.timestamps);
+		cHouse.SetProfile(opts.profile);
+		cHouse.SetBusyPoll(opts.busypoll - 1);
+		cHouse.SetPlacement(&cManagerCPUs, &cBidderCPUs);
+		cHouse.Start();
+		return 0;
+	}
+
 	CManager cManager(nBidders, nPort);		/* Create manager */
+	cManager.SetCoroutineBidders(opts.coroutines);
+	cManager.SetGateways(opts.gateways);
+	cManager.SetProxyBidders(opts.proxies);
+	cManager.SetMode(opts.mode);
+	if (opts.ticktime != 0)
+		cManager.SetTickTime(opts.ticktime);
+	if (opts.items != 0)
+		cManager.SetItems(opts.items);
+	cManager.SetQuorum(opts.quorum);
+	cManager.SetRoundTime(opts.roundtime);
+	if (bFederated) {
+		cManager.SetUpstream(csUpstream, nUpstreamPort);
+		cManager.SetLeaves(opts.leaves, opts.topk != 0 ? opts.topk : DEFAULT_TOP_K);
+	}
+	if (opts.multi)
+		cManager.SetScoring(&cScoring, opts.threads);
+	if (opts.feed != NULL)
+		cManager.SetFeed(&cFeed);
+	if (opts.history != NULL)
+		cManager.SetHistory(&cHistory);
+	cManager.SetTimestamps(opts.timestamps);
+	cManager.SetProfile(opts.profile);
+	cManager.SetBusyPoll(opts.busypoll - 1);
+	cManager.SetPlacement(&cManagerCPUs, &cBidderCPUs);
 	cManager.Start();						/* initialize bidding process */
 	
 	return 0;
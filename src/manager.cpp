@@ -1,20 +1,37 @@
-
 #include "support.h"
 #include "log.h"
 #include "manager.h"
 #include "bidder.h"
+#include "cobidder.h"
+#include "gateway.h"
+
+#include <algorithm>
+
+/*
+ * Signals, manager reads from a signalfd
+ */
+static void ShutdownSignals(sigset_t& cSignals)
+{
+	sigemptyset(&cSignals);
+	sigaddset(&cSignals, SIGINT);
+	sigaddset(&cSignals, SIGTERM);
+}
 
-void ChildSignal(int signal __attribute__((unused)))
+/*
+ * Forked child isn't read from a signalfd, Ctrl+C and SIGTERM end it again
+ */
+static void RestoreSignals()
 {
-	/* Signal handler to check what happened */
-	debug_log("Signal %d child", signal);
-	//while(waitpid(CManager::m_sPID, NULL, WNOHANG) > 0);
+	sigset_t cSignals;
+	ShutdownSignals(cSignals);
+	sigprocmask(SIG_UNBLOCK, &cSignals, NULL);
 }
 
 /*
  * Constructor
  */
-CManager::CManager(unsigned int nBidders/* = DEFAULT_BIDDERS*/, unsigned short nPort/* = DEFAULT_MANAGER_PORT*/)
+CManager::CManager(unsigned int nBidders/* = DEFAULT_BIDDERS*/, unsigned short nPort/* = DEFAULT_MANAGER_PORT*/) :
+	m_cConns(CONN_MAP::allocator_type(&m_cConnPool))
 {
 	/* Initialize port and bidders */
 	if (nPort != 0)
@@ -26,6 +43,52 @@ CManager::CManager(unsigned int nBidders/* = DEFAULT_BIDDERS*/, unsigned short n
 		m_nBidders = nBidders;
 	else
 		m_nBidders = DEFAULT_BIDDERS;			/* Set default bidders i.e. 3 */
+
+	m_cQuorum.nRule = QUORUM_ALL;
+	m_cQuorum.nValue = 0;
+	m_nRoundTime = 0;
+	m_bBackpressure = false;
+	m_nUpstreamPort = 0;
+	m_nUpstream = INVALID_SOCKET;
+	m_nLeaves = 0;
+	m_nTopK = DEFAULT_TOP_K;
+	m_nFedState = FED_JOINING;
+	m_nTop = 0;
+	m_nEpoll = INVALID_SOCKET;
+	m_bCoroutines = false;
+	m_nJoin = 1;
+	m_nAuctionCount = 1;
+	m_bProxies = false;
+	m_nMode = MODE_SEALED;
+	m_nTickTime = DEFAULT_TICK_TIME;
+	m_nItems = DEFAULT_ITEMS;
+	m_pSolver = NULL;
+	m_pFeed = NULL;
+	m_nClockTimer = INVALID_SOCKET;
+	m_bClockRunning = false;
+	m_nArrival = 0;
+	m_bTimestamps = false;
+	m_nProfile = SOCK_PROFILE_DEFAULT;
+	m_nSpinCPU = -1;
+	m_pManagerCPUs = NULL;
+	m_pBidderCPUs = NULL;
+	m_nSpinTime = SPIN_START_TIME * 1000ULL;
+	memset(&m_cSpin, 0, sizeof(m_cSpin));
+	m_nKernelArrival = 0;
+	memset(&m_cQueueing, 0, sizeof(m_cQueueing));
+	m_nGateways = 0;
+	m_nStaleBids = 0;
+	m_nSignals = INVALID_SOCKET;
+	m_bStopping = false;
+	m_bDrained = false;
+	m_pScoring = NULL;
+	m_pPool = NULL;
+	m_nThreads = 0;
+	m_nScoreEvent = INVALID_SOCKET;
+	m_pShards = NULL;
+	m_nShard = 0;
+	m_nHandoffEvent = INVALID_SOCKET;
+	m_bClosing = false;
 }
 
 /*
@@ -33,12 +96,92 @@ CManager::CManager(unsigned int nBidders/* = DEFAULT_BIDDERS*/, unsigned short n
  */
 CManager::~CManager()
 {
+	/* finish scoring jobs, they use this manager */
+	m_bClosing = true;
+	delete m_pPool;
+	delete m_pSolver;
+	if (m_nScoreEvent != INVALID_SOCKET)
+		close(m_nScoreEvent);
+	if (m_nClockTimer != INVALID_SOCKET)
+		close(m_nClockTimer);
+	if (m_nSignals != INVALID_SOCKET)
+		close(m_nSignals);
+
+	/* reap whoever has exited, init takes the rest once we are gone */
+	for (std::map<int, CHILD>::const_iterator cIter = m_cChildren.begin();
+		cIter != m_cChildren.end();
+		++ cIter) {
+		waitpid((*cIter).second.nPID, NULL, WNOHANG);
+		close((*cIter).first);
+	}
+
+	/* close connections, nobody has taken from us */
+	HANDOFF cHandoff;
+	while (m_cHandoffs.Pop(cHandoff))
+		close(cHandoff.nSocket);
+	for (std::list<std::pair<CManager*, HANDOFF> >::const_iterator cIter = m_cDeferred.begin();
+		cIter != m_cDeferred.end();
+		++ cIter)
+		close((*cIter).second.nSocket);
+	if (m_nHandoffEvent != INVALID_SOCKET)
+		close(m_nHandoffEvent);
+
+	/* close bidder connections */
+	for (CONN_MAP::const_iterator cIter = m_cConns.begin();
+		cIter != m_cConns.end();
+		++ cIter)
+		close((*cIter).first);
+
+	if (m_nEpoll != INVALID_SOCKET)
+		close(m_nEpoll);
 }
 
 /*
  * Start Process
  */
 int CManager::Start()
+{
+	int nRes = 0;
+	debug_log("Entering %s ...", __FUNCTION__);
+	try {
+		nRes = Listen();
+		if (nRes != ERR_SUCCESS)
+			throw nRes;
+
+		/* Run default auction, unless we are told otherwise */
+		if (m_cAuctions.empty())
+			AddAuction(DEFAULT_AUCTION);
+
+		/* Create bidders */
+		if (m_nGateways != 0)
+			nRes = CreateGateways();
+		else if (m_bCoroutines)
+			nRes = CreateCoBidders();
+		else
+			nRes = CreateBidders();
+		if (nRes != ERR_SUCCESS)
+			throw nRes;
+
+		/*
+		 * Bidders are created
+		 * Start accepting the bids
+		 */
+		nRes = AcceptBidders();
+	}
+	catch (std::exception e) {
+		perr_printf(e.what());
+	}
+	catch (...) {
+		err_printf("Unknown Exception...");
+	}
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	return nRes;
+}
+
+/*
+ * Create manager socket, and listen on it
+ */
+int CManager::Listen()
 {
 	int nRes = 0;
 	debug_log("Entering %s ...", __FUNCTION__);
@@ -50,8 +193,18 @@ int CManager::Start()
 			throw nRes;
 		}
 
+		/* Many bidders need many sockets, use all we are allowed */
+		struct rlimit cLimit;
+		if (getrlimit(RLIMIT_NOFILE, &cLimit) == 0 && cLimit.rlim_cur < cLimit.rlim_max) {
+			cLimit.rlim_cur = cLimit.rlim_max;
+			if (setrlimit(RLIMIT_NOFILE, &cLimit) == -1)
+				perr_printf("Couldn't raise open file limit");
+		}
+
 		/* Create the server socket */
 		debug_log("Creating manager");
+		m_cServer.SetReusePort(m_pShards != NULL);	/* every shard listens on the same port */
+		m_cServer.SetProfile(m_nProfile);
 		if (!m_cServer.Create(m_nServerPort, SOCK_STREAM)) {
 			debug_log("Manager creation failed");
 			nRes = ERR_SOCKET_OPEN;
@@ -66,8 +219,26 @@ int CManager::Start()
 			throw nRes;
 		}
 
-		/* Create bidders */
-		CreateBidders();
+		/* bidders are accepted with it, bidding goes on without it */
+		if (m_bTimestamps && !m_cServer.EnableTimestamps())
+			m_bTimestamps = false;
+
+		/* Manager accepts from epoll, it must never block in accept */
+		if (!m_cServer.SetNonBlocking()) {
+			nRes = ERR_SOCKET_SETOPT;
+			throw nRes;
+		}
+
+		/*
+		 * Other shards hand connections to us from now on
+		 * even before our thread runs
+		 */
+		m_nHandoffEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (m_nHandoffEvent == INVALID_SOCKET) {
+			perr_printf("eventfd failed");
+			nRes = ERR_EPOLL;
+			throw nRes;
+		}
 	}
 	catch (std::exception e) {
 		perr_printf(e.what());
@@ -79,74 +250,122 @@ int CManager::Start()
 	return nRes;
 }
 
+/*
+ * Host an auction
+ */
+int CManager::AddAuction(unsigned int nAuction)
+{
+	AUCTION& cAuction = m_cAuctions[nAuction];
+	cAuction.cBids = BID_MAP(BID_MAP::allocator_type(&m_cBidPool));
+	cAuction.nAuction = nAuction;
+	cAuction.nSlots = 0;
+	cAuction.nBatched = 0;
+	cAuction.nReplies = 0;
+	cAuction.nLiveReplies = 0;
+	cAuction.bStarted = false;
+	cAuction.nRound = 0;
+	cAuction.nClosedRound = 0;
+	cAuction.nRoundStart = 0;
+	cAuction.nDeadline = 0;
+	cAuction.nHeap = NOT_SCHEDULED;
+	cAuction.nScoring = 0;
+	cAuction.bRoundFull = false;
+	cAuction.nProxies = 0;
+	cAuction.nHighBid = 0;
+	cAuction.nHighBidder = 0;
+	cAuction.bPriceDirty = false;
+	cAuction.nPriceFlush = 0;
+	cAuction.nClockPrice = 0;
+	cAuction.nAccepted = 0;
+	Publish(cAuction);
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Create bidders for every auction
+ */
 int CManager::CreateBidders()
 {
 	int nRes = 0;					/* result */
 	debug_log("Entering %s ...", __FUNCTION__);	/* debug message for entry point function */
 	try {
-		for (size_t nBidder = 0; nBidder < m_nBidders; ++ nBidder) {	/* iterate through all bidders to create them */
-
-			/* attach a signal handler to find child termination */
-			struct sigaction signal;
-			signal.sa_handler = ChildSignal;
-			sigemptyset(&signal.sa_mask);
-			signal.sa_flags = SA_RESTART;
-			if (sigaction(SIGCHLD, &signal, NULL) == -1)
-				perr_printf("Could not attach signal.\n");	/* couldn't attach signal, print error */
-
-			debug_log("Creating %d bidder", nBidder);		/* debug log to show number of bidders */
-			pid_t nPID = fork();							/* create new processes */
-			if (nPID == -1) {
-				/* fork failed */
-				perr_printf("Couldn't fork");
-				nRes = ERR_FORK_FAILED;
-				throw nRes;
-			}
-			else if (nPID == 0) {
-				/* child process */
+		for (std::map<unsigned int, AUCTION>::iterator cAuction = m_cAuctions.begin();
+			cAuction != m_cAuctions.end();
+			++ cAuction) {
+			for (size_t nBidder = 0; nBidder < m_nBidders; ++ nBidder) {	/* iterate through all bidders to create them */
+
+				debug_log("Creating %zu bidder", nBidder);		/* debug log to show number of bidders */
+				pid_t nPID = fork();							/* create new processes */
+				if (nPID == -1) {
+					/* fork failed */
+					perr_printf("Couldn't fork");
+					nRes = ERR_FORK_FAILED;
+					throw nRes;
+				}
+				else if (nPID == 0) {
+					/* child process */
+					RestoreSignals();
+					if (m_pBidderCPUs != NULL)
+						m_pBidderCPUs->Apply();
 #ifdef DEBUG
-				sleep(10);
-				debug_log("wait for child ended");
+					sleep(10);
+					debug_log("wait for child ended");
 #endif
 
-				unsigned short uSockPort = 0;
-				std::string csAddress;
-				if (!m_cServer.GetSockName(csAddress, uSockPort)) {	/* get socket address */
-					perr_printf("Couldn't get Manager's address");
-					nRes = ERR_GET_SOCK_NAME;
-					return -1;	/* just return, as this is another process now */
-				}
+					unsigned short uSockPort = 0;
+					std::string csAddress;
+					if (!m_cServer.GetSockName(csAddress, uSockPort)) {	/* get socket address */
+						perr_printf("Couldn't get Manager's address");
+						exit(ERR_GET_SOCK_NAME);	/* just exit, as this is another process now */
+					}
 
-				CBidder cBidder(csAddress, m_nServerPort);	/* create bidder */
-				cBidder.Init();		/* Initialize bidder */
+					CBidder cBidder(csAddress, m_nServerPort);	/* create bidder */
+					cBidder.SetAuction((*cAuction).first);
+					for (unsigned int nJoin = 1; nJoin < m_nJoin; ++ nJoin)
+						cBidder.AddAuction(((*cAuction).first - 1 + nJoin) % m_nAuctionCount + 1);
+					cBidder.SetMultiAttribute(m_pScoring != NULL);
+					cBidder.SetProxy(m_bProxies);
+					cBidder.SetProfile(m_nProfile);
+					cBidder.Init();		/* Initialize bidder */
 
-				/*
-				 * client is created, check for incoming messages
-				 */
-				int nTimeout = 0;
-				int nRes = 0;
-				while (1) {
-					nRes = cBidder.RecieveOrder(nTimeout);	/* wait unless bidders recieve the message to start bids */
-					if (nRes < 0 && nRes != ERR_TIMEOUT)
-						break;
-					nRes = cBidder.SendBid();		/* start bidding */
-					if (nRes < 0 && nRes != ERR_TIMEOUT)
-						break;
+					/*
+					 * client is created, check for incoming messages
+					 */
+					int nTimeout = 0;
+					int nRes = 0;
+					while (1) {
+						nRes = cBidder.RecieveOrder(nTimeout);	/* wait unless bidders recieve the message to start bids */
+						if (nRes == ERR_KEEP_WAITING || nRes == ERR_TIMEOUT)
+							continue;	/* no complete order yet */
+						if (nRes < 0)
+							break;
+						nRes = cBidder.SendBid();		/* start bidding */
+						if (nRes < 0 && nRes != ERR_TIMEOUT)
+							break;
+					}
+					debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+					exit(0);
 				}
-				debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
-				exit(0);
-			}
-			else {
-				/* parent process */
-				log_message("#%d bidder's PID is %d.", nBidder, nPID);	/* print bidder PID */
-				INFO cInfo = { 0 };
-				m_cBids.insert(std::make_pair(nPID, cInfo));		/* add pid to map, in order to wait for them */
-				if (nBidder == m_nBidders - 1) {
+				else {
+					/* parent process */
+					log_message("#%zu bidder's PID is %d, auction %u.", nBidder, nPID, (*cAuction).first);	/* print bidder PID */
+					AddBidder((*cAuction).second, nPID);		/* add pid to map, in order to wait for them */
+					m_cForked.push_back(CHILD { nPID, (*cAuction).first });	/* reaped, once it exits */
+
 					/*
-					 * Bidders have recieved the start message
-					 * Start accepting the bids
+					 * Other auctions take his batch entries too
+					 * shards don't run yet, so their maps are ours to fill
 					 */
-					AcceptBidders();
+					for (unsigned int nJoin = 1; nJoin < m_nJoin; ++ nJoin) {
+						unsigned int nJoined = ((*cAuction).first - 1 + nJoin) % m_nAuctionCount + 1;
+						CManager* pShard = ShardOf(nJoined);
+						AUCTION* pJoined = pShard->FindAuction(nJoined);
+						if (pJoined == NULL)
+							continue;
+						pShard->AddBidder(*pJoined, nPID, true);
+						m_cJoined[nPID].push_back(nJoined);
+					}
 				}
 			}
 		}
@@ -161,352 +380,212 @@ int CManager::CreateBidders()
 	return nRes;
 }
 
-int CManager::StartBidding()
+/*
+ * Create coroutine bidders
+ * All bidders of all auctions run in one forked process, on one event loop
+ */
+int CManager::CreateCoBidders()
 {
-	int nRes = 0;
+	int nRes = 0;					/* result */
 	debug_log("Entering %s ...", __FUNCTION__);
-	char cBuffer[MAX_MESSAGE_SIZE] = { 0 };
-	size_t nBufferLen = 0;
 	try {
 		/*
-		 * Send 'start' message to bidders
-		 * once bidders receive this, they will start bidding
-		 */
-		sprintf(cBuffer, "start");
-		nBufferLen = strlen(cBuffer);
-		nRes = SendToAll(cBuffer, nBufferLen);	/* Send to all bidders */
-		/*
-		 * TODO: check for errors
+		 * Bidders share a PID, so manager gives them ids
 		 */
+		for (std::map<unsigned int, AUCTION>::iterator cAuction = m_cAuctions.begin();
+			cAuction != m_cAuctions.end();
+			++ cAuction) {
+			for (pid_t nID = 1; nID <= (pid_t) m_nBidders; ++ nID) {
+				AddBidder((*cAuction).second, nID);
+			}
+		}
+
+		pid_t nPID = fork();							/* create bidders' process */
+		if (nPID == -1) {
+			/* fork failed */
+			perr_printf("Couldn't fork");
+			nRes = ERR_FORK_FAILED;
+			throw nRes;
+		}
+		else if (nPID == 0) {
+			/* child process */
+			RestoreSignals();
+			if (m_pBidderCPUs != NULL)
+				m_pBidderCPUs->Apply();
+			unsigned short uSockPort = 0;
+			std::string csAddress;
+			if (!m_cServer.GetSockName(csAddress, uSockPort)) {	/* get socket address */
+				perr_printf("Couldn't get Manager's address");
+				exit(ERR_GET_SOCK_NAME);
+			}
+
+			/*
+			 * Start every bidder, they run until they suspend on their socket
+			 * loop resumes them, unless all are killed
+			 */
+			CEventLoop cLoop;
+			std::list<CCoBidder> cBidders;
+			for (std::map<unsigned int, AUCTION>::const_iterator cAuction = m_cAuctions.begin();
+				cAuction != m_cAuctions.end();
+				++ cAuction) {
+				for (BID_MAP::const_iterator cIter = (*cAuction).second.cBids.begin();
+					cIter != (*cAuction).second.cBids.end();
+					++ cIter) {
+					cBidders.emplace_back(cLoop, csAddress, m_nServerPort, (*cIter).first, (*cAuction).first);
+					cBidders.back().SetMultiAttribute(m_pScoring != NULL);
+					cBidders.back().SetProxy(m_bProxies);
+					cBidders.back().SetProfile(m_nProfile);
+					cBidders.back().Run();
+				}
+			}
+
+			nRes = cLoop.Run();
+			debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+			exit(0);
+		}
+		else {
+			/* parent process */
+			log_message("%zu bidders are running in PID %d.", m_nBidders * m_cAuctions.size(), nPID);
+			m_cForked.push_back(CHILD { nPID, 0 });
+		}
 	}
 	catch (std::exception e) {
 		perr_printf(e.what());
 	}
 	catch (...) {
-		err_printf("Unknown exception...");
+		err_printf("Unknown Exception...");
 	}
 	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
 	return nRes;
 }
 
 /*
- * AcceptBidding
+ * Create gateways
+ * Bidders of an auction are spread over its gateways, all gateways run in one forked process
  */
-int CManager::AcceptBidders(int nTimeout/* = 0*/)
+int CManager::CreateGateways()
 {
-	int nRes = 0;
+	int nRes = 0;					/* result */
 	debug_log("Entering %s ...", __FUNCTION__);
 	try {
-		struct timeval cTimeout;
-		fd_set cReadSet;
-		fd_set cMasterSet;
-		ssize_t nBytesRecv = 0;
-		char cBuffer[MAX_MESSAGE_SIZE_2] = { 0 };
-		int nMaxSocket = m_cServer.GetSockHandle();
-		int nBidders = 0;
-
-		FD_ZERO(&cReadSet);
-		FD_ZERO(&cMasterSet);
-
-		FD_SET(m_cServer.GetSockHandle(), &cMasterSet);
-
-		if (nTimeout) {
-			cTimeout.tv_sec = nTimeout;	/* Set the tiem interval */
-			cTimeout.tv_usec = 0;
+		/*
+		 * Virtual bidders have no PID, so manager gives them ids
+		 */
+		for (std::map<unsigned int, AUCTION>::iterator cAuction = m_cAuctions.begin();
+			cAuction != m_cAuctions.end();
+			++ cAuction) {
+			for (pid_t nID = 1; nID <= (pid_t) m_nBidders; ++ nID) {
+				AddBidder((*cAuction).second, nID);
+			}
 		}
 
-		debug_log("Manager has started to link clients");
-		while (true) {
+		pid_t nPID = fork();							/* create gateways' process */
+		if (nPID == -1) {
+			/* fork failed */
+			perr_printf("Couldn't fork");
+			nRes = ERR_FORK_FAILED;
+			throw nRes;
+		}
+		else if (nPID == 0) {
+			/* child process */
+			RestoreSignals();
+			if (m_pBidderCPUs != NULL)
+				m_pBidderCPUs->Apply();
+			unsigned short uSockPort = 0;
+			std::string csAddress;
+			if (!m_cServer.GetSockName(csAddress, uSockPort)) {	/* get socket address */
+				perr_printf("Couldn't get Manager's address");
+				exit(ERR_GET_SOCK_NAME);
+			}
 
-			if (m_cBids.size() == 0)	/* If no more bidders, no more data to recv */
-				break;
-			cReadSet = cMasterSet;
-			if (nTimeout == 0)
-				nRes = select(nMaxSocket + 1, &cReadSet, NULL, NULL, NULL);
-			else
-				nRes = select(nMaxSocket + 1, &cReadSet, NULL, NULL, &cTimeout);
+			/*
+			 * Bidder n of an auction is on gateway n % gateways
+			 */
+			CEventLoop cLoop;
+			std::list<CGateway> cGateways;
+			for (std::map<unsigned int, AUCTION>::const_iterator cAuction = m_cAuctions.begin();
+				cAuction != m_cAuctions.end();
+				++ cAuction) {
+				std::vector<CGateway*> cAuctionGateways;
+				for (pid_t nID = 1; nID <= (pid_t) m_nGateways; ++ nID) {
+					cGateways.emplace_back(cLoop, csAddress, m_nServerPort, nID, (*cAuction).first);
+					cGateways.back().SetProfile(m_nProfile);
+					cAuctionGateways.push_back(&cGateways.back());
+				}
 
-			if (nRes == 0)
-				nRes = ERR_TIMEOUT;
-			if (nRes == -1) {
-				if (errno == EINTR)
-					continue;
+				for (BID_MAP::const_iterator cIter = (*cAuction).second.cBids.begin();
+					cIter != (*cAuction).second.cBids.end();
+					++ cIter)
+					cAuctionGateways[(*cIter).first % m_nGateways]->AddBidder((*cIter).first);
 
-				perr_printf("select failed");
-				throw nRes;
+				for (size_t nGateway = 0; nGateway < cAuctionGateways.size(); ++ nGateway)
+					cAuctionGateways[nGateway]->Run();
 			}
-			else {
-				int nClient = 0;
-				for (nClient = 0; nClient <= nMaxSocket; ++ nClient) {
-					if (FD_ISSET(nClient, &cReadSet)) {
-						if (nClient == m_cServer.GetSockHandle()) {
-							/* Accept new connection */
-							struct sockaddr_in cClientAddr;
-							socklen_t nAddrLength = sizeof(cClientAddr);
-							int nNewSocket = accept(m_cServer.GetSockHandle(),
-										(struct sockaddr*) &cClientAddr,
-										&nAddrLength);
-							if (nNewSocket == INVALID_SOCKET) {
-								perr_printf("Couldn't accept client connection");
-								continue;
-							}
-							
-							/*
-							 * Set the id of net socket in our set
-							 */
-							FD_SET(nNewSocket, &cMasterSet);
-							if (nNewSocket > nMaxSocket)
-								nMaxSocket = nNewSocket;
-							sprintf(cBuffer, "New connection %s on socket %d (0x%x)",
-								inet_ntoa(cClientAddr.sin_addr),
-								nNewSocket,
-								nNewSocket);
-
-							debug_log(cBuffer);
-
-							strcat(cBuffer, "\n");
-							nBytesRecv = strlen(cBuffer);
-							memset(cBuffer, '\0', nBytesRecv);
-
-							/*
-							 * Receive the data from new connection
-							 */
-							nBytesRecv = recv(nNewSocket, cBuffer, MAX_MESSAGE_SIZE_2, 0);
-							if (nBytesRecv <= 0) {
-								if (nBytesRecv == 0) {
-									struct sockaddr_in cClientAddr;
-									err_printf("Connection closed while checking new connections");
-								}
-								else if (nBytesRecv == INVALID_SOCKET) {
-									perr_printf("Couldn't receive data from socket %d (0x%x)",
-										nClient,
-										nClient);
-								}
-								close(nClient);
-								FD_CLR(nClient, &cMasterSet);
-							}
-							else {
-								/*
-								* new connection should send it's pid_t, and bid if available
-								* we already have nNewSocket as SOCKET
-								* insert all this information in m_cBids
-								*/
-								unsigned short nPort = 0;
-								pid_t nPID = 0;
-								std::string csID;
-								std::string csItem;
-								std::string csLine = cBuffer;
-
-								csItem = csLine.substr(0, csLine.find(":"));
-								nPort = atoi(csItem.c_str());		/* Get port number of bidder */
-
-								int nIndex = csLine.find(":") + 1;
-								csItem = csLine.substr(nIndex, csLine.rfind(":") - nIndex);
-								nPID = atoi(csItem.c_str());		/* Get PID of bidder */
 
-#ifdef DEBUG
-								const char* pID = csID.c_str();
-								debug_log("after parsing message %d: %d", nPort, nPID);
-#endif
-								std::map<pid_t, INFO>::iterator cIter = m_cBids.find(nPID);	/* Find the PID in our map */
-								if (cIter != m_cBids.end()) {
-
-									(*cIter).second.nSocket = nNewSocket;
-									debug_log("Client has sent: PID:%d SOCKET:%d",
-										(*cIter).first,
-										nNewSocket);
-									++ nBidders;		/* we have a connection, increment it */
-									if (nBidders == m_nBidders) {
-										/*
-										 * We have information from all bidders
-										 * Let's start bidding process
-										 */
-										StartBidding();
-										nBidders = 0;
-									}
-								}
-								else {
-
-									/*
-									 * Manager don't have this bidder in map
-									 * Report it
-									 */
-									err_printf("Can't find ID %d in map", nPID);
-								}
-							}
-						}
-						else {
-							/* data from client */
-							debug_log("recv from client");
-							memset(cBuffer, '\0', MAX_MESSAGE_SIZE_2);
-							nBytesRecv = recv(nClient, cBuffer, MAX_MESSAGE_SIZE_2, 0);
-							if (nBytesRecv <= 0) {
-								if (nBytesRecv == 0) {
-
-									/*
-									 * This bidder has left
-									 */
-									struct sockaddr_in cClientAddr;
-									err_printf("Connection closed");
-									socklen_t addr_length = sizeof(cClientAddr);
-									getsockname(nClient, (struct sockaddr*) &cClientAddr, &addr_length);
-									sprintf(cBuffer, "Client %d from %s left",
-										nClient, inet_ntoa(cClientAddr.sin_addr));
-									err_printf(cBuffer);
-
-									/*
-									* remove this item from our list m_cBids
-									*/
-									DeleteBidder(nClient);
-								}
-								else if (nBytesRecv == INVALID_SOCKET) {
-									perr_printf("Couldn't receive data from socket %d (0x%x)",
-										nClient,
-										nClient);
-								}
-								close(nClient);
-								FD_CLR(nClient, &cMasterSet);
-							}
-							else {
-								/*
-								* Bid is sent in message
-								*/
-								pid_t nPID = 0;
-								std::string csLine = cBuffer;
-								std::string csPID;
-								std::string csBid;
-								int nIndex = csLine.find(":");
-								int nNextIndex = csLine.find(":", nIndex + 1);
-
-								csPID = csLine.substr(0, nIndex);
-								nPID = atoi(csPID.c_str());	/* PID */
-
-								++ nIndex; /* space */
-								csBid = csLine.substr(nIndex + 1, nNextIndex - (nIndex + 1));	/* Bid */
-#ifdef DEBUG
-								const char* pPID = csPID.c_str();
-								const char* pBid = csBid.c_str();
-								debug_log("Client sent: PID \"%s\" Bid \"%s\"", pPID, pBid);
-#endif
-								/*
-								 * Find the bidder in Manager's map
-								 */
-								std::map<pid_t, INFO>::iterator cIter = m_cBids.find(nPID);
-								if (cIter != m_cBids.end()) {
-
-									/*
-									 * Bidder found, update the map with his bid
-									 */
-									(*cIter).second.nBid = atoi(csBid.c_str());
-									debug_log("PID:%d BID:%d",
-										(*cIter).first,
-										(*cIter).second.nBid);
-									++ nBidders;
-									if (nBidders == m_nBidders) {
-										/*
-										 * We got the last bid
-										 * Now compare the bids
-										 */
-										nRes = FindWinner();
-										if (nRes == ERR_RESTART_BIDS) {
-
-											/*
-											 * More than one winners
-											 * Losers are removed
-											 * Restart bidding
-											 */
-											nBidders = 0;
-											StartBidding();
-										}
-										else if (nRes == ERR_MANAGER_DONE) {
-											/*
-											 * Winner declared, end Manager
-											 */
-											break;
-										}
-									}
-								}
-								else {
-
-									/*
-									 * Couldn't find the bidder in map
-									 * Report it
-									 */
-									err_printf("Can't find ID %s in map", csPID.c_str());
-								}
-							}
-						}
-					}
-				}
-			}
+			nRes = cLoop.Run();
+			debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+			exit(0);
+		}
+		else {
+			/* parent process */
+			log_message("%zu bidders behind %zu gateways are running in PID %d.",
+				m_nBidders * m_cAuctions.size(), m_nGateways * m_cAuctions.size(), nPID);
+			m_cForked.push_back(CHILD { nPID, 0 });
 		}
 	}
 	catch (std::exception e) {
 		perr_printf(e.what());
 	}
 	catch (...) {
-		err_printf("Unknown exception...");
-	}
-	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
-	return nRes;
-}
-
-/*
- * Send the data to all bidders
- */
-int CManager::SendToAll(const char* pBuffer, size_t nSize)
-{
-	int nRes = 0;
-	debug_log("Entering %s ...", __FUNCTION__);
-	std::map<pid_t, INFO>::const_iterator cIter = m_cBids.begin();
-	while (cIter != m_cBids.end()) {
-		/*
-		 * If the bidder has a valid socket
-		 * Send him data through that socket
-		 */
-		if ((*cIter).second.nSocket != 0) {
-
-			/*
-			 * Send all data
-			 */
-			nRes = SendAllData((*cIter).second.nSocket,
-				       pBuffer,
-				       &nSize);
-		}
-		++ cIter;
+		err_printf("Unknown Exception...");
 	}
 	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
 	return nRes;
 }
 
-/*
- * Send kill message to bidder
- */
-int CManager::SendKill(int nSock, pid_t nPID)
+int CManager::StartBidding(AUCTION& cAuction)
 {
 	int nRes = 0;
 	debug_log("Entering %s ...", __FUNCTION__);
 	char cBuffer[MAX_MESSAGE_SIZE] = { 0 };
 	size_t nBufferLen = 0;
 	try {
-		DeleteBidder(nSock);	/* Remove him from map before killing him */
-		sprintf(cBuffer, "kill");
-		nBufferLen = strlen(cBuffer);
-
 		/*
-		 * Send all data to bidder
+		 * Send 'start' message to bidders
+		 * once bidders receive this, they will start bidding
 		 */
-		nRes = SendAllData(nSock, cBuffer, &nBufferLen);
+		FlushKills();		/* gateways must not bid for bidders, who lost last round */
+		cAuction.nRoundStart = CScheduler::Now();
+		if (m_nMode == MODE_DUTCH) {
+			/*
+			 * Dutch auction starts with the first price on clock
+			 * bidders accept a tick, they don't bid
+			 */
+			cAuction.nClockPrice = DUTCH_START_PRICE;
+			nBufferLen = sprintf(cBuffer, "tick %u\n", cAuction.nClockPrice);
+			nRes = SendToAll(cAuction, cBuffer, nBufferLen);
+			StartClock();
+		}
+		else if (m_nMode == MODE_COMBINATORIAL) {
+			/* bidders bid on bundles of these items */
+			nBufferLen = sprintf(cBuffer, "bundles %u\n", m_nItems);
+			nRes = SendToAll(cAuction, cBuffer, nBufferLen);
+		}
+		else {
+			nBufferLen = sprintf(cBuffer, "start %u.%u\n", cAuction.nAuction, cAuction.nRound);
+			nRes = SendToAll(cAuction, cBuffer, nBufferLen);	/* Send to all bidders */
+			ProxyBids(cAuction);
+		}
 		/*
 		 * TODO: check for errors
 		 */
-#if 0
-		/*
-		 * Manager can also send kill signal
-		 * But Manager uses TCP/IP
-		 */
-		nRes = kill(nPID, SIGUSR1);
-#endif
+
+		/* round closes at its deadline, if quorum doesn't close it first */
+		if (m_nRoundTime != 0)
+			m_cScheduler.Schedule(&cAuction, CScheduler::Now() + m_nRoundTime * 1000000ULL);
+		else if (m_nMode == MODE_ENGLISH)
+			m_cScheduler.Schedule(&cAuction, CScheduler::Now() + DEFAULT_CLOSE_TIME * 1000000ULL);
+		Publish(cAuction);
 	}
 	catch (std::exception e) {
 		perr_printf(e.what());
@@ -519,132 +598,2905 @@ int CManager::SendKill(int nSock, pid_t nPID)
 }
 
 /*
- * Send all data
- * Only required when data length is more
- * Manager data is small, and always send it in one pass
+ * AcceptBidding
  */
-int CManager::SendAllData(int nSock, const char* pBuffer, size_t* pSize)
+int CManager::AcceptBidders(int nTimeout/* = 0*/)
 {
 	int nRes = 0;
-	ssize_t nBytesLeft = *pSize;
-	ssize_t nBytesSent = 0;
-	ssize_t nWritten = 0;
-
 	debug_log("Entering %s ...", __FUNCTION__);
+	try {
+		struct epoll_event cEvents[MAX_EPOLL_EVENTS];
+		struct epoll_event cEvent;
+		int nWait = -1;
+		time_t nDrainEnd = 0;
 
-	/*
-	 * keep sending the data, unless we have some
-	 */
-	while (nBytesLeft != 0) {
-		debug_log("sending %s to client %d", pBuffer, nSock);
+		if (nTimeout)
+			nWait = nTimeout * 1000;	/* Set the time interval in ms */
 
 		/*
-		 * Send the data
+		 * Create epoll, and add manager socket to it
+		 * bidder sockets are added once accepted
 		 */
-		nWritten = send(nSock, pBuffer + nBytesSent, nBytesLeft, 0);
-		if (nWritten == -1) {
-			nRes = ERR_SOCKET_SEND;
-			break;
+		m_nEpoll = epoll_create1(EPOLL_CLOEXEC);
+		if (m_nEpoll == INVALID_SOCKET) {
+			perr_printf("epoll_create failed");
+			nRes = ERR_EPOLL;
+			throw nRes;
+		}
+
+		memset(&cEvent, 0, sizeof(cEvent));
+		cEvent.events = EPOLLIN;
+		cEvent.data.fd = m_cServer.GetSockHandle();
+		if (epoll_ctl(m_nEpoll, EPOLL_CTL_ADD, m_cServer.GetSockHandle(), &cEvent) == INVALID_SOCKET) {
+			perr_printf("Couldn't add manager to epoll");
+			nRes = ERR_EPOLL;
+			throw nRes;
+		}
+
+		cEvent.events = EPOLLIN;
+		cEvent.data.fd = m_nHandoffEvent;
+		if (epoll_ctl(m_nEpoll, EPOLL_CTL_ADD, m_nHandoffEvent, &cEvent) == INVALID_SOCKET) {
+			perr_printf("Couldn't add handoff event to epoll");
+			nRes = ERR_EPOLL;
+			throw nRes;
 		}
 
 		/*
-		 * Calculate the data send and remaining
+		 * Manager threads keep off bidders' CPUs, memory stays on their nodes
+		 * scoring and solver threads, started below, inherit it
 		 */
-		nBytesLeft -= nWritten;
-		nBytesSent += nWritten;
-	}
+		if (m_pManagerCPUs != NULL && m_pManagerCPUs->Apply() == ERR_SUCCESS && m_pManagerCPUs->IsSet())
+			log_message("Shard %u runs on CPUs %s", m_nShard, m_pManagerCPUs->GetSpec().c_str());
 
-	*pSize = nBytesSent;
-	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
-	return nRes;
-}
+		/* Scoring threads start here, after bidders are forked */
+		if (m_pScoring != NULL) {
+			nRes = StartScoring();
+			if (nRes != ERR_SUCCESS)
+				throw nRes;
+		}
 
-/*
- * Find the winner
- */
-int CManager::FindWinner()
-{
-	int nRes = 0;
-	debug_log("Entering %s ...", __FUNCTION__);
-	try {
-		int nMaxBid = 0;
-		for (std::map<pid_t, INFO>::const_iterator cIter = m_cBids.begin();
-			cIter != m_cBids.end();
-			++ cIter) {
+		/* winner determination of bundles runs on its own threads */
+		if (m_nMode == MODE_COMBINATORIAL)
+			m_pSolver = new CWinnerSolver(m_nThreads);
 
-			/*
-			 * Find maximum bidder
-			 */
-			if (nMaxBid < (*cIter).second.nBid)
-				nMaxBid = (*cIter).second.nBid;
+		/*
+		 * Dutch clock is a timerfd in epoll
+		 * ticks come on time, whatever else the loop is doing
+		 */
+		if (m_nMode == MODE_DUTCH) {
+			m_nClockTimer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+			if (m_nClockTimer == INVALID_SOCKET) {
+				perr_printf("timerfd_create failed");
+				nRes = ERR_EPOLL;
+				throw nRes;
+			}
 
-			/*
-			 * Log message for all bids
-			 */
-			log_message("Bidder %d has bid %d", (*cIter).first, (*cIter).second.nBid);
+			cEvent.events = EPOLLIN;
+			cEvent.data.fd = m_nClockTimer;
+			if (epoll_ctl(m_nEpoll, EPOLL_CTL_ADD, m_nClockTimer, &cEvent) == INVALID_SOCKET) {
+				perr_printf("Couldn't add clock to epoll");
+				nRes = ERR_EPOLL;
+				throw nRes;
+			}
 		}
 
-		for (std::map<pid_t, INFO>::const_iterator cIter = m_cBids.begin();
-			cIter != m_cBids.end();
-			++ cIter) {
-			/*
-			 * kill the bidders, which are less then bids
-			 */
-			if (nMaxBid > (*cIter).second.nBid)
-				SendKill((*cIter).second.nSocket, (*cIter).first);
+		/*
+		 * SIGINT and SIGTERM come as data on a signalfd
+		 * every shard has one, whichever reads it stops them all
+		 */
+		sigset_t cSignals;
+		ShutdownSignals(cSignals);
+		m_nSignals = signalfd(-1, &cSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+		if (m_nSignals == INVALID_SOCKET) {
+			perr_printf("signalfd failed");
+			nRes = ERR_SIGNAL;
+			throw nRes;
 		}
 
-		if (m_cBids.size() == 1) {
-			/*
-			 * If we have only one winner
-			 * Declare him as winner
-			 */
-			std::map<pid_t, INFO>::const_iterator cIter = m_cBids.begin();
-			if (nMaxBid == (*cIter).second.nBid)
-				log_message("Winner is %d", (*cIter).first);
+		cEvent.events = EPOLLIN;
+		cEvent.data.fd = m_nSignals;
+		if (epoll_ctl(m_nEpoll, EPOLL_CTL_ADD, m_nSignals, &cEvent) == INVALID_SOCKET) {
+			perr_printf("Couldn't add signals to epoll");
+			nRes = ERR_EPOLL;
+			throw nRes;
+		}
 
-			/*
-			 * Kill the winner
-			 * Others are already killed
-			 */
-			SendKill((*cIter).second.nSocket, (*cIter).first);
+		/* exits of forked processes are events too */
+		WatchChildren();
 
-			/*
-			 * Manager is done
-			 */
-			log_message("Exiting Manager...");
-			nRes = ERR_MANAGER_DONE;
+		/* join the parent manager */
+		if (!m_csUpstream.empty()) {
+			nRes = ConnectUpstream();
+			if (nRes != ERR_SUCCESS)
+				throw nRes;
 		}
-		else if (m_cBids.size() > 1) {
 
-			/*
-			 * We have more winners, restart bidding
-			 * Loosers are already killed
-			 */
-			log_message("More than one winners, restart bidding amongst winners");
-			nRes = ERR_RESTART_BIDS;
+		/*
+		 * Busy polling thread has its core to itself
+		 * pinned only now, so scoring and solver threads aren't
+		 * a placed reactor takes a CPU of its set, one per shard
+		 */
+		if (m_nSpinCPU >= 0) {
+			if (CPlacement::PinTo(m_nSpinCPU) != ERR_SUCCESS) {
+				err_printf("Couldn't pin shard %u to CPU %d", m_nShard, m_nSpinCPU);
+				m_nSpinCPU = -1;
+			}
+			else
+				log_message("Shard %u is busy polling on CPU %d", m_nShard, m_nSpinCPU);
 		}
-	}
-	catch (std::exception e) {
-		perr_printf(e.what());
-	}
-	catch (...) {
-		err_printf("Unknown exception...");
-	}
-	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
-	return nRes;
-}
+		else if (m_pManagerCPUs != NULL)
+			m_pManagerCPUs->Pin(m_nShard);
 
-/*
- * Delete the bidder
- */
-int CManager::DeleteBidder(const int nClient)
+		debug_log("Manager has started to link clients");
+		while (true) {
+
+			if (m_bStopping && !m_bDrained)
+				Drain();
+			CloseDue();
+			FlushPrices();
+			FlushKills();
+			FlushLosers();
+			RetryHandoffs();
+			ReapAuctions();
+			if (m_cAuctions.size() == 0 && m_cDeferred.empty()) {
+				/*
+				 * If no more auctions, no more data to recv
+				 * but give the queued kill messages a chance to reach bidders
+				 */
+				if (!HasPendingOutput())
+					break;
+				if (nDrainEnd == 0) {
+					nDrainEnd = time(NULL) + DRAIN_TIMEOUT;
+					nWait = 1000;
+				}
+				else if (time(NULL) >= nDrainEnd) {
+					err_printf("Couldn't flush all data before exit");
+					break;
+				}
+			}
+
+			/*
+			 * Wake up for earliest deadline
+			 * check back soon, if other shards have to take connections
+			 * don't wait at all, if due rounds are waiting
+			 */
+			int nWaitMs = m_cScheduler.Timeout(CScheduler::Now());
+			if (nWait >= 0 && (nWaitMs < 0 || nWait < nWaitMs))
+				nWaitMs = nWait;
+			if ((!m_cDeferred.empty() || !m_cDeferredBids.empty()) && (nWaitMs < 0 || nWaitMs > 1))
+				nWaitMs = 1;
+			if (!m_cPriceFlushes.empty()) {
+				AUCTION* pAuction = FindAuction(m_cPriceFlushes.front());
+				uint64_t nNow = CScheduler::Now();
+				int nFlush = 0;
+				if (pAuction != NULL && pAuction->nPriceFlush > nNow)
+					nFlush = (pAuction->nPriceFlush - nNow + 999999) / 1000000;
+				if (nWaitMs < 0 || nFlush < nWaitMs)
+					nWaitMs = nFlush;
+			}
+			if (m_bBackpressure)
+				nWaitMs = 0;
+
+			Uncork();
+			nRes = WaitEvents(cEvents, nWaitMs);
+			if (nRes == 0) {
+				nRes = ERR_TIMEOUT;
+				continue;
+			}
+			if (nRes == -1) {
+				if (errno == EINTR)
+					continue;
+
+				perr_printf("epoll_wait failed");
+				throw nRes;
+			}
+
+			int nEvents = nRes;
+			for (int nEvent = 0; nEvent < nEvents; ++ nEvent) {
+				int nClient = cEvents[nEvent].data.fd;
+				if (nClient == m_cServer.GetSockHandle()) {
+					/* Accept new connections */
+					AcceptConnection();
+					continue;
+				}
+
+				if (nClient == m_nScoreEvent) {
+					/* Scores are ready */
+					ScoresReady();
+					continue;
+				}
+
+				if (nClient == m_nHandoffEvent) {
+					/* Other shards have connections or batch entries for us */
+					AdoptPending();
+					TakeRouted();
+					continue;
+				}
+
+				if (nClient == m_nClockTimer) {
+					/* Dutch clock has ticked */
+					ClockTick();
+					continue;
+				}
+
+				if (nClient == m_nSignals) {
+					/* Ctrl+C or SIGTERM */
+					ReadSignals();
+					continue;
+				}
+
+				CONN_MAP::iterator cConn = m_cConns.find(nClient);
+				if (cConn == m_cConns.end()) {
+					/* a forked process has exited, or connection was closed earlier in this batch */
+					if (m_cChildren.find(nClient) != m_cChildren.end())
+						ReapChild(nClient);
+					continue;
+				}
+
+				if (cEvents[nEvent].events & EPOLLOUT) {
+					/*
+					 * Bidder can take more data
+					 * Flush what is queued for him
+					 */
+					FlushData(nClient);
+				}
+
+				if (!(cEvents[nEvent].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+					continue;
+
+				/* data from client */
+				ReadConnection(nClient);
+			}
+
+			/* whole batch is read, earliest acceptance wins */
+			SettleAccepts();
+		}
+		Uncork();
+
+		const JITTER& cJitter = m_cScheduler.GetJitter();
+		if (cJitter.nCloses != 0)
+			log_message("Closed %llu rounds at deadline, late by min %.3f ms, mean %.3f ms, max %.3f ms",
+				(unsigned long long) cJitter.nCloses,
+				cJitter.nMin / 1e6,
+				cJitter.nTotal / 1e6 / cJitter.nCloses,
+				cJitter.nMax / 1e6);
+		if (m_nSpinCPU >= 0)
+			log_message("Busy polled: %llu waits ended spinning, %llu slept, %llu of them woken by events, spinning %llu us now",
+				(unsigned long long) m_cSpin.nSpun,
+				(unsigned long long) m_cSpin.nSlept,
+				(unsigned long long) m_cSpin.nWoken,
+				(unsigned long long) m_nSpinTime / 1000);
+		if (m_cQueueing.nReads != 0)
+			log_message("%llu reads were stamped, queued in kernel min %.3f ms, mean %.3f ms, max %.3f ms",
+				(unsigned long long) m_cQueueing.nReads,
+				m_cQueueing.nMin / 1e6,
+				m_cQueueing.nTotal / 1e6 / m_cQueueing.nReads,
+				m_cQueueing.nMax / 1e6);
+		if (m_nStaleBids != 0)
+			log_message("Dropped %llu bids of closed rounds", (unsigned long long) m_nStaleBids);
+	}
+	catch (std::exception e) {
+		perr_printf(e.what());
+	}
+	catch (...) {
+		err_printf("Unknown exception...");
+	}
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	return nRes;
+}
+
+/*
+ * Read from bidder's connection
+ */
+int CManager::ReadConnection(int nSock)
+{
+	int nRes = 0;
+	debug_log("Entering %s ...", __FUNCTION__);
+
+	CONN_MAP::iterator cIter = m_cConns.find(nSock);
+	if (cIter == m_cConns.end())
+		return ERR_SOCKET_RECV;
+
+	CONN& cConn = (*cIter).second;
+	uint64_t nStamp = 0;
+	ssize_t nBytesRecv = 0;
+	if (m_bTimestamps)
+		nBytesRecv = CSocket::ReceiveStamped(nSock,
+				cConn.cInput + cConn.nInput,
+				sizeof(cConn.cInput) - cConn.nInput,
+				nStamp);
+	else
+		nBytesRecv = recv(nSock,
+				cConn.cInput + cConn.nInput,
+				sizeof(cConn.cInput) - cConn.nInput,
+				0);
+	if (nBytesRecv <= 0) {
+		if (nBytesRecv == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+			return ERR_SUCCESS;	/* nothing to read yet */
+
+		if (nBytesRecv == 0) {
+
+			/*
+			 * This bidder has left
+			 */
+			struct sockaddr_in cClientAddr;
+			socklen_t addr_length = sizeof(cClientAddr);
+			getsockname(nSock, (struct sockaddr*) &cClientAddr, &addr_length);
+			debug_log("Client %d from %s left", nSock, inet_ntoa(cClientAddr.sin_addr));
+		}
+		else {
+			perr_printf("Couldn't receive data from socket %d (0x%x)",
+				nSock,
+				nSock);
+		}
+
+		/*
+		 * remove this item from our list of bidders
+		 */
+		CloseConnection(nSock);
+		return ERR_SOCKET_RECV;
+	}
+
+	cConn.nInput += nBytesRecv;
+	if (m_nProfile & SOCK_OPT_QUICKACK)
+		CSocket::QuickAck(nSock);
+	m_nArrival = CScheduler::Now();
+	m_nKernelArrival = m_nArrival;		/* Dutch acceptances are ordered by it */
+	if (nStamp != 0) {
+		/*
+		 * Kernel stamps are CLOCK_REALTIME, turn it into time it was queued
+		 * bids of a read share the stamp of its latest segment
+		 */
+		struct timespec cReal;
+		clock_gettime(CLOCK_REALTIME, &cReal);
+		uint64_t nReal = cReal.tv_sec * 1000000000ULL + cReal.tv_nsec;
+		uint64_t nQueued = std::min(nReal > nStamp ? nReal - nStamp : 0, m_nArrival);
+		m_nKernelArrival = m_nArrival - nQueued;
+
+		if (m_cQueueing.nReads == 0 || nQueued < m_cQueueing.nMin)
+			m_cQueueing.nMin = nQueued;
+		m_cQueueing.nMax = std::max(m_cQueueing.nMax, nQueued);
+		m_cQueueing.nTotal += nQueued;
+		++ m_cQueueing.nReads;
+	}
+	nRes = ProcessInput(nSock);
+
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	return nRes;
+}
+
+/*
+ * Handle every complete message in the buffer, keep the partial one
+ */
+int CManager::ProcessInput(int nSock)
+{
+	int nRes = 0;
+
+	CONN_MAP::iterator cIter = m_cConns.find(nSock);
+	if (cIter == m_cConns.end())
+		return ERR_SOCKET_RECV;
+
+	CONN& cConn = (*cIter).second;
+	size_t nOffset = 0;
+	size_t nUsed = 0;
+	std::string_view csMessage;
+	while ((nUsed = CProtocol::NextMessage(cConn.cInput + nOffset, cConn.nInput - nOffset, csMessage)) != 0) {
+		/*
+		 * Hello for an auction of another shard
+		 * connection goes there, with all it has sent
+		 */
+		if (cConn.nPID == 0 && HandOff(cConn, csMessage, nOffset))
+			return ERR_SUCCESS;
+
+		nOffset += nUsed;
+		int nHandled = HandleMessage(cConn, csMessage);
+		if (nHandled == ERR_MANAGER_DONE)
+			nRes = nHandled;
+	}
+
+	if (nOffset != 0) {
+		/* keep the partial message for next read */
+		cConn.nInput -= nOffset;
+		memmove(cConn.cInput, cConn.cInput + nOffset, cConn.nInput);
+	}
+	else if (cConn.nInput == sizeof(cConn.cInput)) {
+		/*
+		 * Buffer is full without a message, bidder isn't speaking our protocol
+		 */
+		err_printf("Message from client %d is too long", nSock);
+		CloseConnection(nSock);
+		nRes = ERR_PROTOCOL;
+	}
+
+	return nRes;
+}
+
+/*
+ * Handle one message from bidder
+ * First message on a connection is hello, rest are bids or batches
+ */
+int CManager::HandleMessage(CONN& cConn, std::string_view csMessage)
+{
+	debug_log("Client %d sent \"%.*s\"", cConn.nSocket, (int) csMessage.size(), csMessage.data());
+
+	if (cConn.bUpstream)
+		return HandleUpstream(cConn, csMessage);
+
+	if (cConn.nPID == 0 && CProtocol::IsLeaf(csMessage)) {
+		LEAF_HELLO cHello;
+		if (CProtocol::ParseLeaf(csMessage, cHello) != ERR_SUCCESS) {
+			err_printf("Invalid hello \"%.*s\" from manager %d",
+				(int) csMessage.size(), csMessage.data(), cConn.nSocket);
+			return ERR_PROTOCOL;
+		}
+
+		return HandleLeaf(cConn, cHello);
+	}
+
+	if (cConn.bLeaf) {
+		READY cReady;
+		TOP cTop;
+		if (CProtocol::ParseReady(csMessage, cReady) == ERR_SUCCESS)
+			return HandleReady(cConn, cReady);
+		if (CProtocol::ParseTop(csMessage, cTop) == ERR_SUCCESS)
+			return HandleTop(cConn, cTop);
+
+		err_printf("Invalid message \"%.*s\" from manager %d",
+			(int) csMessage.size(), csMessage.data(), cConn.nSocket);
+		return ERR_PROTOCOL;
+	}
+
+	if (cConn.nPID == 0 && CProtocol::IsGateway(csMessage)) {
+		GATEWAY_HELLO cHello;
+		if (CProtocol::ParseGateway(csMessage, cHello) != ERR_SUCCESS) {
+			err_printf("Invalid hello \"%.*s\" from gateway %d",
+				(int) csMessage.size(), csMessage.data(), cConn.nSocket);
+			return ERR_PROTOCOL;
+		}
+
+		return HandleGateway(cConn, cHello);
+	}
+
+	/*
+	 * Bid of a round, which is over, is dropped here
+	 * bidder may not have heard of the close, it isn't an error
+	 */
+	ROUND_TAG cTag;
+	size_t nTag = CProtocol::ParseTag(csMessage, cTag);
+	if (nTag != 0) {
+		if (IsStale(cConn, cTag))
+			return ERR_SUCCESS;
+		csMessage.remove_prefix(nTag);
+	}
+
+	if (cConn.bGateway) {
+		ID_LIST cJoin;
+		GATEWAY_BIDS cBids;
+		if (CProtocol::ParseGatewayBids(csMessage, cBids) == ERR_SUCCESS)
+			return HandleGatewayBids(cConn, cBids);
+		if (CProtocol::ParseJoin(csMessage, cJoin) == ERR_SUCCESS)
+			return HandleJoin(cConn, cJoin);
+
+		err_printf("Invalid message \"%.*s\" from gateway %d",
+			(int) csMessage.size(), csMessage.data(), cConn.nSocket);
+		return ERR_PROTOCOL;
+	}
+
+	if (cConn.nPID == 0) {
+		HELLO cHello;
+		if (CProtocol::ParseHello(csMessage, cHello) != ERR_SUCCESS) {
+			err_printf("Invalid hello \"%.*s\" from client %d",
+				(int) csMessage.size(), csMessage.data(), cConn.nSocket);
+			return ERR_PROTOCOL;
+		}
+
+		return HandleHello(cConn, cHello);
+	}
+
+	if (CProtocol::IsAttributes(csMessage)) {
+		ATTR_BID cBid;
+		if (CProtocol::ParseAttributes(csMessage, cBid) != ERR_SUCCESS) {
+			err_printf("Invalid bid \"%.*s\" from client %d",
+				(int) csMessage.size(), csMessage.data(), cConn.nSocket);
+			return ERR_PROTOCOL;
+		}
+
+		return HandleAttributes(cConn, cBid);
+	}
+
+	if (CProtocol::IsProxy(csMessage)) {
+		PROXY cProxy;
+		if (CProtocol::ParseProxy(csMessage, cProxy) != ERR_SUCCESS) {
+			err_printf("Invalid proxy \"%.*s\" from client %d",
+				(int) csMessage.size(), csMessage.data(), cConn.nSocket);
+			return ERR_PROTOCOL;
+		}
+
+		return HandleProxy(cConn, cProxy);
+	}
+
+	if (CProtocol::IsBundle(csMessage)) {
+		BUNDLE cBundle;
+		if (CProtocol::ParseBundle(csMessage, cBundle) != ERR_SUCCESS) {
+			err_printf("Invalid bundle \"%.*s\" from client %d",
+				(int) csMessage.size(), csMessage.data(), cConn.nSocket);
+			return ERR_PROTOCOL;
+		}
+
+		return HandleBundle(cConn, cBundle);
+	}
+
+	if (CProtocol::IsBatch(csMessage)) {
+		BATCH cBatch;
+		if (CProtocol::ParseBatch(csMessage, cBatch) != ERR_SUCCESS) {
+			err_printf("Invalid batch \"%.*s\" from client %d",
+				(int) csMessage.size(), csMessage.data(), cConn.nSocket);
+			return ERR_PROTOCOL;
+		}
+
+		return HandleBatch(cConn, cBatch);
+	}
+
+	BID cBid;
+	if (CProtocol::ParseBid(csMessage, cBid) != ERR_SUCCESS) {
+		err_printf("Invalid bid \"%.*s\" from client %d",
+			(int) csMessage.size(), csMessage.data(), cConn.nSocket);
+		return ERR_PROTOCOL;
+	}
+
+	return HandleBid(cConn, cBid);
+}
+
+/*
+ * new connection sends it's port, pid_t and auction
+ * we already have the socket in connection
+ * insert all this information in auction's bidders
+ */
+int CManager::HandleHello(CONN& cConn, const HELLO& cHello)
+{
+	int nRes = 0;
+	debug_log("after parsing message %d: %d: %u", cHello.nPort, cHello.nPID, cHello.nAuction);
+
+	AUCTION* pAuction = FindAuction(cHello.nAuction);
+	if (pAuction == NULL) {
+		err_printf("Can't find auction %u for ID %d", cHello.nAuction, cHello.nPID);
+		return ERR_PROTOCOL;
+	}
+
+	BID_MAP::iterator cIter = pAuction->cBids.find(cHello.nPID);	/* Find the PID in our map */
+	if (cIter != pAuction->cBids.end()) {
+
+		(*cIter).second.nSocket = cConn.nSocket;
+		cConn.nPID = cHello.nPID;
+		cConn.nAuction = cHello.nAuction;
+		debug_log("Client has sent: PID:%d SOCKET:%d",
+			(*cIter).first,
+			cConn.nSocket);
+		MarkReplied(*pAuction, (*cIter).second);	/* we have a connection, a second hello isn't counted */
+		Publish(*pAuction);
+		nRes = CheckRound(*pAuction);
+	}
+	else {
+
+		/*
+		 * Manager don't have this bidder in map
+		 * Report it
+		 */
+		err_printf("Can't find ID %d in map", cHello.nPID);
+	}
+
+	return nRes;
+}
+
+/*
+ * Bid is sent in message
+ */
+int CManager::HandleBid(CONN& cConn, const BID& cBid)
+{
+	AUCTION* pAuction = FindAuction(cConn.nAuction);
+	if (pAuction == NULL)
+		return ERR_PROTOCOL;	/* auction is over */
+
+	int nRes = ApplyBid(*pAuction, cBid.nPID, cBid.nBid);
+	if (nRes != ERR_SUCCESS)
+		return nRes;
+
+	return CheckRound(*pAuction);
+}
+
+/*
+ * Batch of bids is sent in message
+ * All bids are applied in one pass, each auction is checked once
+ * entries for auctions of other shards are routed to them
+ */
+int CManager::HandleBatch(CONN& cConn, const BATCH& cBatch)
+{
+	int nRes = 0;
+	AUCTION* pApplied[MAX_BATCH_BIDS];
+	unsigned int nApplied = 0;
+
+	if (cBatch.nPID != cConn.nPID) {
+		err_printf("Client %d of bidder %d sent batch of bidder %d", cConn.nSocket, cConn.nPID, cBatch.nPID);
+		return ERR_PROTOCOL;
+	}
+
+	for (unsigned int nBid = 0; nBid < cBatch.nBids; ++ nBid) {
+		const AUCTION_BID& cBid = cBatch.cBids[nBid];
+		AUCTION* pAuction = FindAuction(cBid.nAuction);
+		if (pAuction == NULL) {
+			CManager* pShard = ShardOf(cBid.nAuction);
+			if (pShard == this) {
+				++ m_nStaleBids;	/* auction is over */
+				continue;
+			}
+
+			/*
+			 * Other shard runs it, it applies the entry from its loop
+			 * if it's full, try again from ours
+			 */
+			ROUTED_BID cRouted = { cBid.nAuction, cBatch.nPID, cBid.nBid, false, m_nArrival, m_nKernelArrival };
+			if (pShard->Route(cRouted) == ERR_KEEP_WAITING)
+				m_cDeferredBids.push_back(std::make_pair(pShard, cRouted));
+			continue;
+		}
+
+		if (ApplyBatched(*pAuction, cBatch.nPID, cBid.nBid) != ERR_SUCCESS)
+			continue;
+
+		/* auction is checked once for the whole batch */
+		unsigned int nAuction = 0;
+		while (nAuction < nApplied && pApplied[nAuction] != pAuction)
+			++ nAuction;
+		if (nAuction == nApplied)
+			pApplied[nApplied ++] = pAuction;
+	}
+
+	for (unsigned int nAuction = 0; nAuction < nApplied; ++ nAuction) {
+		int nChecked = CheckRound(*pApplied[nAuction]);
+		if (nChecked == ERR_MANAGER_DONE)
+			nRes = nChecked;
+	}
+
+	return nRes;
+}
+
+/*
+ * Apply a batch entry
+ * bidder may have lost this auction, or it hasn't started yet; he still bids in his own
+ */
+int CManager::ApplyBatched(AUCTION& cAuction, pid_t nPID, unsigned int nBid)
+{
+	if (!cAuction.bStarted || cAuction.cBids.find(nPID) == cAuction.cBids.end()) {
+		++ m_nStaleBids;
+		return ERR_KEEP_WAITING;
+	}
+
+	return ApplyBid(cAuction, nPID, nBid);
+}
+
+/*
+ * Queue a batch entry for this shard
+ * Called from another shard's thread
+ * Returns ERR_KEEP_WAITING, if queue is full
+ */
+int CManager::Route(const ROUTED_BID& cBid)
+{
+	if (!m_cRouted.TryPush(cBid))
+		return ERR_KEEP_WAITING;
+
+	uint64_t nOne = 1;
+	if (write(m_nHandoffEvent, &nOne, sizeof(nOne)) == -1) {
+		perr_printf("Couldn't signal routed bid");
+		return ERR_EPOLL;
+	}
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Apply batch entries, other shards have routed to us
+ * they carry their read times, so history and settling see when they came in
+ */
+int CManager::TakeRouted()
+{
+	int nRes = 0;
+	ROUTED_BID cBids[MAX_DEQUEUE_BATCH];
+	size_t nBids = 0;
+
+	while ((nBids = m_cRouted.PopBatch(cBids, MAX_DEQUEUE_BATCH)) != 0) {
+		for (size_t nBid = 0; nBid < nBids; ++ nBid) {
+			const ROUTED_BID& cBid = cBids[nBid];
+			AUCTION* pAuction = FindAuction(cBid.nAuction);
+			if (pAuction == NULL) {
+				++ m_nStaleBids;	/* auction is over */
+				continue;
+			}
+
+			if (cBid.bLeave) {
+				/* he doesn't count for quorum, no round is waiting for him */
+				BID_MAP::iterator cIter = pAuction->cBids.find(cBid.nPID);
+				if (cIter != pAuction->cBids.end() && (*cIter).second.bBatched) {
+					RemoveBidder(*pAuction, cIter);
+					Publish(*pAuction);
+				}
+				continue;
+			}
+
+			m_nArrival = cBid.nArrival;
+			m_nKernelArrival = cBid.nKernel;
+			if (ApplyBatched(*pAuction, cBid.nPID, cBid.nBid) != ERR_SUCCESS)
+				continue;
+
+			int nChecked = CheckRound(*pAuction);
+			if (nChecked == ERR_MANAGER_DONE)
+				nRes = nChecked;
+		}
+	}
+
+	return nRes;
+}
+
+/*
+ * Bidder is gone, or told to go
+ * auctions he joined besides his own stop waiting for his entries
+ */
+int CManager::LeaveJoined(pid_t nPID)
+{
+	std::map<pid_t, std::vector<unsigned int> >::iterator cJoined = m_cJoined.find(nPID);
+	if (cJoined == m_cJoined.end())
+		return ERR_SUCCESS;
+
+	const std::vector<unsigned int>& cAuctions = (*cJoined).second;
+	for (size_t nJoined = 0; nJoined < cAuctions.size(); ++ nJoined) {
+		ROUTED_BID cLeave = { cAuctions[nJoined], nPID, 0, true, m_nArrival, m_nKernelArrival };
+		CManager* pShard = ShardOf(cLeave.nAuction);
+		if (pShard != this) {
+			if (pShard->Route(cLeave) == ERR_KEEP_WAITING)
+				m_cDeferredBids.push_back(std::make_pair(pShard, cLeave));
+			continue;
+		}
+
+		AUCTION* pAuction = FindAuction(cLeave.nAuction);
+		if (pAuction == NULL)
+			continue;
+		BID_MAP::iterator cIter = pAuction->cBids.find(nPID);
+		if (cIter != pAuction->cBids.end() && (*cIter).second.bBatched) {
+			RemoveBidder(*pAuction, cIter);
+			Publish(*pAuction);
+		}
+	}
+
+	m_cJoined.erase(cJoined);
+	return ERR_SUCCESS;
+}
+
+/*
+ * Multi attribute bid is sent in message
+ * price is his bid, engine scores the whole vector
+ */
+int CManager::HandleAttributes(CONN& cConn, const ATTR_BID& cBid)
+{
+	AUCTION* pAuction = FindAuction(cConn.nAuction);
+	if (pAuction == NULL)
+		return ERR_PROTOCOL;	/* auction is over */
+
+	int nRes = ApplyBid(*pAuction, cBid.nPID, cBid.cVector.nPrice, &cBid.cVector);
+	if (nRes != ERR_SUCCESS)
+		return nRes;
+
+	return CheckRound(*pAuction);
+}
+
+/*
+ * Bidder leaves his bidding to a proxy
+ * first bid of proxy is his bid in this round
+ */
+int CManager::HandleProxy(CONN& cConn, const PROXY& cProxy)
+{
+	AUCTION* pAuction = FindAuction(cConn.nAuction);
+	if (pAuction == NULL)
+		return ERR_PROTOCOL;	/* auction is over */
+
+	BID_MAP::iterator cIter = pAuction->cBids.find(cProxy.nPID);
+	if (cIter == pAuction->cBids.end()) {
+		err_printf("Can't find ID %d in map", cProxy.nPID);
+		return ERR_PROTOCOL;
+	}
+
+	INFO& cInfo = (*cIter).second;
+	if (!cInfo.bProxy)
+		++ pAuction->nProxies;
+	cInfo.bProxy = true;
+	cInfo.nProxyMax = cProxy.nMax;
+	cInfo.nProxyStep = cProxy.nStep;
+	debug_log("Bidder %d has a proxy, bid %u, max %u, step %u", cProxy.nPID, cProxy.nBid, cProxy.nMax, cProxy.nStep);
+
+	int nRes = ApplyBid(*pAuction, cProxy.nPID, cProxy.nBid);
+	if (nRes != ERR_SUCCESS)
+		return nRes;
+
+	return CheckRound(*pAuction);
+}
+
+/*
+ * Bundle bid of a combinatorial auction
+ * it's a sealed bid, his items are kept with it
+ */
+int CManager::HandleBundle(CONN& cConn, const BUNDLE& cBundle)
+{
+	AUCTION* pAuction = FindAuction(cConn.nAuction);
+	if (pAuction == NULL)
+		return ERR_PROTOCOL;	/* auction is over */
+
+	if (m_nMode != MODE_COMBINATORIAL) {
+		err_printf("Bidder %d sent a bundle, auction %u isn't combinatorial", cBundle.nPID, pAuction->nAuction);
+		return ERR_PROTOCOL;
+	}
+
+	ITEM_MASK cItems;
+	for (unsigned int nItem = 0; nItem < cBundle.nItems; ++ nItem) {
+		if (cBundle.cItems[nItem] >= m_nItems) {
+			err_printf("Bidder %d bid on item %u, auction has %u", cBundle.nPID, cBundle.cItems[nItem], m_nItems);
+			return ERR_PROTOCOL;
+		}
+		cItems.set(cBundle.cItems[nItem]);
+	}
+
+	int nRes = ApplyBid(*pAuction, cBundle.nPID, cBundle.nPrice);
+	if (nRes != ERR_SUCCESS)
+		return nRes;
+
+	(*pAuction->cBids.find(cBundle.nPID)).second.cItems = cItems;
+	return CheckRound(*pAuction);
+}
+
+/*
+ * Gateway sends its id and auction, its bidders join next
+ */
+int CManager::HandleGateway(CONN& cConn, const GATEWAY_HELLO& cHello)
+{
+	AUCTION* pAuction = FindAuction(cHello.nAuction);
+	if (pAuction == NULL) {
+		err_printf("Can't find auction %u for gateway %d", cHello.nAuction, cHello.nPID);
+		return ERR_PROTOCOL;
+	}
+
+	cConn.nPID = cHello.nPID;
+	cConn.nAuction = cHello.nAuction;
+	cConn.bGateway = true;
+	pAuction->cGateways.push_back(cConn.nSocket);
+	debug_log("Gateway %d is on socket %d", cHello.nPID, cConn.nSocket);
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Virtual bidders say hello through their gateway
+ * auction is checked once for the whole frame
+ */
+int CManager::HandleJoin(CONN& cConn, const ID_LIST& cJoin)
+{
+	AUCTION* pAuction = FindAuction(cConn.nAuction);
+	if (pAuction == NULL)
+		return ERR_PROTOCOL;	/* auction is over */
+
+	for (unsigned int nID = 0; nID < cJoin.nIDs; ++ nID) {
+		BID_MAP::iterator cIter = pAuction->cBids.find(cJoin.cIDs[nID]);
+		if (cIter == pAuction->cBids.end()) {
+			err_printf("Can't find ID %d in map", cJoin.cIDs[nID]);
+			continue;
+		}
+
+		if ((*cIter).second.nSocket != 0 && (*cIter).second.nSocket != cConn.nSocket) {
+			err_printf("Bidder %d is already on socket %d", cJoin.cIDs[nID], (*cIter).second.nSocket);
+			continue;
+		}
+
+		(*cIter).second.nSocket = cConn.nSocket;
+		(*cIter).second.bVirtual = true;
+		MarkReplied(*pAuction, (*cIter).second);
+	}
+
+	return CheckRound(*pAuction);
+}
+
+/*
+ * Bids of virtual bidders
+ * a gateway only bids for bidders, which joined through it
+ */
+int CManager::HandleGatewayBids(CONN& cConn, const GATEWAY_BIDS& cBids)
+{
+	AUCTION* pAuction = FindAuction(cConn.nAuction);
+	if (pAuction == NULL)
+		return ERR_PROTOCOL;	/* auction is over */
+
+	for (unsigned int nBid = 0; nBid < cBids.nBids; ++ nBid) {
+		BID_MAP::const_iterator cIter = pAuction->cBids.find(cBids.cBids[nBid].nPID);
+		if (cIter == pAuction->cBids.end()) {
+			debug_log("Bidder %d is killed, his kill is on the way", cBids.cBids[nBid].nPID);
+			continue;
+		}
+
+		if ((*cIter).second.nSocket != cConn.nSocket) {
+			err_printf("Gateway %d sent bid for bidder %d of another connection", cBids.nPID, cBids.cBids[nBid].nPID);
+			continue;
+		}
+
+		ApplyBid(*pAuction, cBids.cBids[nBid].nPID, cBids.cBids[nBid].nBid);
+	}
+
+	return CheckRound(*pAuction);
+}
+
+/*
+ * Hand the connection to shard of its auction
+ * Returns false, if this shard runs the auction
+ */
+bool CManager::HandOff(CONN& cConn, std::string_view csHello, size_t nOffset)
+{
+	HELLO cHello;
+	GATEWAY_HELLO cGateway;
+	unsigned int nAuction = 0;
+	if (CProtocol::ParseHello(csHello, cHello) == ERR_SUCCESS)
+		nAuction = cHello.nAuction;
+	else if (CProtocol::ParseGateway(csHello, cGateway) == ERR_SUCCESS)
+		nAuction = cGateway.nAuction;
+	else
+		return false;	/* HandleMessage reports it */
+
+	CManager* pShard = ShardOf(nAuction);
+	if (pShard == this)
+		return false;
+
+	debug_log("Handing client %d to shard of auction %u", cConn.nSocket, nAuction);
+
+	HANDOFF cHandoff;
+	cHandoff.nSocket = cConn.nSocket;
+	cHandoff.nInput = cConn.nInput - nOffset;
+	memcpy(cHandoff.cInput, cConn.cInput + nOffset, cHandoff.nInput);
+
+	/*
+	 * Forget the connection, without closing it
+	 */
+	if (epoll_ctl(m_nEpoll, EPOLL_CTL_DEL, cConn.nSocket, NULL) == INVALID_SOCKET)
+		perr_printf("Couldn't remove socket %d from epoll", cConn.nSocket);
+	m_cConns.erase(cHandoff.nSocket);
+
+	/*
+	 * Other shard is full, it may be handing to us right now
+	 * so don't wait for it, try again from our loop
+	 */
+	if (pShard->Adopt(cHandoff) == ERR_KEEP_WAITING)
+		m_cDeferred.push_back(std::make_pair(pShard, cHandoff));
+
+	return true;
+}
+
+/*
+ * Queue a connection for this shard
+ * Called from another shard's thread
+ * Returns ERR_KEEP_WAITING, if queue is full
+ */
+int CManager::Adopt(const HANDOFF& cHandoff)
+{
+	if (!m_cHandoffs.TryPush(cHandoff))
+		return ERR_KEEP_WAITING;
+
+	uint64_t nOne = 1;
+	if (write(m_nHandoffEvent, &nOne, sizeof(nOne)) == -1) {
+		perr_printf("Couldn't signal handoff");
+		return ERR_EPOLL;
+	}
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Take connections, other shards have handed to us
+ */
+int CManager::AdoptPending()
+{
+	int nRes = 0;
+	uint64_t nCount = 0;
+	HANDOFF cHandoff;
+
+	if (read(m_nHandoffEvent, &nCount, sizeof(nCount)) == -1 && errno != EAGAIN)
+		perr_printf("Couldn't read handoff event");
+
+	/*
+	 * A handoff claimed but not yet published is taken
+	 * on the event its shard writes after publishing
+	 */
+	while (m_cHandoffs.Pop(cHandoff)) {
+		if (AddConnection(cHandoff.nSocket) != ERR_SUCCESS) {
+			close(cHandoff.nSocket);
+			nRes = ERR_EPOLL;
+			continue;
+		}
+
+		/*
+		 * Continue with what other shard has received
+		 */
+		CONN& cConn = m_cConns[cHandoff.nSocket];
+		memcpy(cConn.cInput, cHandoff.cInput, cHandoff.nInput);
+		cConn.nInput = cHandoff.nInput;
+		ProcessInput(cHandoff.nSocket);
+	}
+
+	return nRes;
+}
+
+/*
+ * Hand off connections, other shards couldn't take earlier
+ */
+int CManager::RetryHandoffs()
+{
+	std::list<std::pair<CManager*, HANDOFF> >::iterator cIter = m_cDeferred.begin();
+	while (cIter != m_cDeferred.end()) {
+		if ((*cIter).first->Adopt((*cIter).second) == ERR_KEEP_WAITING)
+			++ cIter;
+		else
+			m_cDeferred.erase(cIter ++);
+	}
+
+	std::list<std::pair<CManager*, ROUTED_BID> >::iterator cBid = m_cDeferredBids.begin();
+	while (cBid != m_cDeferredBids.end()) {
+		if ((*cBid).first->Route((*cBid).second) == ERR_KEEP_WAITING)
+			++ cBid;
+		else
+			m_cDeferredBids.erase(cBid ++);
+	}
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Find auction run by this manager
+ */
+AUCTION* CManager::FindAuction(unsigned int nAuction)
+{
+	std::map<unsigned int, AUCTION>::iterator cIter = m_cAuctions.find(nAuction);
+	if (cIter == m_cAuctions.end())
+		return NULL;
+
+	return &(*cIter).second;
+}
+
+/*
+ * Find shard of auction
+ */
+CManager* CManager::ShardOf(unsigned int nAuction)
+{
+	if (m_pShards == NULL)
+		return this;
+
+	return (*m_pShards)[nAuction % m_pShards->size()];
+}
+
+/*
+ * Update the bidder's bid
+ * A bid vector is scored on the scoring threads, while we keep accepting bids
+ */
+int CManager::ApplyBid(AUCTION& cAuction, pid_t nPID, unsigned int nBid, const BID_VECTOR* pVector/* = NULL*/)
+{
+	/*
+	 * Find the bidder in auction's map
+	 */
+	BID_MAP::iterator cIter = cAuction.cBids.find(nPID);
+	if (cIter == cAuction.cBids.end()) {
+
+		/*
+		 * Couldn't find the bidder in map
+		 * Report it
+		 */
+		err_printf("Can't find ID %d in map", nPID);
+		return ERR_PROTOCOL;
+	}
+
+	if (!cAuction.bStarted) {
+		err_printf("Bidder %d has bid before auction %u started", nPID, cAuction.nAuction);
+		return ERR_PROTOCOL;
+	}
+
+	cAuction.cStats.Add(nBid);		/* every bid of every mode, also the ones that don't count */
+	if (m_cHistory.IsEnabled())
+		m_cHistory.Add(cAuction.nAuction, cAuction.nRound, nPID, nBid, cAuction.nRoundStart, m_nArrival,
+			m_bTimestamps ? m_nKernelArrival : 0);
+	if (m_nMode == MODE_ENGLISH)
+		return RaiseBid(cAuction, cIter, nBid);	/* bids are open, no rounds */
+	if (m_nMode == MODE_DUTCH)
+		return AcceptPrice(cAuction, cIter, nBid);	/* bid takes the price on clock */
+
+	/*
+	 * Bidder found, update the map with his bid
+	 * a second bid in a round replaces the first, he is counted once
+	 */
+	INFO& cInfo = (*cIter).second;
+	cInfo.nBid = nBid;
+	cInfo.dScore = nBid;
+	++ cInfo.nSeq;
+	MarkReplied(cAuction, cInfo);
+	if (cAuction.nHighBidder == 0 || nBid > cAuction.nHighBid) {
+		cAuction.nHighBid = nBid;
+		cAuction.nHighBidder = nPID;
+	}
+	Publish(cAuction);
+	debug_log("PID:%d BID:%d",
+		(*cIter).first,
+		cInfo.nBid);
+
+	if (pVector == NULL || m_pScoring == NULL)
+		return ERR_SUCCESS;
+
+	cInfo.cVector = *pVector;
+	if (m_pPool == NULL) {
+		cInfo.dScore = m_pScoring->Score(cInfo.cVector);
+		return ERR_SUCCESS;
+	}
+
+	/*
+	 * Score it on a scoring thread
+	 * result comes back through m_cScores and m_nScoreEvent
+	 * I/O thread never waits for scoring threads, so they can wait for it
+	 */
+	SCORE_JOB cScoreJob = { cAuction.nAuction, nPID, cInfo.nSeq, cInfo.cVector };
+	POOL_JOB cJob;
+	cJob.pRun = ScoreJob;
+	cJob.pContext = this;
+	memcpy(cJob.cArgs, &cScoreJob, sizeof(cScoreJob));
+	if (!m_pPool->TrySubmit(cJob)) {
+		cInfo.dScore = m_pScoring->Score(cInfo.cVector);	/* threads are behind, don't wait for them */
+		return ERR_SUCCESS;
+	}
+
+	++ cAuction.nScoring;
+	return ERR_SUCCESS;
+}
+
+/*
+ * Start scoring threads
+ * they post scores on an eventfd, which is in epoll, if loop has one
+ */
+int CManager::StartScoring()
+{
+	m_nScoreEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (m_nScoreEvent == INVALID_SOCKET) {
+		perr_printf("eventfd failed");
+		return ERR_EPOLL;
+	}
+
+	if (m_nEpoll != INVALID_SOCKET) {
+		struct epoll_event cEvent;
+		memset(&cEvent, 0, sizeof(cEvent));
+		cEvent.events = EPOLLIN;
+		cEvent.data.fd = m_nScoreEvent;
+		if (epoll_ctl(m_nEpoll, EPOLL_CTL_ADD, m_nScoreEvent, &cEvent) == INVALID_SOCKET) {
+			perr_printf("Couldn't add scoring event to epoll");
+			return ERR_EPOLL;
+		}
+	}
+
+	m_pPool = new CThreadPool(m_nThreads);
+	return ERR_SUCCESS;
+}
+
+/*
+ * Scoring thread
+ * job is plain data, nothing is allocated for it
+ */
+void CManager::ScoreJob(void* pContext, const void* pArgs)
+{
+	CManager* pManager = static_cast<CManager*>(pContext);
+	SCORE_JOB cJob;
+	memcpy(&cJob, pArgs, sizeof(cJob));
+
+	SCORE cScore = { cJob.nAuction, cJob.nPID, cJob.nSeq, pManager->m_pScoring->Score(cJob.cVector) };
+	while (!pManager->m_cScores.TryPush(cScore)) {
+		if (pManager->m_bClosing)
+			return;		/* nobody collects scores anymore */
+		std::this_thread::yield();
+	}
+
+	uint64_t nOne = 1;
+	if (write(pManager->m_nScoreEvent, &nOne, sizeof(nOne)) == -1)
+		perr_printf("Couldn't signal score");
+}
+
+/*
+ * Collect finished scores
+ * If a round was only waiting for them, close it
+ */
+int CManager::ScoresReady()
+{
+	int nRes = 0;
+	uint64_t nCount = 0;
+	SCORE cScores[MAX_DEQUEUE_BATCH];
+	size_t nScores = 0;
+
+	if (read(m_nScoreEvent, &nCount, sizeof(nCount)) == -1 && errno != EAGAIN)
+		perr_printf("Couldn't read score event");
+
+	while ((nScores = m_cScores.PopBatch(cScores, MAX_DEQUEUE_BATCH)) != 0) {
+		for (size_t nScore = 0; nScore < nScores; ++ nScore) {
+			AUCTION* pAuction = FindAuction(cScores[nScore].nAuction);
+			if (pAuction == NULL)
+				continue;	/* auction is over */
+
+			-- pAuction->nScoring;
+
+			/*
+			 * Bidder may have left, or bid again
+			 */
+			BID_MAP::iterator cIter = pAuction->cBids.find(cScores[nScore].nPID);
+			if (cIter != pAuction->cBids.end() && (*cIter).second.nSeq == cScores[nScore].nSeq)
+				(*cIter).second.dScore = cScores[nScore].dScore;
+
+			if (pAuction->nScoring == 0 && pAuction->bRoundFull) {
+				pAuction->bRoundFull = false;
+				nRes = CloseRound(*pAuction);
+			}
+		}
+	}
+
+	return nRes;
+}
+
+/*
+ * Check if round is complete
+ */
+int CManager::CheckRound(AUCTION& cAuction)
+{
+	if (IsFederated())
+		return CheckFederation(cAuction);
+
+	if (cAuction.cBids.empty())
+		return ERR_SUCCESS;
+
+	if (!cAuction.bStarted) {
+		/*
+		 * Bidding starts, once every live bidder has said hello
+		 */
+		if (cAuction.nReplies < cAuction.cBids.size())
+			return ERR_SUCCESS;
+
+		cAuction.bStarted = true;
+		ResetRound(cAuction);
+		return StartBidding(cAuction);
+	}
+
+	if (m_nMode == MODE_ENGLISH || m_nMode == MODE_DUTCH)
+		return ERR_SUCCESS;		/* bidding goes on, until nobody raises or somebody accepts */
+
+	/* joined bidders only compete for the win, the round waits for our own */
+	if (cAuction.nLiveReplies < Quorum(cAuction))
+		return ERR_SUCCESS;
+
+	if (cAuction.nScoring != 0) {
+		/*
+		 * We got the last bid, but some are still being scored
+		 * round is closed once scores are in
+		 */
+		cAuction.bRoundFull = true;
+		return ERR_SUCCESS;
+	}
+
+	return CloseRound(cAuction);
+}
+
+/*
+ * Close the round
+ */
+int CManager::CloseRound(AUCTION& cAuction)
+{
+	int nRes = 0;
+
+	m_cScheduler.Cancel(&cAuction);		/* closed before its deadline */
+	cAuction.nClosedRound = cAuction.nRound;
+
+	if (IsFederated()) {
+		/* local round is closed, tree decides the winner */
+		if (m_nFedState == FED_BIDDING)
+			CloseLocalRound(cAuction);
+		return CheckFederation(cAuction);
+	}
+
+	if (m_nMode == MODE_ENGLISH || m_nMode == MODE_DUTCH)
+		return CloseEnglish(cAuction);	/* Dutch too, first acceptance is the high bid */
+	if (m_nMode == MODE_COMBINATORIAL)
+		return CloseCombinatorial(cAuction);
+
+	/*
+	 * Now compare the bids
+	 */
+	nRes = FindWinner(cAuction);
+	m_cRoundArena.Reset();	/* scratch data of this round is gone */
+	while (nRes == ERR_RESTART_BIDS) {
+
+		if (ProxiesExhausted(cAuction)) {
+			nRes = SettleProxies(cAuction);
+			break;
+		}
+
+		/*
+		 * More than one winners
+		 * Losers are removed
+		 * Restart bidding, proxies bid right away
+		 */
+		ResetRound(cAuction);
+		StartBidding(cAuction);
+
+		/*
+		 * If only proxies are left, nobody has to be asked
+		 * close the round here, and go on until there is a winner
+		 */
+		if (cAuction.nProxies < cAuction.cBids.size() || cAuction.nScoring != 0)
+			break;
+
+		m_cScheduler.Cancel(&cAuction);
+		cAuction.nClosedRound = cAuction.nRound;
+		nRes = FindWinner(cAuction);
+		m_cRoundArena.Reset();
+	}
+	/*
+	 * On ERR_MANAGER_DONE winner is declared, auction is removed
+	 * once its bidders are gone
+	 */
+
+	return nRes;
+}
+
+/*
+ * Join the parent manager of federation
+ * Parent connection is polled like a bidder's, but it gives orders
+ */
+int CManager::ConnectUpstream()
+{
+	int nRes = 0;
+	debug_log("Entering %s ...", __FUNCTION__);
+	char cBuffer[MAX_MESSAGE_SIZE] = { 0 };
+	CSocket cSocket;
+	try {
+		cSocket.SetProfile(m_nProfile);
+		if (!cSocket.Connect(m_csUpstream.c_str(), m_nUpstreamPort)) {
+			perr_printf("Couldn't connect to parent manager %s:%u", m_csUpstream.c_str(), m_nUpstreamPort);
+			nRes = ERR_SOCKET_CONNECT;
+			throw nRes;
+		}
+
+		if (!cSocket.SetNonBlocking()) {
+			nRes = ERR_SOCKET_SETOPT;
+			throw nRes;
+		}
+
+		/* Connection is ours now, socket object mustn't close it */
+		m_nUpstream = cSocket.Detach();
+		nRes = AddConnection(m_nUpstream);
+		if (nRes != ERR_SUCCESS) {
+			close(m_nUpstream);
+			m_nUpstream = INVALID_SOCKET;
+			throw nRes;
+		}
+		m_cConns[m_nUpstream].bUpstream = true;
+
+		sprintf(cBuffer, "leaf %d: %u\n", getpid(), DEFAULT_AUCTION);
+		nRes = QueueData(m_nUpstream, cBuffer, strlen(cBuffer));
+	}
+	catch (std::exception e) {
+		perr_printf(e.what());
+	}
+	catch (...) {
+		err_printf("Unknown exception...");
+	}
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	return nRes;
+}
+
+/*
+ * Child manager has joined
+ * It joins before the first round, later ones aren't waited for
+ */
+int CManager::HandleLeaf(CONN& cConn, const LEAF_HELLO& cHello)
+{
+	if (m_nLeaves == 0 || m_nFedState != FED_JOINING || FindAuction(cHello.nAuction) == NULL) {
+		err_printf("Manager %d can't join auction %u", cHello.nPID, cHello.nAuction);
+		return ERR_PROTOCOL;
+	}
+
+	cConn.nPID = cHello.nPID;
+	cConn.nAuction = cHello.nAuction;
+	cConn.bLeaf = true;
+
+	LEAF& cLeaf = m_cLeaves[cConn.nSocket];
+	cLeaf.nPID = cHello.nPID;
+	cLeaf.nBidders = 0;
+	cLeaf.bReady = false;
+	cLeaf.bReported = false;
+	cLeaf.nEntries = 0;
+	log_message("Manager %d has joined auction %u", cHello.nPID, cHello.nAuction);
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Bidders of child manager have said hello
+ */
+int CManager::HandleReady(CONN& cConn, const READY& cReady)
+{
+	std::map<int, LEAF>::iterator cIter = m_cLeaves.find(cConn.nSocket);
+	AUCTION* pAuction = FindAuction(cConn.nAuction);
+	if (cIter == m_cLeaves.end() || pAuction == NULL)
+		return ERR_PROTOCOL;
+
+	debug_log("Manager %d is ready with %u bidders", cReady.nPID, cReady.nBidders);
+	(*cIter).second.bReady = true;
+	(*cIter).second.nBidders = cReady.nBidders;
+	return CheckFederation(*pAuction);
+}
+
+/*
+ * Child manager has sent best bids of its subtree
+ */
+int CManager::HandleTop(CONN& cConn, const TOP& cTop)
+{
+	std::map<int, LEAF>::iterator cIter = m_cLeaves.find(cConn.nSocket);
+	AUCTION* pAuction = FindAuction(cConn.nAuction);
+	if (cIter == m_cLeaves.end() || pAuction == NULL)
+		return ERR_PROTOCOL;
+
+	LEAF& cLeaf = (*cIter).second;
+	if (m_nFedState != FED_BIDDING && m_nFedState != FED_MERGING) {
+		err_printf("Manager %d has reported out of round", cTop.nPID);
+		return ERR_PROTOCOL;
+	}
+
+	cLeaf.nEntries = 0;
+	for (unsigned int nEntry = 0; nEntry < cTop.nEntries; ++ nEntry)
+		AddTop(cLeaf.cEntries, cLeaf.nEntries, cTop.cEntries[nEntry]);
+	cLeaf.bReported = true;
+	return CheckFederation(*pAuction);
+}
+
+/*
+ * Orders from parent manager
+ */
+int CManager::HandleUpstream(CONN& cConn, std::string_view csMessage)
+{
+	if (cConn.nSocket != m_nUpstream) {
+		err_printf("Client %d isn't parent manager", cConn.nSocket);
+		return ERR_PROTOCOL;
+	}
+
+	AUCTION* pAuction = FindAuction(DEFAULT_AUCTION);
+	if (pAuction == NULL)
+		return ERR_SUCCESS;		/* our bidders are gone, nothing to do */
+
+	if (CProtocol::ParseOrder(csMessage) == ORDER_START) {
+		if (m_nFedState != FED_READY && m_nFedState != FED_REPORTED) {
+			err_printf("Parent manager has started a round out of turn");
+			return ERR_PROTOCOL;
+		}
+		return StartFederatedRound(*pAuction);
+	}
+
+	RESULT cResult;
+	if (CProtocol::ParseResult(csMessage, cResult) == ERR_SUCCESS) {
+		if (m_nFedState != FED_REPORTED) {
+			err_printf("Parent manager has sent result out of turn");
+			return ERR_PROTOCOL;
+		}
+
+		/* child managers apply it to their bidders */
+		std::string csResult(csMessage);
+		csResult += '\n';
+		for (std::map<int, LEAF>::const_iterator cIter = m_cLeaves.begin(); cIter != m_cLeaves.end(); ++ cIter)
+			QueueData((*cIter).first, csResult.data(), csResult.size());
+
+		return ApplyResult(*pAuction, cResult);
+	}
+
+	err_printf("Invalid order \"%.*s\" from parent manager", (int) csMessage.size(), csMessage.data());
+	return ERR_PROTOCOL;
+}
+
+/*
+ * Move federated auction along
+ * Round starts once the whole tree is ready, and closes once the whole tree has reported
+ */
+int CManager::CheckFederation(AUCTION& cAuction)
+{
+	char cBuffer[MAX_MESSAGE_SIZE] = { 0 };
+
+	switch (m_nFedState) {
+	case FED_JOINING: {
+		if (cAuction.nReplies < cAuction.cBids.size() || m_cLeaves.size() < m_nLeaves)
+			return ERR_SUCCESS;
+
+		unsigned int nBidders = cAuction.cBids.size();
+		for (std::map<int, LEAF>::const_iterator cIter = m_cLeaves.begin(); cIter != m_cLeaves.end(); ++ cIter) {
+			if (!(*cIter).second.bReady)
+				return ERR_SUCCESS;
+			nBidders += (*cIter).second.nBidders;
+		}
+
+		if (m_nUpstream == INVALID_SOCKET) {
+			log_message("Auction %u: %u bidders under %zu managers, start bidding",
+				cAuction.nAuction, nBidders, m_cLeaves.size() + 1);
+			return StartFederatedRound(cAuction);
+		}
+
+		/* parent starts the round */
+		sprintf(cBuffer, "ready %d: %u\n", getpid(), nBidders);
+		m_nFedState = FED_READY;
+		return QueueData(m_nUpstream, cBuffer, strlen(cBuffer));
+	}
+
+	case FED_BIDDING:
+		if (!cAuction.cBids.empty() && cAuction.nLiveReplies < Quorum(cAuction))
+			return ERR_SUCCESS;
+
+		if (cAuction.nScoring != 0) {
+			/* round is closed once scores are in */
+			cAuction.bRoundFull = true;
+			return ERR_SUCCESS;
+		}
+
+		return CloseRound(cAuction);
+
+	case FED_MERGING:
+		for (std::map<int, LEAF>::const_iterator cIter = m_cLeaves.begin(); cIter != m_cLeaves.end(); ++ cIter) {
+			if (!(*cIter).second.bReported)
+				return ERR_SUCCESS;
+		}
+
+		return MergeRound(cAuction);
+	}
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Start a round in the whole subtree
+ */
+int CManager::StartFederatedRound(AUCTION& cAuction)
+{
+	cAuction.bStarted = true;
+	ResetRound(cAuction);
+
+	for (std::map<int, LEAF>::iterator cIter = m_cLeaves.begin(); cIter != m_cLeaves.end(); ++ cIter) {
+		(*cIter).second.bReported = false;
+		QueueData((*cIter).first, "start\n", 6);
+	}
+
+	m_nFedState = FED_BIDDING;
+	StartBidding(cAuction);
+	return CheckFederation(cAuction);	/* we may have no bidders of our own */
+}
+
+/*
+ * Local round is closed, keep its best bids
+ */
+int CManager::CloseLocalRound(AUCTION& cAuction)
+{
+	m_nTop = 0;
+	for (BID_MAP::const_iterator cIter = cAuction.cBids.begin();
+		cIter != cAuction.cBids.end();
+		++ cIter) {
+		if (!HasReplied(cAuction, (*cIter).second))
+			continue;
+
+		debug_log("Auction %u: Bidder %d has bid %d, score %.2f", cAuction.nAuction,
+			(*cIter).first, (*cIter).second.nBid, (*cIter).second.dScore);
+
+		TOP_ENTRY cEntry;
+		cEntry.nPID = (*cIter).first;
+		cEntry.dScore = (*cIter).second.dScore;
+		AddTop(m_cTop, m_nTop, cEntry);
+	}
+
+	m_nFedState = FED_MERGING;
+	return ERR_SUCCESS;
+}
+
+/*
+ * Whole subtree has reported
+ * Send best bids to parent, or decide the round at root
+ */
+int CManager::MergeRound(AUCTION& cAuction)
+{
+	int nRes = 0;
+	debug_log("Entering %s ...", __FUNCTION__);
+	char cBuffer[MAX_FRAME_SIZE] = { 0 };
+	size_t nBufferLen = 0;
+	try {
+		for (std::map<int, LEAF>::const_iterator cIter = m_cLeaves.begin(); cIter != m_cLeaves.end(); ++ cIter) {
+			for (unsigned int nEntry = 0; nEntry < (*cIter).second.nEntries; ++ nEntry)
+				AddTop(m_cTop, m_nTop, (*cIter).second.cEntries[nEntry]);
+		}
+
+		if (m_nUpstream != INVALID_SOCKET) {
+			/* parent merges them with the rest of the tree */
+			nBufferLen = CProtocol::FormatTop(cBuffer, sizeof(cBuffer), getpid(), m_cTop, m_nTop);
+			m_nFedState = FED_REPORTED;
+			nRes = QueueData(m_nUpstream, cBuffer, nBufferLen);
+		}
+		else {
+			/*
+			 * We are root, best bids of the tree are here, highest first
+			 */
+			RESULT cResult;
+			cResult.dScore = m_nTop != 0 ? m_cTop[0].dScore : 0;
+			cResult.nWinners = 0;
+			while (cResult.nWinners < m_nTop && m_cTop[cResult.nWinners].dScore == cResult.dScore)
+				++ cResult.nWinners;
+
+			if (cResult.nWinners == 0)
+				log_message("Auction %u: Nobody has bid, auction is over", cAuction.nAuction);
+			else if (cResult.nWinners == 1)
+				log_message("Auction %u: Winner is %d", cAuction.nAuction, m_cTop[0].nPID);
+			else
+				log_message("Auction %u: More than one winners, restart bidding amongst winners", cAuction.nAuction);
+
+			nBufferLen = sprintf(cBuffer, "result %.17g %u\n", cResult.dScore, cResult.nWinners);
+			for (std::map<int, LEAF>::const_iterator cIter = m_cLeaves.begin(); cIter != m_cLeaves.end(); ++ cIter)
+				QueueData((*cIter).first, cBuffer, nBufferLen);
+
+			nRes = ApplyResult(cAuction, cResult);
+			if (nRes == ERR_RESTART_BIDS)
+				StartFederatedRound(cAuction);
+			else
+				log_message("Auction %u is over", cAuction.nAuction);
+		}
+	}
+	catch (std::exception e) {
+		perr_printf(e.what());
+	}
+	catch (...) {
+		err_printf("Unknown exception...");
+	}
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	return nRes;
+}
+
+/*
+ * Apply outcome of the round to our bidders
+ * Losers and silent bidders are killed, everybody is killed once there is a winner
+ */
+int CManager::ApplyResult(AUCTION& cAuction, const RESULT& cResult)
+{
+	bool bOver = cResult.nWinners <= 1;
+
+	/* losers are kept in round arena, it's reset when round closes */
+	std::pair<int, pid_t>* pLosers = m_cRoundArena.Allocate<std::pair<int, pid_t> >(cAuction.cBids.size());
+	size_t nLosers = 0;
+	for (BID_MAP::const_iterator cIter = cAuction.cBids.begin();
+		cIter != cAuction.cBids.end();
+		++ cIter) {
+		if (bOver || !HasReplied(cAuction, (*cIter).second) || cResult.dScore > (*cIter).second.dScore)
+			pLosers[nLosers ++] = std::make_pair((*cIter).second.nSocket, (*cIter).first);
+	}
+
+	for (size_t nLoser = 0; nLoser < nLosers; ++ nLoser)
+		SendKill(cAuction, pLosers[nLoser].first, pLosers[nLoser].second);
+
+	m_cRoundArena.Reset();	/* scratch data of this round is gone */
+
+	if (bOver) {
+		m_nFedState = FED_DONE;
+		return ERR_MANAGER_DONE;
+	}
+
+	return ERR_RESTART_BIDS;
+}
+
+/*
+ * Parent manager is gone, nobody can decide our rounds
+ */
+int CManager::LeaveFederation()
+{
+	err_printf("Lost parent manager, auction is over");
+	m_nFedState = FED_DONE;
+
+	AUCTION* pAuction = FindAuction(DEFAULT_AUCTION);
+	if (pAuction != NULL) {
+		while (!pAuction->cBids.empty()) {
+			BID_MAP::iterator cIter = pAuction->cBids.begin();
+			SendKill(*pAuction, (*cIter).second.nSocket, (*cIter).first);	/* iterator is invalid after this */
+		}
+	}
+
+	while (!m_cLeaves.empty())
+		CloseConnection((*m_cLeaves.begin()).first);
+
+	return ERR_MANAGER_DONE;
+}
+
+/*
+ * Keep entry, if it's amongst the best m_nTopK, highest first
+ */
+void CManager::AddTop(TOP_ENTRY* pEntries, unsigned int& nEntries, const TOP_ENTRY& cEntry) const
+{
+	unsigned int nIndex = nEntries;
+	if (nIndex == m_nTopK) {
+		if (pEntries[nIndex - 1].dScore >= cEntry.dScore)
+			return;
+		-- nIndex;	/* lowest one drops out */
+	}
+	else
+		++ nEntries;
+
+	while (nIndex > 0 && pEntries[nIndex - 1].dScore < cEntry.dScore) {
+		pEntries[nIndex] = pEntries[nIndex - 1];
+		-- nIndex;
+	}
+	pEntries[nIndex] = cEntry;
+}
+
+/*
+ * Close due rounds in deadline order
+ * A few per call, so bids keep flowing; if more are due, stop taking bidders
+ */
+int CManager::CloseDue()
+{
+	int nRes = 0;
+	uint64_t nNow = CScheduler::Now();
+	AUCTION* pAuction = NULL;
+
+	for (unsigned int nClosed = 0; nClosed < MAX_CLOSES_PER_LOOP; ++ nClosed) {
+		pAuction = m_cScheduler.PopDue(nNow);
+		if (pAuction == NULL)
+			break;
+
+		m_cScheduler.RecordClose(pAuction->nDeadline, CScheduler::Now());
+		if (m_nMode == MODE_SEALED || m_nMode == MODE_COMBINATORIAL)
+			log_message("Auction %u: Round closed at deadline, %u of %zu bidders have bid",
+				pAuction->nAuction, pAuction->nReplies, pAuction->cBids.size());
+
+		if (pAuction->nScoring != 0) {
+			/* closed once scores are in */
+			pAuction->bRoundFull = true;
+			continue;
+		}
+
+		int nClose = CloseRound(*pAuction);
+		if (nClose == ERR_MANAGER_DONE)
+			nRes = nClose;
+	}
+
+	SetBackpressure(m_cScheduler.CountDue(nNow) != 0);
+	return nRes;
+}
+
+/*
+ * Turn listener off, or on again
+ */
+int CManager::SetBackpressure(bool bBackpressure)
+{
+	if (bBackpressure == m_bBackpressure)
+		return ERR_SUCCESS;
+
+	struct epoll_event cEvent;
+	memset(&cEvent, 0, sizeof(cEvent));
+	cEvent.events = bBackpressure ? 0u : (uint32_t) EPOLLIN;
+	cEvent.data.fd = m_cServer.GetSockHandle();
+	if (epoll_ctl(m_nEpoll, EPOLL_CTL_MOD, m_cServer.GetSockHandle(), &cEvent) == INVALID_SOCKET) {
+		perr_printf("Couldn't change manager in epoll");
+		return ERR_EPOLL;
+	}
+
+	m_bBackpressure = bBackpressure;
+	if (bBackpressure)
+		log_message("Closing rounds is behind, not accepting bidders");
+	else
+		log_message("Closing rounds has caught up, accepting bidders");
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Register a bidder, he gets next slot of responder bitmap
+ */
+int CManager::AddBidder(AUCTION& cAuction, pid_t nPID, bool bBatched/* = false*/)
+{
+	INFO cInfo = {};
+	cInfo.nSlot = cAuction.nSlots ++;
+	cInfo.bBatched = bBatched;
+	BID_MAP::iterator cIter = cAuction.cBids.insert(std::make_pair(nPID, cInfo)).first;
+	cAuction.cReplied.resize((cAuction.nSlots + 63) / 64, 0);
+
+	/* he says hello to his own auction, this one doesn't wait for it */
+	if (bBatched) {
+		++ cAuction.nBatched;
+		MarkReplied(cAuction, (*cIter).second);
+	}
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Remove a bidder from live set
+ * His answer in this round doesn't count anymore
+ */
+void CManager::RemoveBidder(AUCTION& cAuction, BID_MAP::iterator cIter)
+{
+	const INFO& cInfo = (*cIter).second;
+	if (cInfo.bProxy)
+		-- cAuction.nProxies;
+	if (cInfo.bBatched)
+		-- cAuction.nBatched;
+	if (HasReplied(cAuction, cInfo)) {
+		cAuction.cReplied[cInfo.nSlot / 64] &= ~(1ULL << (cInfo.nSlot % 64));
+		-- cAuction.nReplies;
+		if (!cInfo.bBatched)
+			-- cAuction.nLiveReplies;
+	}
+
+	cAuction.cBids.erase(cIter);
+}
+
+/*
+ * Bidder has answered in this round
+ */
+void CManager::MarkReplied(AUCTION& cAuction, const INFO& cInfo)
+{
+	if (HasReplied(cAuction, cInfo))
+		return;		/* duplicate */
+
+	cAuction.cReplied[cInfo.nSlot / 64] |= 1ULL << (cInfo.nSlot % 64);
+	++ cAuction.nReplies;
+	if (!cInfo.bBatched)
+		++ cAuction.nLiveReplies;
+}
+
+/*
+ * Returns true if bidder has answered in this round
+ */
+bool CManager::HasReplied(const AUCTION& cAuction, const INFO& cInfo) const
+{
+	return (cAuction.cReplied[cInfo.nSlot / 64] & (1ULL << (cInfo.nSlot % 64))) != 0;
+}
+
+/*
+ * Start a new round, nobody has answered
+ */
+void CManager::ResetRound(AUCTION& cAuction)
+{
+	std::fill(cAuction.cReplied.begin(), cAuction.cReplied.end(), 0);
+	cAuction.nReplies = 0;
+	cAuction.nLiveReplies = 0;
+	cAuction.nHighBid = 0;
+	cAuction.nHighBidder = 0;
+	++ cAuction.nRound;
+}
+
+/*
+ * Answers needed to close the round
+ */
+unsigned int CManager::Quorum(const AUCTION& cAuction) const
+{
+	unsigned int nLive = cAuction.cBids.size() - cAuction.nBatched;
+	unsigned int nQuorum = nLive;
+
+	switch (m_cQuorum.nRule) {
+	case QUORUM_MAJORITY:
+		nQuorum = nLive / 2 + 1;
+		break;
+	case QUORUM_PERCENT:
+		nQuorum = (nLive * m_cQuorum.nValue + 99) / 100;
+		break;
+	case QUORUM_COUNT:
+		nQuorum = m_cQuorum.nValue;
+		break;
+	default:
+		break;
+	}
+
+	if (nQuorum > nLive)
+		nQuorum = nLive;
+	if (nQuorum == 0)
+		nQuorum = 1;
+
+	return nQuorum;
+}
+
+/*
+ * Accept all pending connections on manager socket
+ */
+int CManager::AcceptConnection()
+{
+	int nRes = 0;
+	debug_log("Entering %s ...", __FUNCTION__);
+	while (true) {
+		struct sockaddr_in cClientAddr;
+		socklen_t nAddrLength = sizeof(cClientAddr);
+		int nNewSocket = accept(m_cServer.GetSockHandle(),
+					(struct sockaddr*) &cClientAddr,
+					&nAddrLength);
+		if (nNewSocket == INVALID_SOCKET) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				perr_printf("Couldn't accept client connection");
+				nRes = ERR_SOCKET_ACCEPT;
+			}
+			break;	/* no more pending connections */
+		}
+
+		debug_log("New connection %s on socket %d (0x%x)",
+			inet_ntoa(cClientAddr.sin_addr),
+			nNewSocket,
+			nNewSocket);
+
+		/* most options are inherited from listener, not all of them on every kernel */
+		CSocket::SetOptions(nNewSocket, m_nProfile);
+
+		/*
+		 * Bidder sockets are non blocking
+		 * a slow bidder must not block the manager
+		 */
+		if (!CSocket::SetNonBlocking(nNewSocket) || AddConnection(nNewSocket) != ERR_SUCCESS) {
+			close(nNewSocket);
+			nRes = ERR_SOCKET_ACCEPT;
+		}
+	}
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	return nRes;
+}
+
+/*
+ * Add the connection to epoll and connection map
+ */
+int CManager::AddConnection(int nSock)
+{
+	int nRes = 0;
+	struct epoll_event cEvent;
+
+	memset(&cEvent, 0, sizeof(cEvent));
+	cEvent.events = EPOLLIN;
+	cEvent.data.fd = nSock;
+	if (epoll_ctl(m_nEpoll, EPOLL_CTL_ADD, nSock, &cEvent) == INVALID_SOCKET) {
+		perr_printf("Couldn't add socket %d to epoll", nSock);
+		return ERR_EPOLL;
+	}
+
+	CONN cConn;
+	cConn.nSocket = nSock;
+	cConn.nPID = 0;
+	cConn.nOutputSent = 0;
+	cConn.nInput = 0;
+	cConn.bWantWrite = false;
+	cConn.bDegraded = false;
+	cConn.bLeaf = false;
+	cConn.bUpstream = false;
+	cConn.bGateway = false;
+	cConn.bCorked = false;
+	m_cConns[nSock] = cConn;
+
+	return nRes;
+}
+
+/*
+ * Remove the connection from epoll and connection map, and close it
+ */
+int CManager::CloseConnection(int nSock)
+{
+	int nRes = 0;
+	AUCTION* pAuction = NULL;
+	bool bUpstream = false;
+	debug_log("Closing connection %d", nSock);
+
+	/* bidder can't bid without a connection */
+	CONN_MAP::iterator cIter = m_cConns.find(nSock);
+	if (cIter != m_cConns.end() && (*cIter).second.nPID != 0) {
+		pAuction = FindAuction((*cIter).second.nAuction);
+		if (pAuction != NULL)
+			DeleteBidder(*pAuction, nSock);	/* all virtual bidders of a gateway */
+		if (pAuction != NULL && (*cIter).second.bGateway)
+			pAuction->cGateways.erase(std::remove(pAuction->cGateways.begin(), pAuction->cGateways.end(), nSock),
+				pAuction->cGateways.end());
+	}
+	if (cIter != m_cConns.end())
+		bUpstream = (*cIter).second.bUpstream;
+
+	if (epoll_ctl(m_nEpoll, EPOLL_CTL_DEL, nSock, NULL) == INVALID_SOCKET)
+		perr_printf("Couldn't remove socket %d from epoll", nSock);
+	close(nSock);
+	m_cConns.erase(nSock);
+	m_cLeaves.erase(nSock);		/* child manager has left, round goes on without him */
+
+	if (bUpstream) {
+		m_nUpstream = INVALID_SOCKET;
+		return LeaveFederation();
+	}
+
+	/*
+	 * Live set is smaller, others may have answered already
+	 */
+	if (pAuction != NULL)
+		nRes = CheckRound(*pAuction);
+
+	return nRes;
+}
+
+/*
+ * Arm or disarm EPOLLOUT
+ * only armed while there is queued data, otherwise epoll keeps waking up
+ */
+int CManager::WatchWrite(CONN& cConn, bool bWrite)
+{
+	if (cConn.bWantWrite == bWrite)
+		return ERR_SUCCESS;
+
+	struct epoll_event cEvent;
+	memset(&cEvent, 0, sizeof(cEvent));
+	cEvent.events = EPOLLIN | (bWrite ? (uint32_t) EPOLLOUT : 0u);
+	cEvent.data.fd = cConn.nSocket;
+	if (epoll_ctl(m_nEpoll, EPOLL_CTL_MOD, cConn.nSocket, &cEvent) == INVALID_SOCKET) {
+		perr_printf("Couldn't modify socket %d in epoll", cConn.nSocket);
+		return ERR_EPOLL;
+	}
+
+	cConn.bWantWrite = bWrite;
+	return ERR_SUCCESS;
+}
+
+/*
+ * Wait for events
+ * a busy polling manager polls epoll without sleeping for a while, then sleeps in it
+ * woken soon after it gave up, it spins longer next time; sleeping it out, shorter
+ */
+int CManager::WaitEvents(struct epoll_event* pEvents, int nTimeout)
+{
+	if (m_nSpinCPU < 0 || nTimeout == 0)
+		return epoll_wait(m_nEpoll, pEvents, MAX_EPOLL_EVENTS, nTimeout);
+
+	uint64_t nStart = CScheduler::Now();
+	uint64_t nDeadline = nTimeout < 0 ? UINT64_MAX : nStart + nTimeout * 1000000ULL;
+	uint64_t nSpinEnd = std::min(nStart + m_nSpinTime, nDeadline);
+	uint64_t nNow = nStart;
+	while (nNow < nSpinEnd) {
+		int nEvents = epoll_wait(m_nEpoll, pEvents, MAX_EPOLL_EVENTS, 0);
+		if (nEvents != 0) {
+			++ m_cSpin.nSpun;
+			return nEvents;
+		}
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#endif
+		nNow = CScheduler::Now();
+	}
+	if (nNow >= nDeadline)
+		return 0;		/* a deadline is due */
+
+	int nRest = nDeadline == UINT64_MAX ? -1 : (nDeadline - nNow + 999999) / 1000000;
+	int nEvents = epoll_wait(m_nEpoll, pEvents, MAX_EPOLL_EVENTS, nRest);
+	++ m_cSpin.nSlept;
+	if (nEvents > 0) {
+		++ m_cSpin.nWoken;
+		if (CScheduler::Now() - nNow < m_nSpinTime)
+			m_nSpinTime = std::min<uint64_t>(m_nSpinTime * 2, SPIN_MAX_TIME * 1000ULL);
+	}
+	else if (nEvents == 0)
+		m_nSpinTime = std::max<uint64_t>(m_nSpinTime / 2, SPIN_MIN_TIME * 1000ULL);
+
+	return nEvents;
+}
+
+/*
+ * Uncork, kernel sends what the loop has queued in this pass
+ * a connection closed since, or its socket reused, needs nothing
+ */
+int CManager::Uncork()
+{
+	for (size_t nCorked = 0; nCorked < m_cCorked.size(); ++ nCorked) {
+		CONN_MAP::iterator cIter = m_cConns.find(m_cCorked[nCorked]);
+		if (cIter == m_cConns.end() || !(*cIter).second.bCorked)
+			continue;
+
+		CSocket::Cork((*cIter).first, false);
+		(*cIter).second.bCorked = false;
+	}
+	m_cCorked.clear();
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Check if any bidder has data waiting to be sent
+ */
+bool CManager::HasPendingOutput() const
+{
+	for (CONN_MAP::const_iterator cIter = m_cConns.begin();
+		cIter != m_cConns.end();
+		++ cIter) {
+
+		if ((*cIter).second.nOutputSent < (*cIter).second.csOutput.size())
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Send the data to all bidders of auction
+ */
+int CManager::SendToAll(AUCTION& cAuction, const char* pBuffer, size_t nSize, bool bDroppable/* = false*/)
+{
+	int nRes = 0;
+	debug_log("Entering %s ...", __FUNCTION__);
+	BID_MAP::const_iterator cIter = cAuction.cBids.begin();
+	while (cIter != cAuction.cBids.end()) {
+		/*
+		 * If the bidder has a valid socket
+		 * Queue him data on that socket
+		 * virtual bidders get it once through their gateway
+		 * bidders with a proxy only hear the outcome
+		 */
+		if ((*cIter).second.nSocket != 0 && !(*cIter).second.bVirtual && !(*cIter).second.bProxy) {
+
+			/*
+			 * Queue data, a slow bidder doesn't hold up the others
+			 */
+			int nSent = QueueData((*cIter).second.nSocket,
+				       pBuffer,
+				       nSize,
+				       bDroppable);
+			if (nSent != ERR_SUCCESS)
+				nRes = nSent;
+		}
+		++ cIter;
+	}
+
+	for (size_t nGateway = 0; nGateway < cAuction.cGateways.size(); ++ nGateway) {
+		int nSent = QueueData(cAuction.cGateways[nGateway], pBuffer, nSize, bDroppable);
+		if (nSent != ERR_SUCCESS)
+			nRes = nSent;
+	}
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	return nRes;
+}
+
+/*
+ * Write auction to market data feed
+ * a few stores to its own cache line, watchers never slow us down
+ */
+void CManager::Publish(const AUCTION& cAuction)
+{
+	if (m_pFeed == NULL)
+		return;
+
+	FEED_SNAPSHOT cSnapshot;
+	cSnapshot.nAuction = cAuction.nAuction;
+	cSnapshot.nRound = cAuction.nRound;
+	cSnapshot.nPrice = (m_nMode == MODE_DUTCH && cAuction.nHighBidder == 0) ? cAuction.nClockPrice : cAuction.nHighBid;
+	cSnapshot.nLeader = cAuction.nHighBidder;
+	cSnapshot.nBidders = cAuction.cBids.size();
+	cSnapshot.nReplies = cAuction.nReplies;
+	if (cAuction.cBids.empty())
+		cSnapshot.nState = FEED_OVER;
+	else if (cAuction.bStarted)
+		cSnapshot.nState = FEED_BIDDING;
+	else
+		cSnapshot.nState = FEED_WAITING;
+	cSnapshot.nUpdated = CScheduler::Now();
+	m_pFeed->Publish(cSnapshot);
+}
+
+/*
+ * Send kill message to bidder
+ * a deferred kill is queued by FlushLosers, so a restart isn't held up by it
+ */
+int CManager::SendKill(AUCTION& cAuction, int nSock, pid_t nPID, bool bDefer/* = false*/)
+{
+	int nRes = 0;
+	debug_log("Entering %s ...", __FUNCTION__);
+	char cBuffer[MAX_MESSAGE_SIZE] = { 0 };
+	size_t nBufferLen = 0;
+	try {
+		BID_MAP::iterator cIter = cAuction.cBids.find(nPID);
+		bool bVirtual = cIter != cAuction.cBids.end() && (*cIter).second.bVirtual;
+		bool bBatched = cIter != cAuction.cBids.end() && (*cIter).second.bBatched;
+		if (cIter != cAuction.cBids.end())
+			RemoveBidder(cAuction, cIter);	/* Remove him from map before killing him */
+		if (!bBatched)
+			LeaveJoined(nPID);				/* he goes, his other auctions don't wait for him */
+
+		CONN_MAP::iterator cConn = m_cConns.find(nSock);
+		if (bBatched) {
+			/*
+			 * He is out of this auction only, his own goes on
+			 */
+			debug_log("Bidder %d is out of auction %u", nPID, cAuction.nAuction);
+		}
+		else if (bVirtual && cConn != m_cConns.end()) {
+			/*
+			 * Gateway is told in one frame, once the loop comes around
+			 */
+			if ((*cConn).second.cKills.empty())
+				m_cKillGateways.push_back(nSock);
+			(*cConn).second.cKills.push_back(nPID);
+		}
+		else if (bDefer)
+			m_cLosers.push_back(std::make_pair(nSock, nPID));
+		else {
+			sprintf(cBuffer, "kill\n");
+			nBufferLen = strlen(cBuffer);
+
+			/*
+			 * Queue kill message for bidder
+			 */
+			nRes = QueueData(nSock, cBuffer, nBufferLen);
+		}
+#if 0
+		/*
+		 * Manager can also send kill signal
+		 * But Manager uses TCP/IP
+		 */
+		nRes = kill(nPID, SIGUSR1);
+#endif
+	}
+	catch (std::exception e) {
+		perr_printf(e.what());
+	}
+	catch (...) {
+		err_printf("Unknown exception...");
+	}
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	return nRes;
+}
+
+/*
+ * Bid of an English auction
+ * it stands, if it beats the high bid; nothing else is compared
+ * bidders hear of it once the flush interval is over
+ */
+int CManager::RaiseBid(AUCTION& cAuction, BID_MAP::iterator cIter, unsigned int nBid)
+{
+	INFO& cInfo = (*cIter).second;
+	MarkReplied(cAuction, cInfo);		/* he has taken part */
+	if (cAuction.nHighBidder != 0 && nBid <= cAuction.nHighBid) {
+		debug_log("Bid %u of %d doesn't beat %u", nBid, (*cIter).first, cAuction.nHighBid);
+		return ERR_SUCCESS;
+	}
+
+	cInfo.nBid = nBid;
+	cInfo.dScore = nBid;
+	cAuction.nHighBid = nBid;
+	cAuction.nHighBidder = (*cIter).first;
+	debug_log("Auction %u: high bid %u by %d", cAuction.nAuction, nBid, (*cIter).first);
+
+	if (!cAuction.bPriceDirty) {
+		cAuction.bPriceDirty = true;
+		cAuction.nPriceFlush = CScheduler::Now() + PRICE_FLUSH_INTERVAL * 1000000ULL;
+		m_cPriceFlushes.push_back(cAuction.nAuction);
+	}
+
+	/* going, going... auction closes once nobody raises for a while */
+	unsigned int nCloseTime = m_nRoundTime != 0 ? m_nRoundTime : DEFAULT_CLOSE_TIME;
+	m_cScheduler.Schedule(&cAuction, CScheduler::Now() + nCloseTime * 1000000ULL);
+	Publish(cAuction);
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Send high bids of English auctions, whose interval is over
+ * a burst of bids between two flushes is one message per bidder
+ */
+int CManager::FlushPrices()
+{
+	int nRes = 0;
+	char cBuffer[MAX_MESSAGE_SIZE] = { 0 };
+	uint64_t nNow = CScheduler::Now();
+
+	while (!m_cPriceFlushes.empty()) {
+		AUCTION* pAuction = FindAuction(m_cPriceFlushes.front());
+		if (pAuction != NULL && pAuction->bPriceDirty) {
+			if (pAuction->nPriceFlush > nNow)
+				break;	/* flushes are in time order, rest are later */
+
+			size_t nBufferLen = sprintf(cBuffer, "price %u %d\n", pAuction->nHighBid, pAuction->nHighBidder);
+			pAuction->bPriceDirty = false;
+			nRes = SendToAll(*pAuction, cBuffer, nBufferLen, true);	/* slow bidder gets a later price */
+		}
+		m_cPriceFlushes.pop_front();
+	}
+
+	return nRes;
+}
+
+/*
+ * Nobody has raised the high bid for a while, it wins
+ */
+int CManager::CloseEnglish(AUCTION& cAuction)
+{
+	if (cAuction.nHighBidder == 0)
+		log_message("Auction %u: Nobody has bid, auction is over", cAuction.nAuction);
+	else
+		log_message("Auction %u: Winner is %d at %u, %u of %zu bidders have bid", cAuction.nAuction,
+			cAuction.nHighBidder, cAuction.nHighBid, cAuction.nReplies, cAuction.cBids.size());
+
+	/* Everybody is done, winner too */
+	while (!cAuction.cBids.empty()) {
+		BID_MAP::iterator cIter = cAuction.cBids.begin();
+		SendKill(cAuction, (*cIter).second.nSocket, (*cIter).first);	/* iterator is invalid after this */
+	}
+
+	log_message("Auction %u is over", cAuction.nAuction);
+	return ERR_MANAGER_DONE;
+}
+
+/*
+ * Round of a combinatorial auction is closed
+ * every bundle, which is part of the solution, wins; auction is over
+ */
+int CManager::CloseCombinatorial(AUCTION& cAuction)
+{
+	/*
+	 * Bundles of this round, in the round arena
+	 */
+	BUNDLE_BID* pBids = m_cRoundArena.Allocate<BUNDLE_BID>(cAuction.cBids.size());
+	size_t nBids = 0;
+	for (BID_MAP::const_iterator cIter = cAuction.cBids.begin();
+		cIter != cAuction.cBids.end();
+		++ cIter) {
+		if (!HasReplied(cAuction, (*cIter).second) || (*cIter).second.cItems.none())
+			continue;
+
+		pBids[nBids].nPID = (*cIter).first;
+		pBids[nBids].nPrice = (*cIter).second.nBid;
+		pBids[nBids].cItems = (*cIter).second.cItems;
+		++ nBids;
+	}
+
+	SOLUTION cSolution;
+	m_pSolver->Solve(pBids, nBids, SOLVER_TIME_BUDGET * 1000000ULL, cSolution);
+
+	for (size_t nWinner = 0; nWinner < cSolution.cWinners.size(); ++ nWinner) {
+		const BUNDLE_BID& cBid = pBids[cSolution.cWinners[nWinner]];
+		log_message("Auction %u: Winner is %d for %zu items at %u", cAuction.nAuction,
+			cBid.nPID, cBid.cItems.count(), cBid.nPrice);
+	}
+	log_message("Auction %u: %zu of %zu bundles win %llu, %s after %llu nodes in %.3f ms", cAuction.nAuction,
+		cSolution.cWinners.size(), nBids, (unsigned long long) cSolution.nRevenue,
+		cSolution.bOptimal ? "optimal" : "best in budget",
+		(unsigned long long) cSolution.nNodes, cSolution.nTime / 1e6);
+	m_cRoundArena.Reset();	/* scratch data of this round is gone */
+
+	/* Everybody is done, winners too */
+	while (!cAuction.cBids.empty()) {
+		BID_MAP::iterator cIter = cAuction.cBids.begin();
+		SendKill(cAuction, (*cIter).second.nSocket, (*cIter).first);	/* iterator is invalid after this */
+	}
+
+	log_message("Auction %u is over", cAuction.nAuction);
+	return ERR_MANAGER_DONE;
+}
+
+/*
+ * Arm Dutch clock, it ticks for every auction of this manager
+ */
+int CManager::StartClock()
+{
+	if (m_bClockRunning || m_nClockTimer == INVALID_SOCKET)
+		return ERR_SUCCESS;
+
+	struct itimerspec cTimer;
+	memset(&cTimer, 0, sizeof(cTimer));
+	cTimer.it_interval.tv_sec = m_nTickTime / 1000000;
+	cTimer.it_interval.tv_nsec = (m_nTickTime % 1000000) * 1000;
+	cTimer.it_value = cTimer.it_interval;
+	if (timerfd_settime(m_nClockTimer, 0, &cTimer, NULL) == INVALID_SOCKET) {
+		perr_printf("Couldn't start clock");
+		return ERR_EPOLL;
+	}
+
+	m_bClockRunning = true;
+	return ERR_SUCCESS;
+}
+
+/*
+ * Dutch clock has ticked, maybe more than once since we looked
+ * price goes down by a step for every tick, a tick message goes to bidders
+ * clock stops, once no auction is left on it
+ */
+int CManager::ClockTick()
+{
+	int nRes = 0;
+	uint64_t nTicks = 0;
+	char cBuffer[MAX_MESSAGE_SIZE] = { 0 };
+	bool bTicking = false;
+
+	if (read(m_nClockTimer, &nTicks, sizeof(nTicks)) == -1) {
+		if (errno != EAGAIN)
+			perr_printf("Couldn't read clock");
+		return ERR_SUCCESS;
+	}
+
+	/* acceptances of the last price are settled before it goes down */
+	SettleAccepts();
+
+	for (std::map<unsigned int, AUCTION>::iterator cIter = m_cAuctions.begin();
+		cIter != m_cAuctions.end();
+		++ cIter) {
+		AUCTION& cAuction = (*cIter).second;
+		if (!cAuction.bStarted || cAuction.cBids.empty())
+			continue;
+
+		uint64_t nDrop = nTicks * DUTCH_TICK_STEP;
+		if (cAuction.nClockPrice <= nDrop) {
+			/* clock has run out, nobody wants it */
+			cAuction.nClockPrice = 0;
+			if (CloseRound(cAuction) == ERR_MANAGER_DONE)
+				nRes = ERR_MANAGER_DONE;
+			continue;
+		}
+
+		/*
+		 * Message is made once, and queued for every connection
+		 * a slow bidder misses ticks, he gets a later one
+		 */
+		cAuction.nClockPrice -= nDrop;
+		size_t nBufferLen = sprintf(cBuffer, "tick %u\n", cAuction.nClockPrice);
+		SendToAll(cAuction, cBuffer, nBufferLen, true);
+		Publish(cAuction);
+		bTicking = true;
+	}
+
+	if (!bTicking) {
+		struct itimerspec cTimer;
+		memset(&cTimer, 0, sizeof(cTimer));
+		timerfd_settime(m_nClockTimer, 0, &cTimer, NULL);
+		m_bClockRunning = false;
+	}
+
+	return nRes;
+}
+
+/*
+ * Bid of a Dutch auction takes the price on clock
+ * it's kept with its arrival time, all of an epoll batch are settled together
+ */
+int CManager::AcceptPrice(AUCTION& cAuction, BID_MAP::iterator cIter, unsigned int nBid)
+{
+	MarkReplied(cAuction, (*cIter).second);
+	if (nBid < cAuction.nClockPrice) {
+		debug_log("Bidder %d accepted %u, clock is at %u", (*cIter).first, nBid, cAuction.nClockPrice);
+		return ERR_SUCCESS;
+	}
+
+	/* he pays the clock price he took, not what he sent */
+	ACCEPT cAccept = { cAuction.nAuction, (*cIter).first, cAuction.nClockPrice, m_nKernelArrival };
+	m_cAccepts.push_back(cAccept);
+	return ERR_SUCCESS;
+}
+
+/*
+ * First acceptance by arrival time wins its auction
+ * socket order in epoll batch doesn't decide it, the read time does
+ * or the kernel receive time, if sockets are stamped
+ */
+int CManager::SettleAccepts()
+{
+	int nRes = 0;
+	if (m_cAccepts.empty())
+		return ERR_SUCCESS;
+
+	std::stable_sort(m_cAccepts.begin(), m_cAccepts.end(),
+		[](const ACCEPT& cFirst, const ACCEPT& cSecond) { return cFirst.nArrival < cSecond.nArrival; });
+
+	for (size_t nAccept = 0; nAccept < m_cAccepts.size(); ++ nAccept) {
+		const ACCEPT& cAccept = m_cAccepts[nAccept];
+		AUCTION* pAuction = FindAuction(cAccept.nAuction);
+		if (pAuction == NULL)
+			continue;	/* auction is over */
+
+		if (pAuction->nHighBidder != 0) {
+			log_message("Auction %u: %d accepted %u, %.3f ms after the winner", cAccept.nAuction, cAccept.nPID,
+				cAccept.nPrice, (cAccept.nArrival - pAuction->nAccepted) / 1e6);
+			continue;
+		}
+
+		pAuction->nHighBid = cAccept.nPrice;
+		pAuction->nHighBidder = cAccept.nPID;
+		pAuction->nAccepted = cAccept.nArrival;
+		if (CloseRound(*pAuction) == ERR_MANAGER_DONE)
+			nRes = ERR_MANAGER_DONE;
+	}
+
+	m_cAccepts.clear();
+	return nRes;
+}
+
+/*
+ * Proxies bid for their bidders
+ * each raises his last bid by his step, up to his maximum
+ */
+int CManager::ProxyBids(AUCTION& cAuction)
+{
+	if (cAuction.nProxies == 0)
+		return ERR_SUCCESS;
+
+	m_nArrival = CScheduler::Now();		/* proxies bid now, nothing was read */
+	m_nKernelArrival = m_nArrival;
+
+	for (BID_MAP::const_iterator cIter = cAuction.cBids.begin();
+		cIter != cAuction.cBids.end();
+		++ cIter) {
+		const INFO& cInfo = (*cIter).second;
+		if (!cInfo.bProxy)
+			continue;
+
+		unsigned int nBid = cInfo.nBid + cInfo.nProxyStep;
+		if (nBid > cInfo.nProxyMax || nBid < cInfo.nBid)
+			nBid = cInfo.nProxyMax;
+		ApplyBid(cAuction, (*cIter).first, nBid);
+	}
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Returns true, if only proxies are left and none can raise
+ */
+bool CManager::ProxiesExhausted(const AUCTION& cAuction) const
+{
+	if (cAuction.nProxies == 0 || cAuction.nProxies < cAuction.cBids.size())
+		return false;
+
+	for (BID_MAP::const_iterator cIter = cAuction.cBids.begin();
+		cIter != cAuction.cBids.end();
+		++ cIter) {
+		if ((*cIter).second.nBid < (*cIter).second.nProxyMax)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Proxies are tied at their maximum, bidding again doesn't change it
+ * earliest bidder wins, as he joined first
+ */
+int CManager::SettleProxies(AUCTION& cAuction)
+{
+	BID_MAP::const_iterator cWinner = cAuction.cBids.begin();
+	for (BID_MAP::const_iterator cIter = cAuction.cBids.begin();
+		cIter != cAuction.cBids.end();
+		++ cIter) {
+		if ((*cIter).second.nSlot < (*cWinner).second.nSlot)
+			cWinner = cIter;
+	}
+
+	log_message("Auction %u: Proxies are tied at %u, earliest bidder wins", cAuction.nAuction, (*cWinner).second.nBid);
+	log_message("Auction %u: Winner is %d", cAuction.nAuction, (*cWinner).first);
+
+	while (!cAuction.cBids.empty()) {
+		BID_MAP::iterator cIter = cAuction.cBids.begin();
+		SendKill(cAuction, (*cIter).second.nSocket, (*cIter).first);	/* iterator is invalid after this */
+	}
+
+	log_message("Auction %u is over", cAuction.nAuction);
+	return ERR_MANAGER_DONE;
+}
+
+/*
+ * Kill losers of rounds closed in the last epoll batch
+ * next round has started by now, its bids are read before the losers' hangups
+ * they are out of the map already, nobody waits for them
+ */
+int CManager::FlushLosers()
+{
+	int nRes = 0;
+
+	for (size_t nLoser = 0; nLoser < m_cLosers.size(); ++ nLoser) {
+		CONN_MAP::const_iterator cConn = m_cConns.find(m_cLosers[nLoser].first);
+		if (cConn == m_cConns.end() || (*cConn).second.nPID != m_cLosers[nLoser].second)
+			continue;	/* he has gone already */
+
+		int nSent = QueueData(m_cLosers[nLoser].first, "kill\n", 5);
+		if (nSent != ERR_SUCCESS)
+			nRes = nSent;
+	}
+	m_cLosers.clear();
+
+	return nRes;
+}
+
+/*
+ * Round of a tagged bid must be open, and of bidder's auction
+ * a bid of the last round is stale once it's closed, one of an earlier round always
+ */
+bool CManager::IsStale(const CONN& cConn, const ROUND_TAG& cTag)
+{
+	const AUCTION* pAuction = FindAuction(cTag.nAuction);
+	if (pAuction != NULL &&
+	    cTag.nAuction == cConn.nAuction &&
+	    cTag.nRound == pAuction->nRound &&
+	    pAuction->nClosedRound != pAuction->nRound)
+		return false;
+
+	debug_log("Dropping bid of auction %u round %u from client %d", cTag.nAuction, cTag.nRound, cConn.nSocket);
+	++ m_nStaleBids;
+	return true;
+}
+
+/*
+ * Tell gateways about their killed bidders
+ * kills of a whole round go in a few frames, one write
+ */
+int CManager::FlushKills()
+{
+	int nRes = 0;
+	char cBuffer[MAX_FRAME_SIZE] = { 0 };
+
+	for (size_t nGateway = 0; nGateway < m_cKillGateways.size(); ++ nGateway) {
+		CONN_MAP::iterator cConn = m_cConns.find(m_cKillGateways[nGateway]);
+		if (cConn == m_cConns.end())
+			continue;	/* gateway has gone */
+
+		std::vector<pid_t>& cKills = (*cConn).second.cKills;
+		std::string csFrames;
+		for (size_t nFirst = 0; nFirst < cKills.size(); nFirst += MAX_BATCH_BIDS) {
+			unsigned int nIDs = std::min<size_t>(MAX_BATCH_BIDS, cKills.size() - nFirst);
+			size_t nUsed = CProtocol::FormatKills(cBuffer, sizeof(cBuffer), &cKills[nFirst], nIDs);
+			csFrames.append(cBuffer, nUsed);
+		}
+		cKills.clear();
+
+		int nSent = QueueData(m_cKillGateways[nGateway], csFrames.data(), csFrames.size());
+		if (nSent != ERR_SUCCESS)
+			nRes = nSent;
+	}
+	m_cKillGateways.clear();
+
+	return nRes;
+}
+
+/*
+ * Queue the data on bidder's connection
+ * If nothing is waiting, try to send it right away
+ * Droppable data is skipped for a degraded bidder
+ * A bidder over the high water mark is disconnected
+ */
+int CManager::QueueData(int nSock, const char* pBuffer, size_t nSize, bool bDroppable/* = false*/)
+{
+	int nRes = 0;
+	debug_log("Entering %s ...", __FUNCTION__);
+
+	CONN_MAP::iterator cIter = m_cConns.find(nSock);
+	if (cIter == m_cConns.end()) {
+		err_printf("Can't find connection %d", nSock);
+		return ERR_SOCKET_SEND;
+	}
+
+	CONN& cConn = (*cIter).second;
+	size_t nPending = cConn.csOutput.size() - cConn.nOutputSent;
+	if (bDroppable && cConn.bDegraded) {
+		/*
+		 * Bidder is behind, newer data will replace this anyway
+		 */
+		debug_log("Skipping %zu bytes for degraded client %d", nSize, nSock);
+		nRes = ERR_SLOW_CONSUMER;
+	}
+	else if (nPending + nSize > OUTBOUND_HIGH_WATER) {
+		/*
+		 * Bidder is chronically slow, disconnect him
+		 * shutdown makes epoll report him, and he is closed from there
+		 * so no map is changed under the caller
+		 */
+		err_printf("Client %d is too slow, %zu bytes queued, disconnecting", nSock, nPending);
+		cConn.csOutput.clear();
+		cConn.nOutputSent = 0;
+		shutdown(nSock, SHUT_RDWR);
+		nRes = ERR_SLOW_CONSUMER;
+	}
+	else {
+		/* frames of this pass leave together, once the loop uncorks */
+		if ((m_nProfile & SOCK_OPT_CORK) && !cConn.bCorked && CSocket::Cork(nSock, true)) {
+			cConn.bCorked = true;
+			m_cCorked.push_back(nSock);
+		}
+
+		cConn.csOutput.append(pBuffer, nSize);
+		if (!cConn.bWantWrite)
+			nRes = FlushData(nSock);	/* socket was writable last time, try now */
+	}
+
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	return nRes;
+}
+
+/*
+ * Flush queued data
+ * Send as much as socket takes, rest waits for EPOLLOUT
+ */
+int CManager::FlushData(int nSock)
+{
+	int nRes = 0;
+	ssize_t nWritten = 0;
+
+	debug_log("Entering %s ...", __FUNCTION__);
+
+	CONN_MAP::iterator cIter = m_cConns.find(nSock);
+	if (cIter == m_cConns.end())
+		return ERR_SOCKET_SEND;
+
+	CONN& cConn = (*cIter).second;
+
+	/*
+	 * keep sending the data, unless socket is full
+	 */
+	while (cConn.nOutputSent < cConn.csOutput.size()) {
+		debug_log("sending %zu bytes to client %d", cConn.csOutput.size() - cConn.nOutputSent, nSock);
+
+		/*
+		 * Send the data
+		 */
+		nWritten = send(nSock,
+				cConn.csOutput.data() + cConn.nOutputSent,
+				cConn.csOutput.size() - cConn.nOutputSent,
+				MSG_NOSIGNAL);
+		if (nWritten == -1) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				/*
+				 * Connection is broken, epoll reports it and it is closed there
+				 */
+				perr_printf("Couldn't send data to socket %d", nSock);
+				cConn.csOutput.clear();
+				cConn.nOutputSent = 0;
+				nRes = ERR_SOCKET_SEND;
+			}
+			break;
+		}
+
+		cConn.nOutputSent += nWritten;
+	}
+
+	if (cConn.nOutputSent == cConn.csOutput.size()) {
+		/* everything is sent */
+		cConn.csOutput.clear();
+		cConn.nOutputSent = 0;
+	}
+	else if (cConn.nOutputSent > cConn.csOutput.size() / 2) {
+		/* drop sent data, so queue doesn't grow forever */
+		cConn.csOutput.erase(0, cConn.nOutputSent);
+		cConn.nOutputSent = 0;
+	}
+
+	cConn.bDegraded = (cConn.csOutput.size() - cConn.nOutputSent) > OUTBOUND_LOW_WATER;
+	WatchWrite(cConn, !cConn.csOutput.empty());
+
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	return nRes;
+}
+
+/*
+ * Find the winner
+ */
+int CManager::FindWinner(AUCTION& cAuction)
 {
 	int nRes = 0;
+	debug_log("Entering %s ...", __FUNCTION__);
 	try {
-		for (std::map<pid_t, INFO>::iterator cIter = m_cBids.begin();
-			cIter != m_cBids.end();
+		/*
+		 * Bids are compared by score
+		 * score is the bid, unless a scoring engine has scored a bid vector
+		 * only bidders, who answered in this round, are compared
+		 */
+		double dMaxScore = 0;
+		bool bMaxScore = false;
+		for (BID_MAP::const_iterator cIter = cAuction.cBids.begin();
+			cIter != cAuction.cBids.end();
+			++ cIter) {
+			if (!HasReplied(cAuction, (*cIter).second))
+				continue;
+
+			/*
+			 * Find maximum bidder
+			 */
+			if (!bMaxScore || dMaxScore < (*cIter).second.dScore)
+				dMaxScore = (*cIter).second.dScore;
+			bMaxScore = true;
+
+			/* distribution is logged when the auction is over, this is for debugging */
+			debug_log("Auction %u: Bidder %d has bid %d, score %.2f", cAuction.nAuction,
+				(*cIter).first, (*cIter).second.nBid, (*cIter).second.dScore);
+		}
+
+		/* losers are kept in round arena, it's reset when round closes */
+		std::pair<int, pid_t>* pLosers = m_cRoundArena.Allocate<std::pair<int, pid_t> >(cAuction.cBids.size());
+		size_t nLosers = 0;
+		for (BID_MAP::const_iterator cIter = cAuction.cBids.begin();
+			cIter != cAuction.cBids.end();
 			++ cIter) {
+			/*
+			 * find the bidders, which are less then bids
+			 * or didn't answer before quorum closed the round
+			 * SendKill removes them from map, so don't kill while iterating
+			 */
+			if (!HasReplied(cAuction, (*cIter).second) || dMaxScore > (*cIter).second.dScore)
+				pLosers[nLosers ++] = std::make_pair((*cIter).second.nSocket, (*cIter).first);
+		}
+
+		for (size_t nLoser = 0; nLoser < nLosers; ++ nLoser)
+			SendKill(cAuction, pLosers[nLoser].first, pLosers[nLoser].second, true);	/* kill the losers, once a restart is out */
+
+		if (!bMaxScore)
+			log_message("Auction %u: Nobody has bid, auction is over", cAuction.nAuction);
+
+		/*
+		 * Bidders joined from other auctions get no orders, they can't bid in a restart
+		 * if only they are left, the one who reached the high bid first wins
+		 */
+		if (cAuction.cBids.size() > 1 && cAuction.nBatched == cAuction.cBids.size()) {
+			BID_MAP::const_iterator cWinner = cAuction.cBids.find(cAuction.nHighBidder);
+			if (cWinner == cAuction.cBids.end())
+				cWinner = cAuction.cBids.begin();
+			pid_t nWinner = (*cWinner).first;
+
+			nLosers = 0;
+			for (BID_MAP::const_iterator cIter = cAuction.cBids.begin();
+				cIter != cAuction.cBids.end();
+				++ cIter) {
+				if ((*cIter).first != nWinner)
+					pLosers[nLosers ++] = std::make_pair((*cIter).second.nSocket, (*cIter).first);
+			}
+			for (size_t nLoser = 0; nLoser < nLosers; ++ nLoser)
+				SendKill(cAuction, pLosers[nLoser].first, pLosers[nLoser].second, true);
+		}
+
+		if (cAuction.cBids.size() == 1) {
+			/*
+			 * If we have only one winner
+			 * Declare him as winner
+			 */
+			BID_MAP::const_iterator cIter = cAuction.cBids.begin();
+			if (dMaxScore == (*cIter).second.dScore)
+				log_message("Auction %u: Winner is %d", cAuction.nAuction, (*cIter).first);
+
+			/*
+			 * Kill the winner
+			 * Others are already killed
+			 */
+			SendKill(cAuction, (*cIter).second.nSocket, (*cIter).first);	/* iterator is invalid after this */
+
+			/*
+			 * Auction is done
+			 */
+			log_message("Auction %u is over", cAuction.nAuction);
+			nRes = ERR_MANAGER_DONE;
+		}
+		else if (cAuction.cBids.size() > 1) {
+
+			/*
+			 * We have more winners, restart bidding
+			 * Loosers are already killed
+			 */
+			log_message("Auction %u: More than one winners, restart bidding amongst winners", cAuction.nAuction);
+			nRes = ERR_RESTART_BIDS;
+		}
+	}
+	catch (std::exception e) {
+		perr_printf(e.what());
+	}
+	catch (...) {
+		err_printf("Unknown exception...");
+	}
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
+	return nRes;
+}
+
+/*
+ * Delete the bidder
+ */
+int CManager::DeleteBidder(AUCTION& cAuction, const int nClient)
+{
+	int nRes = 0;
+	try {
+		BID_MAP::iterator cIter = cAuction.cBids.begin();
+		while (cIter != cAuction.cBids.end()) {
 
 			/*
 			 * Find the bidder
@@ -655,8 +3507,10 @@ int CManager::DeleteBidder(const int nClient)
 				 * Remove the bidder from the map
 				 */
 				debug_log("Removing %d from map", (*cIter).first);
-				m_cBids.erase(cIter);
+				RemoveBidder(cAuction, cIter ++);
 			}
+			else
+				++ cIter;
 		}
 	}
 	catch (std::exception e) {
@@ -668,3 +3522,206 @@ int CManager::DeleteBidder(const int nClient)
 	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, nRes, nRes);
 	return nRes;
 }
+
+/*
+ * Remove auctions, which have no bidders left
+ */
+int CManager::ReapAuctions()
+{
+	std::map<unsigned int, AUCTION>::iterator cIter = m_cAuctions.begin();
+	while (cIter != m_cAuctions.end()) {
+		/* child managers need the auction, until they leave */
+		if ((*cIter).second.cBids.empty() && m_cLeaves.empty()) {
+			debug_log("Removing auction %u", (*cIter).first);
+			(*cIter).second.cStats.Log((*cIter).first);
+			m_cHistory.Flush();				/* history of a finished auction is complete on disk */
+			Publish((*cIter).second);		/* watchers see it's over */
+			m_cScheduler.Cancel(&(*cIter).second);
+			m_cAuctions.erase(cIter ++);
+		}
+		else
+			++ cIter;
+	}
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Watch every forked process with a pidfd
+ * called once epoll is there; a process, which has exited already, is reaped on first wait
+ * without pidfd_open, children are left to init
+ */
+int CManager::WatchChildren()
+{
+	struct epoll_event cEvent;
+	memset(&cEvent, 0, sizeof(cEvent));
+	for (size_t nChild = 0; nChild < m_cForked.size(); ++ nChild) {
+		const CHILD& cChild = m_cForked[nChild];
+#ifdef SYS_pidfd_open
+		int nPidFd = syscall(SYS_pidfd_open, cChild.nPID, 0);
+#else
+		int nPidFd = INVALID_SOCKET;
+		errno = ENOSYS;
+#endif
+		if (nPidFd == INVALID_SOCKET) {
+			perr_printf("Couldn't watch PID %d", cChild.nPID);
+			continue;
+		}
+
+		cEvent.events = EPOLLIN;
+		cEvent.data.fd = nPidFd;
+		if (epoll_ctl(m_nEpoll, EPOLL_CTL_ADD, nPidFd, &cEvent) == INVALID_SOCKET) {
+			perr_printf("Couldn't add PID %d to epoll", cChild.nPID);
+			close(nPidFd);
+			continue;
+		}
+
+		m_cChildren[nPidFd] = cChild;
+	}
+	m_cForked.clear();
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Forked process has exited
+ * a bidder, who died before he connected, is removed here, so his auction needn't wait for him
+ * a connected one is removed, once his connection is read to the end
+ */
+int CManager::ReapChild(int nPidFd)
+{
+	std::map<int, CHILD>::iterator cIter = m_cChildren.find(nPidFd);
+	if (cIter == m_cChildren.end())
+		return ERR_SUCCESS;
+
+	CHILD cChild = (*cIter).second;
+	m_cChildren.erase(cIter);
+	if (epoll_ctl(m_nEpoll, EPOLL_CTL_DEL, nPidFd, NULL) == INVALID_SOCKET)
+		perr_printf("Couldn't remove PID %d from epoll", cChild.nPID);
+	close(nPidFd);
+
+	int nStatus = 0;
+	if (waitpid(cChild.nPID, &nStatus, WNOHANG) != cChild.nPID) {
+		perr_printf("Couldn't reap PID %d", cChild.nPID);
+		return ERR_SUCCESS;
+	}
+
+	if (WIFSIGNALED(nStatus))
+		log_message("PID %d was killed by signal %d (%s)", cChild.nPID, WTERMSIG(nStatus), strsignal(WTERMSIG(nStatus)));
+	else if (WEXITSTATUS(nStatus) != 0)
+		log_message("PID %d exited with %d", cChild.nPID, WEXITSTATUS(nStatus));
+	else
+		debug_log("PID %d has exited", cChild.nPID);
+	LeaveJoined(cChild.nPID);
+
+	/* bidder, who was told to go, is out of his auction already */
+	AUCTION* pAuction = cChild.nAuction != 0 ? FindAuction(cChild.nAuction) : NULL;
+	if (pAuction == NULL)
+		return ERR_SUCCESS;
+
+	BID_MAP::iterator cBid = pAuction->cBids.find(cChild.nPID);
+	if (cBid == pAuction->cBids.end())
+		return ERR_SUCCESS;
+
+	CONN_MAP::iterator cConn = m_cConns.find((*cBid).second.nSocket);
+	if (cConn != m_cConns.end() && (*cConn).second.nPID == cChild.nPID)
+		return ERR_SUCCESS;		/* his last bids are still to be read */
+
+	log_message("Bidder %d of auction %u is gone, round goes on without him", cChild.nPID, cChild.nAuction);
+	RemoveBidder(*pAuction, cBid);
+	Publish(*pAuction);
+
+	return CheckRound(*pAuction);
+}
+
+/*
+ * Read signals, one is enough to stop every shard
+ */
+int CManager::ReadSignals()
+{
+	struct signalfd_siginfo cInfo;
+	bool bStop = false;
+	while (read(m_nSignals, &cInfo, sizeof(cInfo)) == sizeof(cInfo)) {
+		log_message("Got %s from PID %u, ending auctions", strsignal(cInfo.ssi_signo), cInfo.ssi_pid);
+		bStop = true;
+	}
+	if (!bStop)
+		return ERR_SUCCESS;		/* another shard has read it */
+
+	if (m_pShards == NULL)
+		Stop();
+	else {
+		for (size_t nShard = 0; nShard < m_pShards->size(); ++ nShard)
+			(*m_pShards)[nShard]->Stop();
+	}
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Stop the manager
+ * its loop drains at the top, the handoff event wakes it up
+ */
+void CManager::Stop()
+{
+	m_bStopping = true;
+
+	uint64_t nCount = 1;
+	if (m_nHandoffEvent != INVALID_SOCKET && write(m_nHandoffEvent, &nCount, sizeof(nCount)) == -1)
+		perr_printf("Couldn't wake shard %u", m_nShard);
+}
+
+/*
+ * Tell every bidder to go, and let child managers go
+ * auctions are empty then, they are reaped, and loop exits once kills are flushed
+ */
+int CManager::Drain()
+{
+	debug_log("Entering %s ...", __FUNCTION__);
+	m_bDrained = true;
+
+	size_t nKilled = 0;
+	for (std::map<unsigned int, AUCTION>::iterator cIter = m_cAuctions.begin();
+		cIter != m_cAuctions.end();
+		++ cIter) {
+		AUCTION& cAuction = (*cIter).second;
+		while (!cAuction.cBids.empty()) {
+			BID_MAP::iterator cBid = cAuction.cBids.begin();
+			if (m_cConns.find((*cBid).second.nSocket) == m_cConns.end()) {
+				RemoveBidder(cAuction, cBid);	/* not connected yet, nothing to tell him */
+				continue;
+			}
+			SendKill(cAuction, (*cBid).second.nSocket, (*cBid).first);
+			++ nKilled;
+		}
+	}
+
+	std::vector<int> cLeaves;
+	for (std::map<int, LEAF>::const_iterator cIter = m_cLeaves.begin();
+		cIter != m_cLeaves.end();
+		++ cIter)
+		cLeaves.push_back((*cIter).first);
+	for (size_t nLeaf = 0; nLeaf < cLeaves.size(); ++ nLeaf)
+		CloseConnection(cLeaves[nLeaf]);
+
+	log_message("Stopping, %zu bidders and %zu child managers are told to go", nKilled, cLeaves.size());
+
+	debug_log("Exiting %s ...", __FUNCTION__);
+	return ERR_SUCCESS;
+}
+
+/*
+ * Block SIGINT and SIGTERM in calling thread, threads started after it inherit it
+ * managers read them from their signalfd, forked children unblock them
+ */
+int CManager::BlockSignals()
+{
+	sigset_t cSignals;
+	ShutdownSignals(cSignals);
+	if (sigprocmask(SIG_BLOCK, &cSignals, NULL) == -1) {
+		perr_printf("Couldn't block signals");
+		return ERR_SIGNAL;
+	}
+
+	return ERR_SUCCESS;
+}
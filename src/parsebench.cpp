@@ -0,0 +1,150 @@
+/* Headers */
+#include "support.h"
+#include "log.h"
+#include "protocol.h"
+
+/* Messages in the corpus, half hellos, half bids */
+static const unsigned int BENCH_MESSAGES = 1000000;
+
+/* Passes over the corpus, best one is reported */
+static const unsigned int BENCH_PASSES = 5;
+
+/*
+ * Print usage of benchmark
+ */
+void Usage()
+{
+	printf("Usage: parsebench [MESSAGES]\n"
+		"\n"
+		"    Parse MESSAGES (default %u) hello and bid lines in place with CProtocol,\n"
+		"    and as the manager used to, copying each line to a std::string split with atoi\n"
+		"\n", BENCH_MESSAGES);
+}
+
+/*
+ * ns since some point
+ */
+static uint64_t Now()
+{
+	struct timespec cNow;
+	clock_gettime(CLOCK_MONOTONIC, &cNow);
+	return cNow.tv_sec * 1000000000ULL + cNow.tv_nsec;
+}
+
+/*
+ * In place, every line framed and parsed from the buffer
+ */
+static uint64_t ParseInPlace(const std::string& csCorpus)
+{
+	uint64_t nSum = 0;
+	const char* pBuffer = csCorpus.data();
+	size_t nSize = csCorpus.size();
+	std::string_view csMessage;
+	size_t nUsed = 0;
+	while ((nUsed = CProtocol::NextMessage(pBuffer, nSize, csMessage)) != 0) {
+		HELLO cHello;
+		BID cBid;
+		if (CProtocol::ParseBid(csMessage, cBid) == ERR_SUCCESS)
+			nSum += cBid.nPID + cBid.nBid;
+		else if (CProtocol::ParseHello(csMessage, cHello) == ERR_SUCCESS)
+			nSum += cHello.nPort + cHello.nPID + cHello.nAuction;
+		pBuffer += nUsed;
+		nSize -= nUsed;
+	}
+
+	return nSum;
+}
+
+/*
+ * As AcceptBidders did, before CProtocol
+ * a line is copied to a std::string, fields are split with substr and read with atoi
+ */
+static uint64_t ParseStrings(const std::string& csCorpus)
+{
+	uint64_t nSum = 0;
+	size_t nStart = 0;
+	while (nStart < csCorpus.size()) {
+		size_t nEnd = csCorpus.find('\n', nStart);
+		std::string csLine = csCorpus.substr(nStart, nEnd - nStart);
+		nStart = nEnd + 1;
+
+		size_t nIndex = csLine.find(":");
+		size_t nNextIndex = csLine.find(":", nIndex + 1);
+		if (nNextIndex == std::string::npos) {
+			/* bid "<pid>: <bid>" */
+			std::string csPID = csLine.substr(0, nIndex);
+			std::string csBid = csLine.substr(nIndex + 2);
+			nSum += atoi(csPID.c_str()) + atoi(csBid.c_str());
+		}
+		else {
+			/* hello "<port>: <pid>: <auction>" */
+			std::string csPort = csLine.substr(0, nIndex);
+			std::string csPID = csLine.substr(nIndex + 1, nNextIndex - nIndex - 1);
+			std::string csAuction = csLine.substr(nNextIndex + 1);
+			nSum += atoi(csPort.c_str()) + atoi(csPID.c_str()) + atoi(csAuction.c_str());
+		}
+	}
+
+	return nSum;
+}
+
+/*
+ * Best of passes, ns per message
+ */
+static double Time(uint64_t (*pParse)(const std::string&), const std::string& csCorpus,
+	unsigned int nMessages, uint64_t& nSum)
+{
+	uint64_t nBest = UINT64_MAX;
+	for (unsigned int nPass = 0; nPass < BENCH_PASSES; ++ nPass) {
+		uint64_t nStart = Now();
+		nSum = pParse(csCorpus);
+		nBest = std::min(nBest, Now() - nStart);
+	}
+
+	return (double) nBest / nMessages;
+}
+
+/*
+ * main program
+ */
+int main(int argc, char* argv[])
+{
+	if (argc > 2) {
+		Usage();
+		return 1;
+	}
+	unsigned int nMessages = argc == 2 ? atoi(argv[1]) : BENCH_MESSAGES;
+	if (nMessages == 0) {
+		Usage();
+		return 1;
+	}
+
+	/* same corpus for both, seeded so runs compare */
+	srand(1);
+	std::string csCorpus;
+	char cLine[MAX_MESSAGE_SIZE] = { 0 };
+	for (unsigned int nMessage = 0; nMessage < nMessages; ++ nMessage) {
+		pid_t nPID = 1000 + rand() % 4000000;
+		if (nMessage % 2 == 0)
+			snprintf(cLine, sizeof(cLine), "%u: %d: %u\n", 1024 + rand() % 60000, nPID, 1 + rand() % 64);
+		else
+			snprintf(cLine, sizeof(cLine), "%d: %u\n", nPID, rand() % 100000);
+		csCorpus += cLine;
+	}
+
+	uint64_t nInPlace = 0;
+	uint64_t nStrings = 0;
+	double dInPlace = Time(ParseInPlace, csCorpus, nMessages, nInPlace);
+	double dStrings = Time(ParseStrings, csCorpus, nMessages, nStrings);
+	if (nInPlace != nStrings) {
+		err_printf("Parsers disagree, %llu and %llu", (unsigned long long) nInPlace, (unsigned long long) nStrings);
+		return 1;
+	}
+
+	log_message("%u messages, %zu bytes, best of %u passes", nMessages, csCorpus.size(), BENCH_PASSES);
+	log_message("CProtocol in place:   %.1f ns per message, %.2f M messages/s", dInPlace, 1e3 / dInPlace);
+	log_message("std::string and atoi: %.1f ns per message, %.2f M messages/s", dStrings, 1e3 / dStrings);
+	log_message("In place is %.2fx as fast", dStrings / dInPlace);
+
+	return 0;
+}
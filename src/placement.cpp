@@ -0,0 +1,204 @@
+/*
+ * header files
+ */
+#include "support.h"
+#include "log.h"
+#include "placement.h"
+
+/* CPUs of NUMA node %u, as a list "0-3,8" */
+static const char* NODE_CPULIST = "/sys/devices/system/node/node%u/cpulist";
+
+/*
+ * Constructor
+ */
+CPlacement::CPlacement()
+{
+	CPU_ZERO(&m_cCPUs);
+	m_nCPUs = 0;
+	m_nNodes = 0;
+}
+
+/*
+ * Take a spec, items are separated by commas
+ * "nodeN" is all CPUs of node N, anything else is a CPU or a range of CPUs
+ */
+bool CPlacement::Parse(const std::string& csSpec)
+{
+	cpu_set_t cCPUs;
+	CPU_ZERO(&cCPUs);
+
+	size_t nStart = 0;
+	while (nStart <= csSpec.size()) {
+		size_t nEnd = csSpec.find(',', nStart);
+		if (nEnd == std::string::npos)
+			nEnd = csSpec.size();
+		std::string csItem = csSpec.substr(nStart, nEnd - nStart);
+		nStart = nEnd + 1;
+
+		if (csItem.compare(0, 4, "node") == 0) {
+			char* pEnd = NULL;
+			unsigned long nNode = strtoul(csItem.c_str() + 4, &pEnd, 10);
+			if (csItem.size() == 4 || *pEnd != '\0' || nNode >= MAX_NUMA_NODES) {
+				err_printf("%s isn't a NUMA node", csItem.c_str());
+				return false;
+			}
+
+			cpu_set_t cNode;
+			if (!NodeCPUs(nNode, cNode)) {
+				err_printf("There is no NUMA node %lu", nNode);
+				return false;
+			}
+			CPU_OR(&cCPUs, &cCPUs, &cNode);
+		}
+		else if (!ParseList(csItem, cCPUs)) {
+			err_printf("%s isn't a CPU list like 0-3,8 or a node like node0", csSpec.c_str());
+			return false;
+		}
+	}
+
+	/* a CPU out of our affinity can't be run on */
+	cpu_set_t cAllowed;
+	if (sched_getaffinity(0, sizeof(cAllowed), &cAllowed) == 0)
+		CPU_AND(&cCPUs, &cCPUs, &cAllowed);
+	if (CPU_COUNT(&cCPUs) == 0) {
+		err_printf("None of CPUs %s can be run on", csSpec.c_str());
+		return false;
+	}
+
+	/* memory comes from nodes having the CPUs */
+	uint64_t nNodes = 0;
+	for (unsigned int nNode = 0; nNode < MAX_NUMA_NODES; ++ nNode) {
+		cpu_set_t cNode;
+		if (!NodeCPUs(nNode, cNode))
+			continue;
+		CPU_AND(&cNode, &cNode, &cCPUs);
+		if (CPU_COUNT(&cNode) != 0)
+			nNodes |= 1ULL << nNode;
+	}
+
+	m_csSpec = csSpec;
+	m_cCPUs = cCPUs;
+	m_nCPUs = CPU_COUNT(&cCPUs);
+	m_nNodes = nNodes;
+	return true;
+}
+
+/*
+ * Restrict calling thread to the CPUs, and bind its memory to their nodes
+ * pages already touched stay where they are
+ */
+int CPlacement::Apply() const
+{
+	if (!IsSet())
+		return ERR_SUCCESS;
+
+	if (sched_setaffinity(0, sizeof(m_cCPUs), &m_cCPUs) == -1) {
+		perr_printf("Couldn't run on CPUs %s", m_csSpec.c_str());
+		return ERR_PLACEMENT;
+	}
+
+#if defined(HAVE_LINUX_MEMPOLICY_H) && defined(SYS_set_mempolicy)
+	if (m_nNodes != 0) {
+		unsigned long nNodes = m_nNodes;
+		if (syscall(SYS_set_mempolicy, MPOL_BIND, &nNodes, MAX_NUMA_NODES + 1) == -1) {
+			perr_printf("Couldn't bind memory to nodes of CPUs %s", m_csSpec.c_str());
+			return ERR_PLACEMENT;
+		}
+	}
+#endif
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Pin calling thread to nIndex-th CPU of the set
+ * memory is bound as in Apply
+ */
+int CPlacement::Pin(unsigned int nIndex) const
+{
+	if (!IsSet())
+		return ERR_SUCCESS;
+
+	int nRes = Apply();
+	if (nRes != ERR_SUCCESS)
+		return nRes;
+
+	nIndex %= m_nCPUs;
+	for (int nCPU = 0; nCPU < CPU_SETSIZE; ++ nCPU) {
+		if (CPU_ISSET(nCPU, &m_cCPUs) && nIndex -- == 0)
+			return PinTo(nCPU);
+	}
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Pin calling thread to nCPU
+ */
+int CPlacement::PinTo(int nCPU)
+{
+	cpu_set_t cCPUs;
+	CPU_ZERO(&cCPUs);
+	CPU_SET(nCPU, &cCPUs);
+	if (sched_setaffinity(0, sizeof(cCPUs), &cCPUs) == -1) {
+		perr_printf("Couldn't pin to CPU %d", nCPU);
+		return ERR_PLACEMENT;
+	}
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Add CPUs of a list, "0-3,8", to cCPUs
+ */
+bool CPlacement::ParseList(const std::string& csList, cpu_set_t& cCPUs)
+{
+	const char* pList = csList.c_str();
+	while (*pList != '\0' && *pList != '\n') {
+		char* pEnd = NULL;
+		if (*pList < '0' || *pList > '9')
+			return false;
+		unsigned long nFirst = strtoul(pList, &pEnd, 10);
+		unsigned long nLast = nFirst;
+		if (*pEnd == '-') {
+			pList = pEnd + 1;
+			if (*pList < '0' || *pList > '9')
+				return false;
+			nLast = strtoul(pList, &pEnd, 10);
+		}
+		if (nLast < nFirst || nLast >= CPU_SETSIZE)
+			return false;
+
+		for (unsigned long nCPU = nFirst; nCPU <= nLast; ++ nCPU)
+			CPU_SET(nCPU, &cCPUs);
+
+		pList = pEnd;
+		if (*pList == ',')
+			++ pList;
+		else if (*pList != '\0' && *pList != '\n')
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * CPUs of NUMA node nNode, from sysfs
+ */
+bool CPlacement::NodeCPUs(unsigned int nNode, cpu_set_t& cCPUs)
+{
+	CPU_ZERO(&cCPUs);
+
+	char cPath[128] = { 0 };
+	snprintf(cPath, sizeof(cPath), NODE_CPULIST, nNode);
+	FILE* pFile = fopen(cPath, "re");
+	if (pFile == NULL)
+		return false;
+
+	char cList[4096] = { 0 };
+	bool bRead = fgets(cList, sizeof(cList), pFile) != NULL;
+	fclose(pFile);
+
+	/* a node of memory only has an empty list */
+	return bRead ? ParseList(cList, cCPUs) : true;
+}
@@ -0,0 +1,196 @@
+/*
+ * header files
+ */
+#include "support.h"
+#include "log.h"
+#include "pool.h"
+
+bool CPages::s_bHugePages = false;
+
+/*
+ * Map pages
+ * Falls back to normal pages, if no huge page is free
+ */
+void* CPages::Map(size_t nSize)
+{
+	void* pPages = MAP_FAILED;
+#ifdef MAP_HUGETLB
+	if (s_bHugePages)
+		pPages = mmap(NULL, nSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+	if (pPages == MAP_FAILED)
+		pPages = mmap(NULL, nSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (pPages == MAP_FAILED) {
+		perr_printf("Couldn't map %zu bytes", nSize);
+		throw std::bad_alloc();
+	}
+
+	return pPages;
+}
+
+/*
+ * Unmap pages
+ */
+void CPages::Unmap(void* pPages, size_t nSize)
+{
+	if (munmap(pPages, nSize) == -1)
+		perr_printf("Couldn't unmap %zu bytes", nSize);
+}
+
+/*
+ * Chunk size
+ */
+size_t CPages::ChunkSize()
+{
+	return s_bHugePages ? HUGE_PAGE_SIZE : POOL_CHUNK_SIZE;
+}
+
+/*
+ * Constructor
+ */
+CSlabPool::CSlabPool()
+{
+	m_nObject = 0;
+	m_nSize = 0;
+	m_pFree = NULL;
+	m_pSlabs = NULL;
+}
+
+/*
+ * Destructor
+ * Objects must be freed already, slabs go back to kernel
+ */
+CSlabPool::~CSlabPool()
+{
+	size_t nChunk = CPages::ChunkSize();
+	while (m_pSlabs != NULL) {
+		CSlab* pSlab = m_pSlabs;
+		m_pSlabs = pSlab->pNext;
+		CPages::Unmap(pSlab, nChunk);
+	}
+}
+
+/*
+ * Take an object from free list
+ */
+void* CSlabPool::Allocate(size_t nSize)
+{
+	if (m_nObject == 0) {
+		/* room for free list link, and aligned like anything */
+		m_nObject = nSize;
+		m_nSize = nSize;
+		if (m_nSize < sizeof(CFree))
+			m_nSize = sizeof(CFree);
+		m_nSize = (m_nSize + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+	}
+
+	if (m_pFree == NULL)
+		Grow();
+
+	CFree* pObject = m_pFree;
+	m_pFree = pObject->pNext;
+	return pObject;
+}
+
+/*
+ * Put an object back on free list
+ */
+void CSlabPool::Free(void* pObject)
+{
+	CFree* pFree = static_cast<CFree*>(pObject);
+	pFree->pNext = m_pFree;
+	m_pFree = pFree;
+}
+
+/*
+ * Add a slab
+ * First object's room holds slab link
+ */
+int CSlabPool::Grow()
+{
+	size_t nChunk = CPages::ChunkSize();
+	char* pSlab = static_cast<char*>(CPages::Map(nChunk));
+	debug_log("Pool of %zu byte objects grows by %zu bytes", m_nSize, nChunk);
+
+	CSlab* pHead = reinterpret_cast<CSlab*>(pSlab);
+	pHead->pNext = m_pSlabs;
+	m_pSlabs = pHead;
+
+	size_t nFirst = (sizeof(CSlab) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+	for (size_t nOffset = nFirst; nOffset + m_nSize <= nChunk; nOffset += m_nSize)
+		Free(pSlab + nOffset);
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Constructor
+ */
+CArena::CArena()
+{
+	m_pChunks = NULL;
+	m_pCurrent = NULL;
+	m_nUsed = 0;
+}
+
+/*
+ * Destructor
+ */
+CArena::~CArena()
+{
+	while (m_pChunks != NULL) {
+		CChunk* pChunk = m_pChunks;
+		m_pChunks = pChunk->pNext;
+		CPages::Unmap(pChunk, pChunk->nSize);
+	}
+}
+
+/*
+ * Bump allocate
+ * Moves on to next chunk, or maps a new one, if current is full
+ */
+void* CArena::Allocate(size_t nSize, size_t nAlign/* = alignof(std::max_align_t)*/)
+{
+	while (true) {
+		if (m_pCurrent != NULL) {
+			size_t nOffset = (m_nUsed + nAlign - 1) & ~(nAlign - 1);
+			if (nOffset + nSize <= m_pCurrent->nSize) {
+				m_nUsed = nOffset + nSize;
+				return reinterpret_cast<char*>(m_pCurrent) + nOffset;
+			}
+
+			if (m_pCurrent->pNext != NULL) {
+				/* chunk kept from an earlier round */
+				m_pCurrent = m_pCurrent->pNext;
+				m_nUsed = sizeof(CChunk);
+				continue;
+			}
+		}
+
+		/*
+		 * Map a chunk, big enough for this allocation
+		 */
+		size_t nChunk = CPages::ChunkSize();
+		while (nChunk < sizeof(CChunk) + nSize + nAlign)
+			nChunk *= 2;
+
+		CChunk* pChunk = static_cast<CChunk*>(CPages::Map(nChunk));
+		pChunk->pNext = NULL;
+		pChunk->nSize = nChunk;
+		if (m_pCurrent != NULL)
+			m_pCurrent->pNext = pChunk;
+		else
+			m_pChunks = pChunk;
+		m_pCurrent = pChunk;
+		m_nUsed = sizeof(CChunk);
+	}
+}
+
+/*
+ * Reset, in O(1)
+ */
+void CArena::Reset()
+{
+	m_pCurrent = m_pChunks;
+	m_nUsed = sizeof(CChunk);
+}
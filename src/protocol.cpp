@@ -0,0 +1,806 @@
+/*
+ * header files
+ */
+#include "support.h"
+#include "log.h"
+#include "protocol.h"
+
+#include <cmath>
+
+/*
+ * Find the next message in buffer
+ * Message is returned without the '\n'
+ */
+size_t CProtocol::NextMessage(const char* pBuffer, size_t nSize, std::string_view& csMessage)
+{
+	const char* pEnd = (const char*) memchr(pBuffer, '\n', nSize);
+	if (pEnd == NULL)
+		return 0;	/* wait for the rest of the message */
+
+	csMessage = std::string_view(pBuffer, pEnd - pBuffer);
+	return (pEnd - pBuffer) + 1;
+}
+
+/*
+ * Parse hello "<port>: <pid>: <auction>" or "<port>: <pid>"
+ */
+int CProtocol::ParseHello(std::string_view csMessage, HELLO& cHello)
+{
+	std::string_view csPort;
+	std::string_view csRest;
+	std::string_view csPID;
+	std::string_view csAuction;
+
+	if (!SplitPair(csMessage, csPort, csRest))
+		return ERR_PROTOCOL;
+
+	/* older bidders don't send auction */
+	cHello.nAuction = DEFAULT_AUCTION;
+	if (!SplitPair(csRest, csPID, csAuction))
+		csPID = csRest;
+	else if (!ParseNumber(csAuction, cHello.nAuction))
+		return ERR_PROTOCOL;
+
+	if (!ParseNumber(csPort, cHello.nPort) ||
+	    !ParseNumber(csPID, cHello.nPID) ||
+	    cHello.nPort == 0 ||
+	    cHello.nPID <= 0)
+		return ERR_PROTOCOL;
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Parse bid "<pid>: <bid>"
+ */
+int CProtocol::ParseBid(std::string_view csMessage, BID& cBid)
+{
+	std::string_view csPID;
+	std::string_view csBid;
+
+	if (!SplitPair(csMessage, csPID, csBid) ||
+	    !ParseNumber(csPID, cBid.nPID) ||
+	    !ParseNumber(csBid, cBid.nBid) ||
+	    cBid.nPID <= 0)
+		return ERR_PROTOCOL;
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Check for batch frame
+ */
+bool CProtocol::IsBatch(std::string_view csMessage)
+{
+	return csMessage.substr(0, 6) == "batch ";
+}
+
+/*
+ * Parse batch "batch <pid>: <auction>=<bid> <auction>=<bid> ..."
+ */
+int CProtocol::ParseBatch(std::string_view csMessage, BATCH& cBatch)
+{
+	std::string_view csPID;
+	std::string_view csBids;
+
+	if (!IsBatch(csMessage) ||
+	    !SplitPair(csMessage.substr(6), csPID, csBids) ||
+	    !ParseNumber(csPID, cBatch.nPID) ||
+	    cBatch.nPID <= 0)
+		return ERR_PROTOCOL;
+
+	cBatch.nBids = 0;
+	while (!csBids.empty()) {
+		size_t nEnd = csBids.find(' ');
+		std::string_view csPair = csBids.substr(0, nEnd);
+		size_t nEqual = csPair.find('=');
+
+		if (cBatch.nBids == MAX_BATCH_BIDS ||
+		    nEqual == std::string_view::npos ||
+		    !ParseNumber(csPair.substr(0, nEqual), cBatch.cBids[cBatch.nBids].nAuction) ||
+		    !ParseNumber(csPair.substr(nEqual + 1), cBatch.cBids[cBatch.nBids].nBid))
+			return ERR_PROTOCOL;
+
+		++ cBatch.nBids;
+		if (nEnd == std::string_view::npos)
+			break;
+
+		csBids = csBids.substr(nEnd + 1);
+		if (csBids.empty())
+			return ERR_PROTOCOL;	/* trailing space */
+	}
+
+	return (cBatch.nBids != 0) ? ERR_SUCCESS : ERR_PROTOCOL;
+}
+
+/*
+ * Check for proxy
+ */
+bool CProtocol::IsProxy(std::string_view csMessage)
+{
+	return csMessage.substr(0, 6) == "proxy ";
+}
+
+/*
+ * Parse proxy "proxy <pid>: <bid> <max> <step>"
+ */
+int CProtocol::ParseProxy(std::string_view csMessage, PROXY& cProxy)
+{
+	std::string_view csPID;
+	std::string_view csFields;
+
+	if (!IsProxy(csMessage) ||
+	    !SplitPair(csMessage.substr(6), csPID, csFields) ||
+	    !ParseNumber(csPID, cProxy.nPID) ||
+	    cProxy.nPID <= 0)
+		return ERR_PROTOCOL;
+
+	size_t nFirst = csFields.find(' ');
+	size_t nSecond = (nFirst == std::string_view::npos) ? nFirst : csFields.find(' ', nFirst + 1);
+	if (nSecond == std::string_view::npos ||
+	    !ParseNumber(csFields.substr(0, nFirst), cProxy.nBid) ||
+	    !ParseNumber(csFields.substr(nFirst + 1, nSecond - nFirst - 1), cProxy.nMax) ||
+	    !ParseNumber(csFields.substr(nSecond + 1), cProxy.nStep) ||
+	    cProxy.nBid > cProxy.nMax ||
+	    cProxy.nStep == 0)
+		return ERR_PROTOCOL;
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Check for bundle bid
+ */
+bool CProtocol::IsBundle(std::string_view csMessage)
+{
+	return csMessage.substr(0, 7) == "bundle ";
+}
+
+/*
+ * Parse bundle bid "bundle <pid>: <price> <item> <item> ..."
+ */
+int CProtocol::ParseBundle(std::string_view csMessage, BUNDLE& cBundle)
+{
+	std::string_view csPID;
+	std::string_view csFields;
+
+	if (!IsBundle(csMessage) ||
+	    !SplitPair(csMessage.substr(7), csPID, csFields) ||
+	    !ParseNumber(csPID, cBundle.nPID) ||
+	    cBundle.nPID <= 0)
+		return ERR_PROTOCOL;
+
+	size_t nEnd = csFields.find(' ');
+	if (nEnd == std::string_view::npos || !ParseNumber(csFields.substr(0, nEnd), cBundle.nPrice))
+		return ERR_PROTOCOL;
+
+	cBundle.nItems = 0;
+	csFields = csFields.substr(nEnd + 1);
+	while (!csFields.empty()) {
+		nEnd = csFields.find(' ');
+		if (cBundle.nItems == MAX_BUNDLE_ITEMS ||
+		    !ParseNumber(csFields.substr(0, nEnd), cBundle.cItems[cBundle.nItems]) ||
+		    cBundle.cItems[cBundle.nItems] >= MAX_ITEMS)
+			return ERR_PROTOCOL;
+
+		/* an item is in the bundle once, so nItems is the size of the set */
+		for (unsigned int nItem = 0; nItem < cBundle.nItems; ++ nItem) {
+			if (cBundle.cItems[nItem] == cBundle.cItems[cBundle.nItems])
+				return ERR_PROTOCOL;
+		}
+
+		++ cBundle.nItems;
+		if (nEnd == std::string_view::npos)
+			break;
+
+		csFields = csFields.substr(nEnd + 1);
+		if (csFields.empty())
+			return ERR_PROTOCOL;	/* trailing space */
+	}
+
+	return cBundle.nItems != 0 ? ERR_SUCCESS : ERR_PROTOCOL;
+}
+
+/*
+ * Check for multi attribute bid
+ */
+bool CProtocol::IsAttributes(std::string_view csMessage)
+{
+	return csMessage.substr(0, 5) == "attr ";
+}
+
+/*
+ * Parse multi attribute bid "attr <pid>: <price> <delivery> <quality> <penalty>"
+ */
+int CProtocol::ParseAttributes(std::string_view csMessage, ATTR_BID& cBid)
+{
+	std::string_view csPID;
+	std::string_view csVector;
+
+	if (!IsAttributes(csMessage) ||
+	    !SplitPair(csMessage.substr(5), csPID, csVector) ||
+	    !ParseNumber(csPID, cBid.nPID) ||
+	    cBid.nPID <= 0)
+		return ERR_PROTOCOL;
+
+	unsigned int* pFields[] = {
+		&cBid.cVector.nPrice,
+		&cBid.cVector.nDelivery,
+		&cBid.cVector.nQuality,
+		&cBid.cVector.nPenalty
+	};
+	for (size_t nField = 0; nField < sizeof(pFields) / sizeof(pFields[0]); ++ nField) {
+		size_t nEnd = csVector.find(' ');
+		bool bLast = (nField == sizeof(pFields) / sizeof(pFields[0]) - 1);
+
+		/* last field ends the message, others end at a space */
+		if ((nEnd == std::string_view::npos) != bLast ||
+		    !ParseNumber(csVector.substr(0, nEnd), *pFields[nField]))
+			return ERR_PROTOCOL;
+
+		if (!bLast)
+			csVector = csVector.substr(nEnd + 1);
+	}
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Check for child manager's hello
+ */
+bool CProtocol::IsLeaf(std::string_view csMessage)
+{
+	return csMessage.substr(0, 5) == "leaf ";
+}
+
+/*
+ * Parse child manager's hello "leaf <pid>: <auction>"
+ */
+int CProtocol::ParseLeaf(std::string_view csMessage, LEAF_HELLO& cHello)
+{
+	std::string_view csPID;
+	std::string_view csAuction;
+
+	if (!IsLeaf(csMessage) ||
+	    !SplitPair(csMessage.substr(5), csPID, csAuction) ||
+	    !ParseNumber(csPID, cHello.nPID) ||
+	    !ParseNumber(csAuction, cHello.nAuction) ||
+	    cHello.nPID <= 0)
+		return ERR_PROTOCOL;
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Check for ready
+ */
+bool CProtocol::IsReady(std::string_view csMessage)
+{
+	return csMessage.substr(0, 6) == "ready ";
+}
+
+/*
+ * Parse ready "ready <pid>: <bidders>"
+ */
+int CProtocol::ParseReady(std::string_view csMessage, READY& cReady)
+{
+	std::string_view csPID;
+	std::string_view csBidders;
+
+	if (!IsReady(csMessage) ||
+	    !SplitPair(csMessage.substr(6), csPID, csBidders) ||
+	    !ParseNumber(csPID, cReady.nPID) ||
+	    !ParseNumber(csBidders, cReady.nBidders) ||
+	    cReady.nPID <= 0)
+		return ERR_PROTOCOL;
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Check for best bids
+ */
+bool CProtocol::IsTop(std::string_view csMessage)
+{
+	return csMessage.substr(0, 4) == "top ";
+}
+
+/*
+ * Parse best bids "top <pid>: <count> <bidder>=<score> ..."
+ */
+int CProtocol::ParseTop(std::string_view csMessage, TOP& cTop)
+{
+	std::string_view csPID;
+	std::string_view csEntries;
+
+	if (!IsTop(csMessage) ||
+	    !SplitPair(csMessage.substr(4), csPID, csEntries) ||
+	    !ParseNumber(csPID, cTop.nPID) ||
+	    cTop.nPID <= 0)
+		return ERR_PROTOCOL;
+
+	size_t nEnd = csEntries.find(' ');
+	if (!ParseNumber(csEntries.substr(0, nEnd), cTop.nEntries) || cTop.nEntries > MAX_TOP_K)
+		return ERR_PROTOCOL;
+
+	for (unsigned int nEntry = 0; nEntry < cTop.nEntries; ++ nEntry) {
+		if (nEnd == std::string_view::npos)
+			return ERR_PROTOCOL;	/* fewer than count */
+
+		csEntries = csEntries.substr(nEnd + 1);
+		nEnd = csEntries.find(' ');
+		std::string_view csPair = csEntries.substr(0, nEnd);
+		size_t nEqual = csPair.find('=');
+
+		if (nEqual == std::string_view::npos ||
+		    !ParseNumber(csPair.substr(0, nEqual), cTop.cEntries[nEntry].nPID) ||
+		    !ParseScore(csPair.substr(nEqual + 1), cTop.cEntries[nEntry].dScore))
+			return ERR_PROTOCOL;
+	}
+
+	return (nEnd == std::string_view::npos) ? ERR_SUCCESS : ERR_PROTOCOL;
+}
+
+/*
+ * Check for result
+ */
+bool CProtocol::IsResult(std::string_view csMessage)
+{
+	return csMessage.substr(0, 7) == "result ";
+}
+
+/*
+ * Parse result "result <score> <winners>"
+ */
+int CProtocol::ParseResult(std::string_view csMessage, RESULT& cResult)
+{
+	if (!IsResult(csMessage))
+		return ERR_PROTOCOL;
+
+	std::string_view csFields = csMessage.substr(7);
+	size_t nEnd = csFields.find(' ');
+	if (nEnd == std::string_view::npos ||
+	    !ParseScore(csFields.substr(0, nEnd), cResult.dScore) ||
+	    !ParseNumber(csFields.substr(nEnd + 1), cResult.nWinners))
+		return ERR_PROTOCOL;
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Format best bids, '\n' included
+ */
+size_t CProtocol::FormatTop(char* pBuffer, size_t nSize, pid_t nPID, const TOP_ENTRY* pEntries, unsigned int nEntries)
+{
+	int nLength = snprintf(pBuffer, nSize, "top %d: %u", nPID, nEntries);
+	if (nLength < 0 || (size_t) nLength >= nSize)
+		return 0;
+
+	size_t nUsed = nLength;
+	for (unsigned int nEntry = 0; nEntry < nEntries; ++ nEntry) {
+		nLength = snprintf(pBuffer + nUsed, nSize - nUsed, " %d=%.17g", pEntries[nEntry].nPID, pEntries[nEntry].dScore);
+		if (nLength < 0 || (size_t) nLength >= nSize - nUsed)
+			return 0;
+		nUsed += nLength;
+	}
+
+	if (nUsed + 1 >= nSize)
+		return 0;
+
+	pBuffer[nUsed ++] = '\n';
+	pBuffer[nUsed] = '\0';
+	return nUsed;
+}
+
+/*
+ * Format batch frame, '\n' included
+ */
+size_t CProtocol::FormatBatch(char* pBuffer, size_t nSize, pid_t nPID, const AUCTION_BID* pBids, unsigned int nBids)
+{
+	int nLength = snprintf(pBuffer, nSize, "batch %d:", nPID);
+	if (nLength < 0 || (size_t) nLength >= nSize)
+		return 0;
+
+	size_t nUsed = nLength;
+	for (unsigned int nBid = 0; nBid < nBids; ++ nBid) {
+		nLength = snprintf(pBuffer + nUsed, nSize - nUsed, " %u=%u", pBids[nBid].nAuction, pBids[nBid].nBid);
+		if (nLength < 0 || (size_t) nLength >= nSize - nUsed)
+			return 0;
+		nUsed += nLength;
+	}
+
+	if (nUsed + 1 >= nSize)
+		return 0;
+
+	pBuffer[nUsed ++] = '\n';
+	pBuffer[nUsed] = '\0';
+	return nUsed;
+}
+
+/*
+ * Check for gateway hello
+ */
+bool CProtocol::IsGateway(std::string_view csMessage)
+{
+	return csMessage.substr(0, 8) == "gateway ";
+}
+
+/*
+ * Parse gateway's hello "gateway <pid>: <auction>"
+ */
+int CProtocol::ParseGateway(std::string_view csMessage, GATEWAY_HELLO& cHello)
+{
+	std::string_view csPID;
+	std::string_view csAuction;
+
+	if (!IsGateway(csMessage) ||
+	    !SplitPair(csMessage.substr(8), csPID, csAuction) ||
+	    !ParseNumber(csPID, cHello.nPID) ||
+	    !ParseNumber(csAuction, cHello.nAuction) ||
+	    cHello.nPID <= 0)
+		return ERR_PROTOCOL;
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Check for join
+ */
+bool CProtocol::IsJoin(std::string_view csMessage)
+{
+	return csMessage.substr(0, 5) == "join ";
+}
+
+/*
+ * Parse join "join <pid>: <id> <id> ..."
+ */
+int CProtocol::ParseJoin(std::string_view csMessage, ID_LIST& cJoin)
+{
+	std::string_view csPID;
+	std::string_view csIDs;
+
+	if (!IsJoin(csMessage) ||
+	    !SplitPair(csMessage.substr(5), csPID, csIDs) ||
+	    !ParseNumber(csPID, cJoin.nPID) ||
+	    cJoin.nPID <= 0 ||
+	    !ParseIDs(csIDs, cJoin))
+		return ERR_PROTOCOL;
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Check for bids of virtual bidders
+ */
+bool CProtocol::IsGatewayBids(std::string_view csMessage)
+{
+	return csMessage.substr(0, 5) == "bids ";
+}
+
+/*
+ * Parse bids "bids <pid>: <id>=<bid> <id>=<bid> ..."
+ */
+int CProtocol::ParseGatewayBids(std::string_view csMessage, GATEWAY_BIDS& cBids)
+{
+	std::string_view csPID;
+	std::string_view csPairs;
+
+	if (!IsGatewayBids(csMessage) ||
+	    !SplitPair(csMessage.substr(5), csPID, csPairs) ||
+	    !ParseNumber(csPID, cBids.nPID) ||
+	    cBids.nPID <= 0)
+		return ERR_PROTOCOL;
+
+	cBids.nBids = 0;
+	while (!csPairs.empty()) {
+		size_t nEnd = csPairs.find(' ');
+		std::string_view csPair = csPairs.substr(0, nEnd);
+		size_t nEqual = csPair.find('=');
+
+		if (cBids.nBids == MAX_BATCH_BIDS ||
+		    nEqual == std::string_view::npos ||
+		    !ParseNumber(csPair.substr(0, nEqual), cBids.cBids[cBids.nBids].nPID) ||
+		    !ParseNumber(csPair.substr(nEqual + 1), cBids.cBids[cBids.nBids].nBid) ||
+		    cBids.cBids[cBids.nBids].nPID <= 0)
+			return ERR_PROTOCOL;
+
+		++ cBids.nBids;
+		if (nEnd == std::string_view::npos)
+			break;
+
+		csPairs = csPairs.substr(nEnd + 1);
+		if (csPairs.empty())
+			return ERR_PROTOCOL;	/* trailing space */
+	}
+
+	return (cBids.nBids != 0) ? ERR_SUCCESS : ERR_PROTOCOL;
+}
+
+/*
+ * Parse kill of virtual bidders "kill <id> <id> ..."
+ */
+int CProtocol::ParseKills(std::string_view csMessage, ID_LIST& cKills)
+{
+	cKills.nPID = 0;
+	if (csMessage.substr(0, 5) != "kill " || !ParseIDs(csMessage.substr(5), cKills))
+		return ERR_PROTOCOL;
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Format join frame, '\n' included
+ */
+size_t CProtocol::FormatJoin(char* pBuffer, size_t nSize, pid_t nPID, const pid_t* pIDs, unsigned int nIDs)
+{
+	int nLength = snprintf(pBuffer, nSize, "join %d:", nPID);
+	if (nLength < 0 || (size_t) nLength >= nSize)
+		return 0;
+
+	return FormatIDs(pBuffer, nSize, nLength, pIDs, nIDs);
+}
+
+/*
+ * Format bids of virtual bidders, '\n' included
+ */
+size_t CProtocol::FormatGatewayBids(char* pBuffer, size_t nSize, pid_t nPID, const BID* pBids, unsigned int nBids)
+{
+	int nLength = snprintf(pBuffer, nSize, "bids %d:", nPID);
+	if (nLength < 0 || (size_t) nLength >= nSize)
+		return 0;
+
+	size_t nUsed = nLength;
+	for (unsigned int nBid = 0; nBid < nBids; ++ nBid) {
+		nLength = snprintf(pBuffer + nUsed, nSize - nUsed, " %d=%u", pBids[nBid].nPID, pBids[nBid].nBid);
+		if (nLength < 0 || (size_t) nLength >= nSize - nUsed)
+			return 0;
+		nUsed += nLength;
+	}
+
+	if (nUsed + 1 >= nSize)
+		return 0;
+
+	pBuffer[nUsed ++] = '\n';
+	pBuffer[nUsed] = '\0';
+	return nUsed;
+}
+
+/*
+ * Format kill of virtual bidders, '\n' included
+ */
+size_t CProtocol::FormatKills(char* pBuffer, size_t nSize, const pid_t* pIDs, unsigned int nIDs)
+{
+	int nLength = snprintf(pBuffer, nSize, "kill");
+	if (nLength < 0 || (size_t) nLength >= nSize)
+		return 0;
+
+	return FormatIDs(pBuffer, nSize, nLength, pIDs, nIDs);
+}
+
+/*
+ * Format bundle bid "bundle <pid>: <price> <item> <item> ..."
+ */
+size_t CProtocol::FormatBundle(char* pBuffer, size_t nSize, const BUNDLE& cBundle)
+{
+	int nLength = snprintf(pBuffer, nSize, "bundle %d: %u", cBundle.nPID, cBundle.nPrice);
+	if (nLength < 0 || (size_t) nLength >= nSize)
+		return 0;
+
+	size_t nUsed = nLength;
+	for (unsigned int nItem = 0; nItem < cBundle.nItems; ++ nItem) {
+		nLength = snprintf(pBuffer + nUsed, nSize - nUsed, " %u", cBundle.cItems[nItem]);
+		if (nLength < 0 || (size_t) nLength >= nSize - nUsed)
+			return 0;
+		nUsed += nLength;
+	}
+
+	if (nUsed + 1 >= nSize)
+		return 0;
+
+	pBuffer[nUsed ++] = '\n';
+	pBuffer[nUsed] = '\0';
+	return nUsed;
+}
+
+/*
+ * Parse order from manager
+ */
+int CProtocol::ParseOrder(std::string_view csMessage)
+{
+	if (csMessage == "start" || csMessage.substr(0, 6) == "start ")
+		return ORDER_START;
+	if (csMessage == "kill")
+		return ORDER_KILL;
+
+	return ORDER_UNKNOWN;
+}
+
+/*
+ * Parse start "start <auction>.<round>", or "start" of a parent manager
+ */
+int CProtocol::ParseStart(std::string_view csMessage, ROUND_TAG& cTag)
+{
+	cTag.nAuction = 0;
+	cTag.nRound = 0;
+	if (csMessage == "start")
+		return ERR_SUCCESS;
+
+	if (csMessage.substr(0, 6) != "start " || !ParseRound(csMessage.substr(6), cTag))
+		return ERR_PROTOCOL;
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Parse tag "@<auction>.<round> " in front of a message
+ */
+size_t CProtocol::ParseTag(std::string_view csMessage, ROUND_TAG& cTag)
+{
+	if (csMessage.empty() || csMessage[0] != '@')
+		return 0;
+
+	size_t nSpace = csMessage.find(' ');
+	if (nSpace == std::string_view::npos || !ParseRound(csMessage.substr(1, nSpace - 1), cTag))
+		return 0;
+
+	return nSpace + 1;
+}
+
+/*
+ * Format tag "@<auction>.<round> "
+ */
+size_t CProtocol::FormatTag(char* pBuffer, size_t nSize, const ROUND_TAG& cTag)
+{
+	if (cTag.nRound == 0)
+		return 0;
+
+	int nLength = snprintf(pBuffer, nSize, "@%u.%u ", cTag.nAuction, cTag.nRound);
+	if (nLength < 0 || (size_t) nLength >= nSize)
+		return 0;
+
+	return nLength;
+}
+
+/*
+ * Parse round "<auction>.<round>", round starts at 1
+ */
+bool CProtocol::ParseRound(std::string_view csText, ROUND_TAG& cTag)
+{
+	size_t nDot = csText.find('.');
+	return nDot != std::string_view::npos &&
+	       ParseNumber(csText.substr(0, nDot), cTag.nAuction) &&
+	       ParseNumber(csText.substr(nDot + 1), cTag.nRound) &&
+	       cTag.nRound != 0;
+}
+
+/*
+ * Parse ids "<id> <id> ..."
+ */
+bool CProtocol::ParseIDs(std::string_view csText, ID_LIST& cList)
+{
+	cList.nIDs = 0;
+	while (!csText.empty()) {
+		size_t nEnd = csText.find(' ');
+		if (cList.nIDs == MAX_BATCH_BIDS ||
+		    !ParseNumber(csText.substr(0, nEnd), cList.cIDs[cList.nIDs]) ||
+		    cList.cIDs[cList.nIDs] <= 0)
+			return false;
+
+		++ cList.nIDs;
+		if (nEnd == std::string_view::npos)
+			break;
+
+		csText = csText.substr(nEnd + 1);
+		if (csText.empty())
+			return false;	/* trailing space */
+	}
+
+	return cList.nIDs != 0;
+}
+
+/*
+ * Append ids to a formatted frame, '\n' included
+ */
+size_t CProtocol::FormatIDs(char* pBuffer, size_t nSize, size_t nUsed, const pid_t* pIDs, unsigned int nIDs)
+{
+	for (unsigned int nID = 0; nID < nIDs; ++ nID) {
+		int nLength = snprintf(pBuffer + nUsed, nSize - nUsed, " %d", pIDs[nID]);
+		if (nLength < 0 || (size_t) nLength >= nSize - nUsed)
+			return 0;
+		nUsed += nLength;
+	}
+
+	if (nUsed + 1 >= nSize)
+		return 0;
+
+	pBuffer[nUsed ++] = '\n';
+	pBuffer[nUsed] = '\0';
+	return nUsed;
+}
+
+/*
+ * Parse high bid "price <bid> <pid>"
+ */
+int CProtocol::ParsePrice(std::string_view csMessage, PRICE& cPrice)
+{
+	if (csMessage.substr(0, 6) != "price ")
+		return ERR_PROTOCOL;
+
+	csMessage = csMessage.substr(6);
+	size_t nSpace = csMessage.find(' ');
+	if (nSpace == std::string_view::npos ||
+	    !ParseNumber(csMessage.substr(0, nSpace), cPrice.nPrice) ||
+	    !ParseNumber(csMessage.substr(nSpace + 1), cPrice.nPID) ||
+	    cPrice.nPID <= 0)
+		return ERR_PROTOCOL;
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Parse price on the clock of a Dutch auction "tick <price>"
+ */
+int CProtocol::ParseTick(std::string_view csMessage, unsigned int& nPrice)
+{
+	if (csMessage.substr(0, 5) != "tick " || !ParseNumber(csMessage.substr(5), nPrice))
+		return ERR_PROTOCOL;
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Parse start of a combinatorial auction "bundles <items>"
+ */
+int CProtocol::ParseBundles(std::string_view csMessage, unsigned int& nItems)
+{
+	if (csMessage.substr(0, 8) != "bundles " || !ParseNumber(csMessage.substr(8), nItems) ||
+	    nItems == 0 || nItems > MAX_ITEMS)
+		return ERR_PROTOCOL;
+
+	return ERR_SUCCESS;
+}
+
+/*
+ * Split message at ": "
+ */
+bool CProtocol::SplitPair(std::string_view csMessage, std::string_view& csFirst, std::string_view& csSecond)
+{
+	size_t nIndex = csMessage.find(": ");
+	if (nIndex == std::string_view::npos)
+		return false;
+
+	csFirst = csMessage.substr(0, nIndex);
+	csSecond = csMessage.substr(nIndex + 2);
+	return true;
+}
+
+/*
+ * Parse decimal number
+ * from_chars takes a sign for signed types, so check for digit first
+ */
+template<typename T>
+bool CProtocol::ParseNumber(std::string_view csText, T& nValue)
+{
+	if (csText.empty() || csText[0] < '0' || csText[0] > '9')
+		return false;
+
+	const char* pEnd = csText.data() + csText.size();
+	std::from_chars_result cRes = std::from_chars(csText.data(), pEnd, nValue);
+
+	return (cRes.ec == std::errc() && cRes.ptr == pEnd);
+}
+
+/*
+ * Parse score
+ * nan and inf would win or lose every comparison, they aren't scores
+ */
+bool CProtocol::ParseScore(std::string_view csText, double& dValue)
+{
+	if (csText.empty())
+		return false;
+
+	const char* pEnd = csText.data() + csText.size();
+	std::from_chars_result cRes = std::from_chars(csText.data(), pEnd, dValue);
+
+	return (cRes.ec == std::errc() && cRes.ptr == pEnd && std::isfinite(dValue));
+}
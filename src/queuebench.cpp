@@ -0,0 +1,129 @@
+/* Headers */
+#include "support.h"
+#include "log.h"
+#include "manager.h"
+
+/* Scores pushed by every producer */
+static const unsigned int BENCH_ITEMS = 1000000;
+
+/* Producers, as scoring threads of a shard */
+static const unsigned int BENCH_PRODUCERS = 4;
+
+/*
+ * Print usage of benchmark
+ */
+void Usage()
+{
+	printf("Usage: queuebench [PRODUCERS] [ITEMS]\n"
+		"\n"
+		"    PRODUCERS threads (default %u) push ITEMS scores each (default %u) into the\n"
+		"    manager's score queue, one consumer takes them in batches as the event loop does\n"
+		"\n", BENCH_PRODUCERS, BENCH_ITEMS);
+}
+
+/*
+ * ns since some point
+ */
+static uint64_t Now()
+{
+	struct timespec cNow;
+	clock_gettime(CLOCK_MONOTONIC, &cNow);
+	return cNow.tv_sec * 1000000000ULL + cNow.tv_nsec;
+}
+
+/* Queue under test, as m_cScores of CManager */
+static CMpscQueue<SCORE, SCORE_QUEUE_SIZE> g_cScores;
+
+/* Producers wait on it, so they start together */
+static std::atomic<bool> g_bGo(false);
+
+/*
+ * Producer, pushes nItems scores, yields while queue is full
+ * Returns times queue was full
+ */
+static uint64_t Produce(pid_t nPID, unsigned int nItems)
+{
+	uint64_t nFull = 0;
+	while (!g_bGo.load(std::memory_order_acquire))
+		std::this_thread::yield();
+
+	for (unsigned int nSeq = 0; nSeq < nItems; ++ nSeq) {
+		SCORE cScore = { 1, nPID, nSeq, (double) nSeq };
+		while (!g_cScores.TryPush(cScore)) {
+			++ nFull;
+			std::this_thread::yield();
+		}
+	}
+
+	return nFull;
+}
+
+/*
+ * main program
+ */
+int main(int argc, char* argv[])
+{
+	if (argc > 3) {
+		Usage();
+		return 1;
+	}
+	unsigned int nProducers = argc >= 2 ? atoi(argv[1]) : BENCH_PRODUCERS;
+	unsigned int nItems = argc == 3 ? atoi(argv[2]) : BENCH_ITEMS;
+	if (nProducers == 0 || nItems == 0) {
+		Usage();
+		return 1;
+	}
+
+	std::vector<uint64_t> cFull(nProducers, 0);
+	std::vector<std::thread> cProducers;
+	for (unsigned int nProducer = 0; nProducer < nProducers; ++ nProducer)
+		cProducers.emplace_back([&cFull, nProducer, nItems]() {
+			cFull[nProducer] = Produce(nProducer + 1, nItems);
+		});
+
+	/*
+	 * Consumer takes batches, checks every producer's scores come in order
+	 */
+	std::vector<unsigned int> cNext(nProducers + 1, 0);
+	uint64_t nTotal = (uint64_t) nProducers * nItems;
+	uint64_t nTaken = 0;
+	uint64_t nBatches = 0;
+	uint64_t nEmpty = 0;
+	SCORE cScores[MAX_DEQUEUE_BATCH];
+
+	uint64_t nStart = Now();
+	g_bGo.store(true, std::memory_order_release);
+	while (nTaken < nTotal) {
+		size_t nScores = g_cScores.PopBatch(cScores, MAX_DEQUEUE_BATCH);
+		if (nScores == 0) {
+			++ nEmpty;
+			std::this_thread::yield();
+			continue;
+		}
+
+		for (size_t nScore = 0; nScore < nScores; ++ nScore) {
+			const SCORE& cScore = cScores[nScore];
+			if (cScore.nSeq != cNext[cScore.nPID] ++) {
+				err_printf("Producer %d: score %u came out of order", cScore.nPID, cScore.nSeq);
+				return 1;
+			}
+		}
+		nTaken += nScores;
+		++ nBatches;
+	}
+	uint64_t nElapsed = Now() - nStart;
+
+	uint64_t nFull = 0;
+	for (unsigned int nProducer = 0; nProducer < nProducers; ++ nProducer) {
+		cProducers[nProducer].join();
+		nFull += cFull[nProducer];
+	}
+
+	log_message("%u producers, %u scores each, queue of %zu, batches up to %zu",
+		nProducers, nItems, SCORE_QUEUE_SIZE, MAX_DEQUEUE_BATCH);
+	log_message("%.2f M items/s, %.1f ns per item", nTotal * 1e3 / nElapsed, (double) nElapsed / nTotal);
+	log_message("%.2f items per batch, queue empty %llu times, full %llu times",
+		(double) nTaken / nBatches, (unsigned long long) nEmpty, (unsigned long long) nFull);
+
+	return 0;
+}
@@ -0,0 +1,86 @@
+#!/bin/sh
+#
+# Compare round trips of bids under settings of the manager
+# every setting runs the same auctions on loopback with --history and --timestamps,
+# bidhistory sums the history up, from round start to bid read
+#
+# usage: roundbench.sh SETTINGS [BIDDERS] [AUCTIONS] [RUNS]
+#   profiles     default, low-latency and throughput socket profiles
+#   busy-poll    manager sleeping in epoll, and spinning on BENCH_CPU (0 unless set)
+#   placement    bidders anywhere, and kept apart from the manager with CPU sets,
+#                BENCH_MANAGER_CPUS (0 unless set) and BENCH_BIDDER_CPUS (the other CPUs)
+#
+# project0 and bidhistory are taken from BENCH_BIN, next to this script unless set
+#
+
+SETTINGS=$1
+BIDDERS=${2:-20}
+AUCTIONS=${3:-8}
+RUNS=${4:-5}
+BIN=${BENCH_BIN:-`dirname $0`}
+TIMEOUT=${BENCH_TIMEOUT:-120}
+CPU=${BENCH_CPU:-0}
+CPUS=`getconf _NPROCESSORS_ONLN`
+MANAGER_CPUS=${BENCH_MANAGER_CPUS:-0}
+if [ $CPUS -gt 1 ]; then
+	BIDDER_CPUS=${BENCH_BIDDER_CPUS:-1-$((CPUS - 1))}
+else
+	BIDDER_CPUS=${BENCH_BIDDER_CPUS:-0}
+fi
+PORT=$((5300 + $$ % 500))
+HISTORY=${TMPDIR:-/tmp}/roundbench.$$
+
+usage()
+{
+	echo "usage: roundbench.sh profiles|busy-poll|placement [BIDDERS] [AUCTIONS] [RUNS]"
+	exit 1
+}
+
+#
+# run NAME OPTION...
+# every run has a port of its own, a closing one may still hold the last
+#
+run()
+{
+	NAME=$1
+	shift
+	RUN=1
+	while [ $RUN -le $RUNS ]; do
+		rm -f $HISTORY
+		timeout $TIMEOUT $BIN/project0 -b $BIDDERS -a $AUCTIONS -p $PORT -o $HISTORY -S "$@" >/dev/null 2>&1
+		PORT=$((PORT + 1))
+		if [ -s $HISTORY ]; then
+			printf "%-14s %s\n" "$NAME" "`$BIN/bidhistory $HISTORY | sed -n 's/^All auctions: //p'`"
+		else
+			printf "%-14s %s\n" "$NAME" "no history, run failed"
+		fi
+		RUN=$((RUN + 1))
+	done
+	rm -f $HISTORY
+}
+
+if [ ! -x $BIN/project0 ] || [ ! -x $BIN/bidhistory ]; then
+	echo "project0 and bidhistory aren't built in $BIN"
+	exit 1
+fi
+
+echo "$BIDDERS bidders in each of $AUCTIONS auctions, $RUNS runs"
+case "$SETTINGS" in
+profiles)
+	run default -P default
+	run low-latency -P low-latency
+	run throughput -P throughput
+	;;
+busy-poll)
+	run sleeping
+	run busy-poll -B $CPU
+	;;
+placement)
+	echo "manager on CPUs $MANAGER_CPUS, bidders on CPUs $BIDDER_CPUS of $CPUS"
+	run anywhere
+	run apart -C $MANAGER_CPUS -W $BIDDER_CPUS
+	;;
+*)
+	usage
+	;;
+esac
@@ -0,0 +1,83 @@
+/* Headers */
+#include "support.h"
+#include "log.h"
+#include "manager.h"
+
+/* Own bidders of the auction, they make the quorum */
+static const pid_t FIRST_BIDDER = 101;
+static const unsigned int TEST_BIDDERS = 4;
+
+/* Bidders, who joined from other auctions, as many as own ones */
+static const pid_t FIRST_JOINED = 201;
+
+/*
+ * Round test
+ * joined bidders of a sealed auction bid first, then own bidders one by one;
+ * round must stay open until the last own bidder has bid, under quorum of all
+ */
+class CRoundTest
+{
+public:
+	static int Run()
+	{
+		CManager cManager(TEST_BIDDERS);
+		cManager.AddAuction(1);
+
+		AUCTION* pAuction = cManager.FindAuction(1);
+		for (unsigned int nBidder = 0; nBidder < TEST_BIDDERS; ++ nBidder) {
+			cManager.AddBidder(*pAuction, FIRST_BIDDER + nBidder);
+			cManager.AddBidder(*pAuction, FIRST_JOINED + nBidder, true);
+		}
+		cManager.ResetRound(*pAuction);
+		pAuction->bStarted = true;
+
+		/* joined bidders come in as batch entries do, below own bids, so an own bidder wins */
+		for (unsigned int nBidder = 0; nBidder < TEST_BIDDERS; ++ nBidder) {
+			if (cManager.ApplyBatched(*pAuction, FIRST_JOINED + nBidder, 10 + nBidder) != ERR_SUCCESS) {
+				err_printf("Joined bidder %d couldn't bid", FIRST_JOINED + nBidder);
+				return 1;
+			}
+			if (cManager.CheckRound(*pAuction) != ERR_SUCCESS || pAuction->nClosedRound != 0 || pAuction->bRoundFull) {
+				err_printf("Round closed on joined bidders only");
+				return 1;
+			}
+		}
+
+		/* bidders have no connections, so the winner's kill is reported and dropped */
+		char cBuffer[MAX_MESSAGE_SIZE];
+		for (unsigned int nBidder = 0; nBidder < TEST_BIDDERS; ++ nBidder) {
+			CONN cConn = {};
+			cConn.nSocket = INVALID_SOCKET;
+			cConn.nPID = FIRST_BIDDER + nBidder;
+			cConn.nAuction = 1;
+
+			size_t nLength = snprintf(cBuffer, MAX_MESSAGE_SIZE, "%d: %u", cConn.nPID, 100 + nBidder);
+			int nRes = cManager.HandleMessage(cConn, std::string_view(cBuffer, nLength));
+			if (nRes != ERR_SUCCESS && nRes != ERR_MANAGER_DONE) {
+				err_printf("Bidder %d failed with %d", cConn.nPID, nRes);
+				return 1;
+			}
+
+			bool bLast = nBidder == TEST_BIDDERS - 1;
+			if (!bLast && pAuction->nClosedRound != 0) {
+				err_printf("Round closed after %u of %u own bidders", nBidder + 1, TEST_BIDDERS);
+				return 1;
+			}
+			if (bLast && pAuction->nClosedRound != 1) {
+				err_printf("Round is still open after every own bidder has bid");
+				return 1;
+			}
+		}
+
+		log_message("Round of %u own and %u joined bidders closed on the last own bid", TEST_BIDDERS, TEST_BIDDERS);
+		return 0;
+	}
+};
+
+/*
+ * main program
+ */
+int main()
+{
+	return CRoundTest::Run();
+}
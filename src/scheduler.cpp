@@ -0,0 +1,168 @@
+/*
+ * header files
+ */
+#include "support.h"
+#include "log.h"
+#include "manager.h"
+
+/*
+ * Constructor
+ */
+CScheduler::CScheduler()
+{
+	memset(&m_cJitter, 0, sizeof(m_cJitter));
+}
+
+/*
+ * Schedule a round
+ */
+void CScheduler::Schedule(AUCTION* pAuction, uint64_t nDeadline)
+{
+	if (pAuction->nHeap != NOT_SCHEDULED) {
+		/* move it, either way */
+		uint64_t nOld = pAuction->nDeadline;
+		pAuction->nDeadline = nDeadline;
+		if (nDeadline < nOld)
+			SiftUp(pAuction->nHeap);
+		else
+			SiftDown(pAuction->nHeap);
+		return;
+	}
+
+	pAuction->nDeadline = nDeadline;
+	m_cHeap.push_back(pAuction);
+	Place(m_cHeap.size() - 1);
+	SiftUp(m_cHeap.size() - 1);
+}
+
+/*
+ * Remove a round
+ * Last entry takes its place, and moves up or down from there
+ */
+void CScheduler::Cancel(AUCTION* pAuction)
+{
+	size_t nIndex = pAuction->nHeap;
+	if (nIndex == NOT_SCHEDULED)
+		return;
+
+	pAuction->nHeap = NOT_SCHEDULED;
+	AUCTION* pLast = m_cHeap.back();
+	m_cHeap.pop_back();
+	if (pLast == pAuction)
+		return;
+
+	m_cHeap[nIndex] = pLast;
+	Place(nIndex);
+	SiftUp(nIndex);
+	SiftDown(pLast->nHeap);
+}
+
+/*
+ * Take the earliest round, if it's due
+ */
+AUCTION* CScheduler::PopDue(uint64_t nNow)
+{
+	if (m_cHeap.empty() || m_cHeap[0]->nDeadline > nNow)
+		return NULL;
+
+	AUCTION* pAuction = m_cHeap[0];
+	Cancel(pAuction);
+	return pAuction;
+}
+
+/*
+ * Time to earliest deadline, rounded up to ms
+ */
+int CScheduler::Timeout(uint64_t nNow) const
+{
+	if (m_cHeap.empty())
+		return -1;
+
+	if (m_cHeap[0]->nDeadline <= nNow)
+		return 0;
+
+	return (m_cHeap[0]->nDeadline - nNow + 999999) / 1000000;
+}
+
+/*
+ * Count due rounds
+ * Only subtrees with a due root are visited
+ */
+size_t CScheduler::CountDue(uint64_t nNow) const
+{
+	return CountDue(nNow, 0);
+}
+
+size_t CScheduler::CountDue(uint64_t nNow, size_t nIndex) const
+{
+	if (nIndex >= m_cHeap.size() || m_cHeap[nIndex]->nDeadline > nNow)
+		return 0;
+
+	return 1 + CountDue(nNow, 2 * nIndex + 1) + CountDue(nNow, 2 * nIndex + 2);
+}
+
+/*
+ * Record how late a round was closed
+ */
+void CScheduler::RecordClose(uint64_t nDeadline, uint64_t nClosed)
+{
+	uint64_t nLate = nClosed > nDeadline ? nClosed - nDeadline : 0;
+	if (m_cJitter.nCloses == 0 || nLate < m_cJitter.nMin)
+		m_cJitter.nMin = nLate;
+	if (nLate > m_cJitter.nMax)
+		m_cJitter.nMax = nLate;
+	m_cJitter.nTotal += nLate;
+	++ m_cJitter.nCloses;
+}
+
+/*
+ * Monotonic clock
+ */
+uint64_t CScheduler::Now()
+{
+	struct timespec cNow;
+	clock_gettime(CLOCK_MONOTONIC, &cNow);
+	return (uint64_t) cNow.tv_sec * 1000000000ULL + cNow.tv_nsec;
+}
+
+/*
+ * Put entry, and tell its auction where it is
+ */
+void CScheduler::Place(size_t nIndex)
+{
+	m_cHeap[nIndex]->nHeap = nIndex;
+}
+
+void CScheduler::SiftUp(size_t nIndex)
+{
+	while (nIndex > 0) {
+		size_t nParent = (nIndex - 1) / 2;
+		if (m_cHeap[nParent]->nDeadline <= m_cHeap[nIndex]->nDeadline)
+			break;
+
+		std::swap(m_cHeap[nParent], m_cHeap[nIndex]);
+		Place(nParent);
+		Place(nIndex);
+		nIndex = nParent;
+	}
+}
+
+void CScheduler::SiftDown(size_t nIndex)
+{
+	while (true) {
+		size_t nSmallest = nIndex;
+		size_t nLeft = 2 * nIndex + 1;
+		size_t nRight = nLeft + 1;
+		if (nLeft < m_cHeap.size() && m_cHeap[nLeft]->nDeadline < m_cHeap[nSmallest]->nDeadline)
+			nSmallest = nLeft;
+		if (nRight < m_cHeap.size() && m_cHeap[nRight]->nDeadline < m_cHeap[nSmallest]->nDeadline)
+			nSmallest = nRight;
+		if (nSmallest == nIndex)
+			break;
+
+		std::swap(m_cHeap[nSmallest], m_cHeap[nIndex]);
+		Place(nSmallest);
+		Place(nIndex);
+		nIndex = nSmallest;
+	}
+}
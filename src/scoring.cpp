@@ -0,0 +1,28 @@
+/*
+ * header files
+ */
+#include "support.h"
+#include "log.h"
+#include "scoring.h"
+
+/*
+ * Constructor
+ */
+CWeightedScoring::CWeightedScoring(double dPrice/* = 1.0*/, double dDelivery/* = 2.0*/, double dQuality/* = 1.5*/, double dPenalty/* = 3.0*/)
+{
+	m_dPrice = dPrice;
+	m_dDelivery = dDelivery;
+	m_dQuality = dQuality;
+	m_dPenalty = dPenalty;
+}
+
+/*
+ * Score the bid
+ */
+double CWeightedScoring::Score(const BID_VECTOR& cVector) const
+{
+	return m_dQuality * cVector.nQuality -
+		m_dPrice * cVector.nPrice -
+		m_dDelivery * cVector.nDelivery -
+		m_dPenalty * cVector.nPenalty;
+}
@@ -8,7 +8,7 @@
  * Constructor
  * default for reuse port is true
  */
-CSocket::CSocket() : m_bReuse(true)
+CSocket::CSocket() : m_bReuse(true), m_bReusePort(false), m_nOptions(SOCK_PROFILE_DEFAULT)
 {
 	m_nSocket = INVALID_SOCKET;		/* Initialize as invalid socket handle */
 }
@@ -19,6 +19,8 @@ CSocket::CSocket() : m_bReuse(true)
 CSocket::CSocket(bool bReuse)
 {
 	m_bReuse = bReuse;				/* Set reuse port */
+	m_bReusePort = false;
+	m_nOptions = SOCK_PROFILE_DEFAULT;
 	m_nSocket = INVALID_SOCKET;		/* Initialize as invalid socket handle */
 }
 
@@ -50,6 +52,16 @@ void CSocket::SetSockHandle(int nSocket)
 	m_nSocket = nSocket;
 }
 
+/*
+ * Give up socket handle, caller closes it
+ */
+int CSocket::Detach()
+{
+	int nSocket = m_nSocket;
+	m_nSocket = INVALID_SOCKET;
+	return nSocket;
+}
+
 /*
  * Check if socket is open
  */
@@ -69,6 +81,8 @@ bool CSocket::Create(unsigned short nSocketPort, int nSocketType, const char* pS
 	m_nSocket = socket(AF_INET, nSocketType, 0);
 	if (m_nSocket == INVALID_SOCKET)
 		bRet = false;
+	else
+		SetOptions(m_nOptions);		/* accepted sockets inherit buffers of the listener */
 
 	/* Bind to the port */
 	if (!bRet || !InitializeSocket(nSocketPort, pSocketAddress)) {
@@ -116,6 +130,208 @@ bool CSocket::ReuseAddress()
 	return true;
 }
 
+/*
+ * Let sockets of other threads bind the same port
+ * kernel spreads the connections amongst them
+ */
+bool CSocket::ReusePort()
+{
+	assert(m_nSocket != INVALID_SOCKET);	/* check if socket is valid */
+
+	if (m_bReusePort) {
+
+		int nReuse = 1;
+		int nRes = setsockopt(m_nSocket, SOL_SOCKET, SO_REUSEPORT, (const char*) &nReuse, sizeof(int));
+		if (nRes == INVALID_SOCKET) {
+
+			perr_printf("Couldn't set SO_REUSEPORT");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Set options on this socket
+ */
+bool CSocket::SetOptions(unsigned int nFlags)
+{
+	assert(m_nSocket != INVALID_SOCKET);	/* check if socket is valid */
+
+	return SetOptions(m_nSocket, nFlags);
+}
+
+/*
+ * Set options on any socket handle
+ * Manager uses it for accepted sockets, bidders for sockets they connect themselves
+ */
+bool CSocket::SetOptions(int nSocket, unsigned int nFlags)
+{
+	bool bRet = true;
+	int nOn = 1;
+
+	if ((nFlags & SOCK_OPT_NODELAY) && setsockopt(nSocket, IPPROTO_TCP, TCP_NODELAY, &nOn, sizeof(nOn)) == INVALID_SOCKET) {
+
+		perr_printf("Couldn't set TCP_NODELAY");
+		bRet = false;
+	}
+
+	if ((nFlags & SOCK_OPT_QUICKACK) && !QuickAck(nSocket))
+		bRet = false;
+
+	/* raising it above net.core.busy_read needs CAP_NET_ADMIN */
+	int nBusyPoll = BUSY_POLL_TIME;
+	if ((nFlags & SOCK_OPT_BUSY_POLL) && setsockopt(nSocket, SOL_SOCKET, SO_BUSY_POLL, &nBusyPoll, sizeof(nBusyPoll)) == INVALID_SOCKET) {
+
+		perr_printf("Couldn't set SO_BUSY_POLL");
+		bRet = false;
+	}
+
+	int nBuffer = 0;
+	if (nFlags & SOCK_OPT_SMALL_BUFFERS)
+		nBuffer = SMALL_SOCKET_BUFFER;
+	else if (nFlags & SOCK_OPT_LARGE_BUFFERS)
+		nBuffer = LARGE_SOCKET_BUFFER;
+	if (nBuffer != 0 &&
+		(setsockopt(nSocket, SOL_SOCKET, SO_SNDBUF, &nBuffer, sizeof(nBuffer)) == INVALID_SOCKET ||
+		setsockopt(nSocket, SOL_SOCKET, SO_RCVBUF, &nBuffer, sizeof(nBuffer)) == INVALID_SOCKET)) {
+
+		perr_printf("Couldn't set socket buffers to %d bytes", nBuffer);
+		bRet = false;
+	}
+
+	return bRet;
+}
+
+/*
+ * Cork or uncork a socket
+ */
+bool CSocket::Cork(int nSocket, bool bCork)
+{
+	int nCork = bCork ? 1 : 0;
+	if (setsockopt(nSocket, IPPROTO_TCP, TCP_CORK, &nCork, sizeof(nCork)) == INVALID_SOCKET) {
+
+		perr_printf("Couldn't set TCP_CORK");
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Turn on quick acks
+ */
+bool CSocket::QuickAck(int nSocket)
+{
+	int nOn = 1;
+	if (setsockopt(nSocket, IPPROTO_TCP, TCP_QUICKACK, &nOn, sizeof(nOn)) == INVALID_SOCKET) {
+
+		perr_printf("Couldn't set TCP_QUICKACK");
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Ask kernel to stamp received data
+ * raw hardware stamps come only from a NIC, which has them turned on (SIOCSHWTSTAMP)
+ */
+bool CSocket::EnableTimestamps()
+{
+	assert(m_nSocket != INVALID_SOCKET);	/* check if socket is valid */
+
+#ifdef SO_TIMESTAMPING
+	int nFlags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+		SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+	if (setsockopt(m_nSocket, SOL_SOCKET, SO_TIMESTAMPING, &nFlags, sizeof(nFlags)) == INVALID_SOCKET) {
+
+		perr_printf("Couldn't set SO_TIMESTAMPING");
+		return false;
+	}
+
+	return true;
+#else
+	err_printf("Kernel timestamps aren't supported");
+	return false;
+#endif
+}
+
+/*
+ * Receive data with its kernel timestamp
+ * a hardware stamp is taken over the software one, if NIC has made it
+ */
+ssize_t CSocket::ReceiveStamped(int nSocket, void* lpBuffer, size_t nBufferLen, uint64_t& nStamp, int nFlags/* = 0*/)
+{
+	nStamp = 0;
+
+	char cControl[CMSG_SPACE(3 * sizeof(struct timespec))];
+	struct iovec cData = { lpBuffer, nBufferLen };
+	struct msghdr cMessage;
+	memset(&cMessage, 0, sizeof(cMessage));
+	cMessage.msg_iov = &cData;
+	cMessage.msg_iovlen = 1;
+	cMessage.msg_control = cControl;
+	cMessage.msg_controllen = sizeof(cControl);
+
+	ssize_t nBytes = recvmsg(nSocket, &cMessage, nFlags);
+	if (nBytes <= 0)
+		return nBytes;
+
+#ifdef SO_TIMESTAMPING
+	for (struct cmsghdr* pHeader = CMSG_FIRSTHDR(&cMessage); pHeader != NULL; pHeader = CMSG_NXTHDR(&cMessage, pHeader)) {
+		if (pHeader->cmsg_level != SOL_SOCKET || pHeader->cmsg_type != SCM_TIMESTAMPING)
+			continue;
+
+		/* software, deprecated, raw hardware */
+		struct timespec cStamps[3];
+		memcpy(cStamps, CMSG_DATA(pHeader), sizeof(cStamps));
+		const struct timespec& cStamp = (cStamps[2].tv_sec != 0 || cStamps[2].tv_nsec != 0) ? cStamps[2] : cStamps[0];
+		nStamp = cStamp.tv_sec * 1000000000ULL + cStamp.tv_nsec;
+	}
+#endif
+
+	return nBytes;
+}
+
+/*
+ * Set non blocking mode
+ */
+bool CSocket::SetNonBlocking(bool bNonBlocking/* = true*/)
+{
+	assert(m_nSocket != INVALID_SOCKET);	/* check if socket is valid */
+
+	return SetNonBlocking(m_nSocket, bNonBlocking);
+}
+
+/*
+ * Set non blocking mode on any socket handle
+ * Manager uses it for accepted sockets, which are not wrapped in CSocket
+ */
+bool CSocket::SetNonBlocking(int nSocket, bool bNonBlocking/* = true*/)
+{
+	int nFlags = fcntl(nSocket, F_GETFL, 0);
+	if (nFlags == INVALID_SOCKET) {
+
+		perr_printf("Couldn't get socket flags");		/* error message, if failed */
+		return false;
+	}
+
+	if (bNonBlocking)
+		nFlags |= O_NONBLOCK;
+	else
+		nFlags &= ~O_NONBLOCK;
+
+	if (fcntl(nSocket, F_SETFL, nFlags) == INVALID_SOCKET) {
+
+		perr_printf("Couldn't set socket flags");		/* error message, if failed */
+		return false;
+	}
+
+	return true;
+}
+
 /*
  * Initialize socket
  */
@@ -147,6 +363,10 @@ bool CSocket::InitializeSocket(unsigned short uPort, const char* pSocketAddress)
 	/* Are we reusing address, don't return error */
 	ReuseAddress();
 
+	/* Sharing the port must work, or bind fails for the second socket */
+	if (!ReusePort())
+		return false;
+
 	/*
 	 * Bind to the address and port
 	 * if no error then returns 0
@@ -174,6 +394,7 @@ bool CSocket::Connect(const char* lpszHostAddress, unsigned short uHostPort)
 			perr_printf("Creating socket failed");
 			return false;
 		}
+		SetOptions(m_nOptions);
 	}
 
 	/* Fill address machinery of sockets. */
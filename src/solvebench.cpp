@@ -0,0 +1,109 @@
+/* Headers */
+#include "support.h"
+#include "log.h"
+#include "solver.h"
+
+/* Defaults of a run */
+static const unsigned int BENCH_BUNDLES = 4000;
+static const unsigned int BENCH_RUNS = 5;
+
+/*
+ * Print usage of benchmark
+ */
+void Usage()
+{
+	printf("Usage: solvebench [ITEMS] [BUNDLES] [THREADS] [BUDGET_MS]\n"
+		"\n"
+		"    Solve %u auctions of BUNDLES bundle bids (default %u) on ITEMS items (default %u)\n"
+		"    with THREADS solver threads (default one per core) and BUDGET_MS ms each (default %u),\n"
+		"    bundles are neighbouring items priced item by item, as bidders make them\n"
+		"\n", BENCH_RUNS, BENCH_BUNDLES, MAX_ITEMS, SOLVER_TIME_BUDGET);
+}
+
+/*
+ * Bundles of one auction, seeded by the run
+ */
+static void Generate(unsigned int nRun, unsigned int nItems, std::vector<BUNDLE_BID>& cBids)
+{
+	srand(nRun + 1);
+	for (size_t nBid = 0; nBid < cBids.size(); ++ nBid) {
+		BUNDLE_BID& cBid = cBids[nBid];
+		unsigned int nFirst = rand() % nItems;
+		unsigned int nSize = 1 + rand() % std::min(MAX_BUNDLE_ITEMS, nItems);
+		cBid.nPID = 1000 + nBid;
+		cBid.nPrice = 0;
+		cBid.cItems.reset();
+		for (unsigned int nIndex = 0; nIndex < nSize; ++ nIndex) {
+			cBid.cItems.set((nFirst + nIndex) % nItems);
+			cBid.nPrice += 5 + rand() % 20;
+		}
+	}
+}
+
+/*
+ * main program
+ */
+int main(int argc, char* argv[])
+{
+	if (argc > 5) {
+		Usage();
+		return 1;
+	}
+	unsigned int nItems = argc >= 2 ? atoi(argv[1]) : MAX_ITEMS;
+	unsigned int nBundles = argc >= 3 ? atoi(argv[2]) : BENCH_BUNDLES;
+	unsigned int nThreads = argc >= 4 ? atoi(argv[3]) : 0;
+	unsigned int nBudget = argc >= 5 ? atoi(argv[4]) : SOLVER_TIME_BUDGET;
+	if (nItems == 0 || nItems > MAX_ITEMS || nBundles == 0 || nBudget == 0) {
+		Usage();
+		return 1;
+	}
+
+	CWinnerSolver cSolver(nThreads);
+	std::vector<BUNDLE_BID> cBids(nBundles);
+	uint64_t nNodes = 0;
+	uint64_t nTime = 0;
+	unsigned int nOptimal = 0;
+
+	log_message("%u items, %u bundles, budget %u ms", nItems, nBundles, nBudget);
+	for (unsigned int nRun = 0; nRun < BENCH_RUNS; ++ nRun) {
+		Generate(nRun, nItems, cBids);
+
+		SOLUTION cSolution;
+		if (cSolver.Solve(cBids.data(), cBids.size(), nBudget * 1000000ULL, cSolution) != ERR_SUCCESS) {
+			err_printf("Run %u couldn't be solved", nRun);
+			return 1;
+		}
+
+		/* winners must not share items */
+		ITEM_MASK cUsed;
+		uint64_t nRevenue = 0;
+		for (size_t nWinner = 0; nWinner < cSolution.cWinners.size(); ++ nWinner) {
+			const BUNDLE_BID& cBid = cBids[cSolution.cWinners[nWinner]];
+			if ((cBid.cItems & cUsed).any()) {
+				err_printf("Run %u: bundle of %d overlaps another winner", nRun, cBid.nPID);
+				return 1;
+			}
+			cUsed |= cBid.cItems;
+			nRevenue += cBid.nPrice;
+		}
+		if (nRevenue != cSolution.nRevenue) {
+			err_printf("Run %u: winners pay %llu, solver says %llu", nRun,
+				(unsigned long long) nRevenue, (unsigned long long) cSolution.nRevenue);
+			return 1;
+		}
+
+		log_message("Run %u: %zu winners, revenue %llu, %llu nodes, %.2f ms, %s", nRun,
+			cSolution.cWinners.size(), (unsigned long long) cSolution.nRevenue,
+			(unsigned long long) cSolution.nNodes, cSolution.nTime / 1e6,
+			cSolution.bOptimal ? "optimal" : "budget over");
+		nNodes += cSolution.nNodes;
+		nTime += cSolution.nTime;
+		if (cSolution.bOptimal)
+			++ nOptimal;
+	}
+
+	log_message("%u of %u optimal, mean %.2f ms and %llu nodes, %.2f M nodes/s", nOptimal, BENCH_RUNS,
+		nTime / 1e6 / BENCH_RUNS, (unsigned long long) (nNodes / BENCH_RUNS), nNodes * 1e3 / nTime);
+
+	return 0;
+}
@@ -0,0 +1,218 @@
+/*
+ * header files
+ */
+#include "support.h"
+#include "log.h"
+#include "scheduler.h"
+#include "solver.h"
+
+/* Nodes searched between two looks at the clock */
+static const uint64_t BUDGET_CHECK_NODES = 1024;
+
+/*
+ * Constructor
+ */
+CWinnerSolver::CWinnerSolver(unsigned int nThreads/* = 0*/) :
+	m_cPool(nThreads)
+{
+	m_pBids = NULL;
+	m_nBest = 0;
+	m_nNextRoot = 0;
+	m_bStop = false;
+	m_nNodes = 0;
+	m_nItems = 0;
+	m_nDeadline = 0;
+	m_nRunning = 0;
+}
+
+/*
+ * Destructor
+ */
+CWinnerSolver::~CWinnerSolver()
+{
+}
+
+/*
+ * Solve winner determination
+ * searches until it's proven optimal, or nBudget ns are over
+ * best found so far is the answer in either case
+ */
+int CWinnerSolver::Solve(const BUNDLE_BID* pBids, size_t nBids, uint64_t nBudget, SOLUTION& cSolution)
+{
+	uint64_t nStart = CScheduler::Now();
+	debug_log("Entering %s ...", __FUNCTION__);
+
+	/*
+	 * Bids by price per item, best first
+	 * bound of a subtree only goes down from here on
+	 */
+	m_pBids = pBids;
+	m_cOrder.clear();
+	for (size_t nBid = 0; nBid < nBids; ++ nBid)
+		if (pBids[nBid].nPrice != 0 && pBids[nBid].cItems.any())
+			m_cOrder.push_back(nBid);
+
+	std::sort(m_cOrder.begin(), m_cOrder.end(), [pBids](size_t nFirst, size_t nSecond) {
+		uint64_t nLeft = (uint64_t) pBids[nFirst].nPrice * pBids[nSecond].cItems.count();
+		uint64_t nRight = (uint64_t) pBids[nSecond].nPrice * pBids[nFirst].cItems.count();
+		if (nLeft != nRight)
+			return nLeft > nRight;
+		return pBids[nFirst].nPrice > pBids[nSecond].nPrice;
+	});
+
+	ITEM_MASK cItems;
+	m_cDensity.resize(m_cOrder.size());
+	m_cSuffix.assign(m_cOrder.size() + 1, 0);
+	for (size_t nBid = m_cOrder.size(); nBid -- > 0; ) {
+		const BUNDLE_BID& cBid = pBids[m_cOrder[nBid]];
+		m_cDensity[nBid] = (double) cBid.nPrice / cBid.cItems.count();
+		m_cSuffix[nBid] = m_cSuffix[nBid + 1] + cBid.nPrice;
+		cItems |= cBid.cItems;
+	}
+	m_nItems = cItems.count();
+
+	m_nBest = 0;
+	m_cBest.clear();
+	m_nNextRoot = 0;
+	m_bStop = false;
+	m_nNodes = 0;
+	m_nDeadline = nStart + nBudget;
+
+	Greedy();
+
+	/*
+	 * Workers take subtrees in order, best first
+	 * this thread waits, the auction can't go on without winners
+	 */
+	m_nRunning = m_cPool.GetThreads();
+	for (unsigned int nWorker = 0; nWorker < m_cPool.GetThreads(); ++ nWorker)
+		m_cPool.Submit([this] { Worker(); });
+
+	{
+		std::unique_lock<std::mutex> cLock(m_cDoneLock);
+		m_cDone.wait(cLock, [this] { return m_nRunning == 0; });
+	}
+
+	cSolution.cWinners.clear();
+	for (size_t nWinner = 0; nWinner < m_cBest.size(); ++ nWinner)
+		cSolution.cWinners.push_back(m_cOrder[m_cBest[nWinner]]);
+	cSolution.nRevenue = m_nBest;
+	cSolution.nNodes = m_nNodes;
+	cSolution.nTime = CScheduler::Now() - nStart;
+	cSolution.bOptimal = !m_bStop;
+
+	debug_log("Exiting %s with code %d (0x%x)...", __FUNCTION__, ERR_SUCCESS, ERR_SUCCESS);
+	return ERR_SUCCESS;
+}
+
+/*
+ * Take every bid, which fits, in order
+ * search starts with this, and falls back to it if budget is tiny
+ */
+void CWinnerSolver::Greedy()
+{
+	ITEM_MASK cUsed;
+	uint64_t nValue = 0;
+	std::vector<size_t> cChosen;
+
+	for (size_t nBid = 0; nBid < m_cOrder.size(); ++ nBid) {
+		const BUNDLE_BID& cBid = m_pBids[m_cOrder[nBid]];
+		if ((cBid.cItems & cUsed).any())
+			continue;
+
+		cUsed |= cBid.cItems;
+		nValue += cBid.nPrice;
+		cChosen.push_back(nBid);
+	}
+
+	Offer(nValue, cChosen);
+}
+
+/*
+ * Search thread
+ * subtree n takes bid n first, and none before it
+ */
+void CWinnerSolver::Worker()
+{
+	ITEM_MASK cUsed;
+	std::vector<size_t> cChosen;
+	uint64_t nNodes = 0;
+
+	while (!m_bStop) {
+		size_t nRoot = m_nNextRoot ++;
+		if (nRoot >= m_cOrder.size())
+			break;
+
+		/* bound of later subtrees is lower still, nothing is left */
+		uint64_t nBound = std::min<uint64_t>(m_cSuffix[nRoot],
+			m_cDensity[nRoot] * m_nItems + 1e-6);
+		if (nBound <= m_nBest) {
+			m_nNextRoot = m_cOrder.size();
+			break;
+		}
+
+		const BUNDLE_BID& cBid = m_pBids[m_cOrder[nRoot]];
+		cUsed = cBid.cItems;
+		cChosen.assign(1, nRoot);
+		++ nNodes;
+		if (cBid.nPrice > m_nBest)
+			Offer(cBid.nPrice, cChosen);
+		Search(nRoot + 1, cUsed, cBid.nPrice, cChosen, nNodes);
+	}
+
+	m_nNodes += nNodes;
+
+	std::lock_guard<std::mutex> cLock(m_cDoneLock);
+	if (-- m_nRunning == 0)
+		m_cDone.notify_one();
+}
+
+/*
+ * Depth first, taking a bid before leaving it
+ * bids which overlap taken items are skipped without branching
+ */
+void CWinnerSolver::Search(size_t nNext, ITEM_MASK& cUsed, uint64_t nValue, std::vector<size_t>& cChosen, uint64_t& nNodes)
+{
+	size_t nFree = m_nItems - cUsed.count();	/* taken items are all bid on */
+	for (size_t nBid = nNext; nBid < m_cOrder.size(); ++ nBid) {
+		if (++ nNodes % BUDGET_CHECK_NODES == 0 && CScheduler::Now() >= m_nDeadline)
+			m_bStop = true;
+		if (m_bStop)
+			return;
+
+		/*
+		 * Rest can't pay more than all of it, or all free items at the best price per item left
+		 * bound only goes down with later bids, so the whole branch is done
+		 */
+		uint64_t nBound = std::min<uint64_t>(m_cSuffix[nBid], m_cDensity[nBid] * nFree + 1e-6);
+		if (nValue + nBound <= m_nBest)
+			return;
+
+		const BUNDLE_BID& cBid = m_pBids[m_cOrder[nBid]];
+		if ((cBid.cItems & cUsed).any())
+			continue;
+
+		cUsed |= cBid.cItems;
+		cChosen.push_back(nBid);
+		if (nValue + cBid.nPrice > m_nBest)
+			Offer(nValue + cBid.nPrice, cChosen);
+
+		Search(nBid + 1, cUsed, nValue + cBid.nPrice, cChosen, nNodes);
+
+		cChosen.pop_back();
+		cUsed &= ~cBid.cItems;
+	}
+}
+
+/*
+ * Keep the solution, if it's still the best
+ */
+void CWinnerSolver::Offer(uint64_t nValue, const std::vector<size_t>& cChosen)
+{
+	std::lock_guard<std::mutex> cLock(m_cBestLock);
+	if (nValue <= m_nBest && !m_cBest.empty())
+		return;
+
+	m_nBest = nValue;
+	m_cBest = cChosen;
+}
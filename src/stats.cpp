@@ -0,0 +1,111 @@
+/*
+ * header files
+ */
+#include "support.h"
+#include "log.h"
+#include "stats.h"
+
+#include <cmath>
+
+/*
+ * Sketch keeps quantiles within 1% of the true bid
+ * bids up to 2^32 need about 1100 buckets, so they are never collapsed
+ */
+static const double SKETCH_ACCURACY = 0.01;
+static const double SKETCH_GAMMA = (1 + SKETCH_ACCURACY) / (1 - SKETCH_ACCURACY);
+static const double SKETCH_LOG_GAMMA = std::log(SKETCH_GAMMA);
+static const size_t SKETCH_BUCKETS = std::ceil(32 * std::log(2.0) / SKETCH_LOG_GAMMA) + 1;
+
+/*
+ * Constructor
+ */
+CBidStats::CBidStats() :
+	m_cBuckets(SKETCH_BUCKETS, 0)	/* every bid has its bucket, Add never allocates */
+{
+	m_nCount = 0;
+	m_nMin = 0;
+	m_nMax = 0;
+	m_nSum = 0;
+	m_nZero = 0;
+	memset(m_cHistogram, 0, sizeof(m_cHistogram));
+}
+
+/*
+ * Add a bid to every aggregate
+ */
+void CBidStats::Add(unsigned int nBid)
+{
+	if (m_nCount == 0 || nBid < m_nMin)
+		m_nMin = nBid;
+	if (m_nCount == 0 || nBid > m_nMax)
+		m_nMax = nBid;
+	++ m_nCount;
+	m_nSum += nBid;
+
+	/* bin is the bit length of the bid */
+	unsigned int nBin = nBid == 0 ? 0 : 32 - __builtin_clz(nBid);
+	++ m_cHistogram[nBin];
+
+	if (nBid == 0) {
+		++ m_nZero;
+		return;
+	}
+
+	size_t nIndex = std::ceil(std::log((double) nBid) / SKETCH_LOG_GAMMA);
+	++ m_cBuckets[nIndex];
+}
+
+/*
+ * Walk the sketch to the bucket of the rank
+ * middle of the bucket is within accuracy of every bid in it
+ */
+double CBidStats::Quantile(double dQuantile) const
+{
+	if (m_nCount == 0)
+		return 0;
+
+	uint64_t nRank = dQuantile * (m_nCount - 1);
+	if (nRank < m_nZero)
+		return 0;
+
+	uint64_t nSeen = m_nZero;
+	for (size_t nIndex = 0; nIndex < m_cBuckets.size(); ++ nIndex) {
+		nSeen += m_cBuckets[nIndex];
+		if (nSeen > nRank) {
+			double dValue = 2 * std::pow(SKETCH_GAMMA, nIndex) / (SKETCH_GAMMA + 1);
+			return std::min<double>(std::max<double>(dValue, m_nMin), m_nMax);
+		}
+	}
+
+	return m_nMax;
+}
+
+/*
+ * Distribution in three lines
+ * histogram shows only bins, which have bids
+ */
+void CBidStats::Log(unsigned int nAuction) const
+{
+	if (m_nCount == 0) {
+		log_message("Auction %u: no bids", nAuction);
+		return;
+	}
+
+	log_message("Auction %u: %llu bids, min %u, max %u, mean %.2f", nAuction,
+		(unsigned long long) m_nCount, m_nMin, m_nMax, (double) m_nSum / m_nCount);
+	log_message("Auction %u: p50 %.1f, p90 %.1f, p99 %.1f", nAuction,
+		Quantile(0.5), Quantile(0.9), Quantile(0.99));
+
+	char cBuffer[MAX_FRAME_SIZE] = { 0 };
+	size_t nUsed = 0;
+	for (unsigned int nBin = 0; nBin < HISTOGRAM_BINS && nUsed < sizeof(cBuffer); ++ nBin) {
+		if (m_cHistogram[nBin] == 0)
+			continue;
+
+		unsigned long long nLow = nBin == 0 ? 0 : 1ULL << (nBin - 1);
+		unsigned long long nHigh = nBin == 0 ? 0 : (1ULL << nBin) - 1;
+		nUsed += snprintf(cBuffer + nUsed, sizeof(cBuffer) - nUsed, " %llu-%llu:%llu",
+			nLow, nHigh, (unsigned long long) m_cHistogram[nBin]);
+	}
+	log_message("Auction %u: bids by range%s", nAuction, cBuffer);
+}
@@ -0,0 +1,224 @@
+/*
+ * header files
+ */
+#include "support.h"
+#include "log.h"
+#include "threadpool.h"
+
+#include <algorithm>
+
+/* worker index of current thread, -1 if it isn't a worker */
+static thread_local int s_nWorker = -1;
+
+/*
+ * Constructor
+ * start the workers
+ */
+CThreadPool::CThreadPool(unsigned int nThreads/* = 0*/) :
+	m_cWorkers(nThreads ? nThreads : std::max(1u, std::thread::hardware_concurrency()))
+{
+	m_nPending = 0;
+	m_nNext = 0;
+	m_bStop = false;
+
+	for (size_t nWorker = 0; nWorker < m_cWorkers.size(); ++ nWorker) {
+		m_cWorkers[nWorker].nFirst = 0;
+		m_cWorkers[nWorker].nLast = 0;
+	}
+
+	debug_log("Starting %zu scoring threads", m_cWorkers.size());
+	for (unsigned int nWorker = 0; nWorker < m_cWorkers.size(); ++ nWorker)
+		m_cThreads.emplace_back(&CThreadPool::Run, this, nWorker);
+}
+
+/*
+ * Destructor
+ * workers finish queued jobs, then exit
+ */
+CThreadPool::~CThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> cLock(m_cSleepLock);
+		m_bStop = true;
+	}
+	m_cWake.notify_all();
+
+	for (size_t nThread = 0; nThread < m_cThreads.size(); ++ nThread)
+		m_cThreads[nThread].join();
+}
+
+/*
+ * Queue the job
+ */
+void CThreadPool::Submit(std::function<void()> cJob)
+{
+	unsigned int nWorker = 0;
+	if (s_nWorker >= 0)
+		nWorker = s_nWorker;		/* keep it local, it is likely to use the same data */
+	else
+		nWorker = m_nNext ++ % m_cWorkers.size();
+
+	/* counted before it can be taken, so a worker never counts it down first */
+	{
+		std::lock_guard<std::mutex> cLock(m_cSleepLock);
+		++ m_nPending;
+	}
+
+	{
+		std::lock_guard<std::mutex> cLock(m_cWorkers[nWorker].cLock);
+		m_cWorkers[nWorker].cJobs.push_back(std::move(cJob));
+	}
+	m_cWake.notify_one();
+}
+
+/*
+ * Queue the fixed job
+ * it goes on the rings round robin, as Submit does, the next ring if one is full
+ */
+bool CThreadPool::TrySubmit(const POOL_JOB& cJob)
+{
+	unsigned int nWorker = 0;
+	if (s_nWorker >= 0)
+		nWorker = s_nWorker;
+	else
+		nWorker = m_nNext ++ % m_cWorkers.size();
+
+	{
+		std::lock_guard<std::mutex> cLock(m_cSleepLock);
+		++ m_nPending;
+	}
+
+	for (size_t nOther = 0; nOther < m_cWorkers.size(); ++ nOther) {
+		if (PushFixed((nWorker + nOther) % m_cWorkers.size(), cJob)) {
+			m_cWake.notify_one();
+			return true;
+		}
+	}
+
+	-- m_nPending;		/* every ring is full, caller runs it */
+	return false;
+}
+
+/*
+ * Put fixed job on back of a worker's ring
+ */
+bool CThreadPool::PushFixed(unsigned int nWorker, const POOL_JOB& cJob)
+{
+	CWorker& cWorker = m_cWorkers[nWorker];
+	std::lock_guard<std::mutex> cLock(cWorker.cLock);
+	if (cWorker.nLast - cWorker.nFirst == JOB_QUEUE_SIZE)
+		return false;
+
+	cWorker.cFixed[cWorker.nLast ++ & (JOB_QUEUE_SIZE - 1)] = cJob;
+	return true;
+}
+
+/*
+ * Take newest fixed job from own ring
+ */
+bool CThreadPool::PopFixed(unsigned int nWorker, POOL_JOB& cJob)
+{
+	CWorker& cWorker = m_cWorkers[nWorker];
+	std::lock_guard<std::mutex> cLock(cWorker.cLock);
+	if (cWorker.nFirst == cWorker.nLast)
+		return false;
+
+	cJob = cWorker.cFixed[-- cWorker.nLast & (JOB_QUEUE_SIZE - 1)];
+	return true;
+}
+
+/*
+ * Take oldest fixed job from another worker's ring
+ */
+bool CThreadPool::StealFixed(unsigned int nWorker, POOL_JOB& cJob)
+{
+	for (size_t nOther = 1; nOther < m_cWorkers.size(); ++ nOther) {
+		CWorker& cVictim = m_cWorkers[(nWorker + nOther) % m_cWorkers.size()];
+		std::lock_guard<std::mutex> cLock(cVictim.cLock);
+		if (cVictim.nFirst != cVictim.nLast) {
+			cJob = cVictim.cFixed[cVictim.nFirst ++ & (JOB_QUEUE_SIZE - 1)];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Take newest job from own queue
+ */
+bool CThreadPool::Pop(unsigned int nWorker, std::function<void()>& cJob)
+{
+	std::lock_guard<std::mutex> cLock(m_cWorkers[nWorker].cLock);
+	if (m_cWorkers[nWorker].cJobs.empty())
+		return false;
+
+	cJob = std::move(m_cWorkers[nWorker].cJobs.back());
+	m_cWorkers[nWorker].cJobs.pop_back();
+	return true;
+}
+
+/*
+ * Take oldest job from another worker
+ */
+bool CThreadPool::Steal(unsigned int nWorker, std::function<void()>& cJob)
+{
+	for (size_t nOther = 1; nOther < m_cWorkers.size(); ++ nOther) {
+		CWorker& cVictim = m_cWorkers[(nWorker + nOther) % m_cWorkers.size()];
+		std::lock_guard<std::mutex> cLock(cVictim.cLock);
+		if (!cVictim.cJobs.empty()) {
+			cJob = std::move(cVictim.cJobs.front());
+			cVictim.cJobs.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Worker thread
+ */
+void CThreadPool::Run(unsigned int nWorker)
+{
+	s_nWorker = nWorker;
+	std::function<void()> cJob;
+	POOL_JOB cFixed;
+
+	while (true) {
+		if (PopFixed(nWorker, cFixed)) {
+			-- m_nPending;
+			cFixed.pRun(cFixed.pContext, cFixed.cArgs);
+			continue;
+		}
+
+		if (Pop(nWorker, cJob)) {
+			-- m_nPending;
+			cJob();
+			cJob = nullptr;
+			continue;
+		}
+
+		/* own work is done, help the others */
+		if (StealFixed(nWorker, cFixed)) {
+			-- m_nPending;
+			cFixed.pRun(cFixed.pContext, cFixed.cArgs);
+			continue;
+		}
+
+		if (Steal(nWorker, cJob)) {
+			-- m_nPending;
+			cJob();
+			cJob = nullptr;
+			continue;
+		}
+
+		/*
+		 * Nothing to do, sleep unless a job is queued
+		 */
+		std::unique_lock<std::mutex> cLock(m_cSleepLock);
+		m_cWake.wait(cLock, [this] { return m_bStop || m_nPending > 0; });
+		if (m_bStop && m_nPending == 0)
+			break;
+	}
+}